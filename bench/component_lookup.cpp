@@ -0,0 +1,112 @@
+// Per-frame component lookup cost of NtComponentArray's sparse set against the
+// unordered_map storage it replaced, see nt_ecs.hpp.
+// Build and run with: xmake build bench_component_lookup && xmake run bench_component_lookup
+
+#include "nt_ecs.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace nt;
+
+namespace {
+
+// The NtComponentArray this replaced, lookups only. Components lived in a
+// std::array<T, MAX_ENTITIES>; a vector here, so it can hold 500k of them.
+template<typename T>
+class HashMapComponentArray
+{
+public:
+    explicit HashMapComponentArray(size_t capacity) : componentArray(capacity) {}
+
+    void InsertData(NtEntity entity, T component) {
+        size_t newIndex = size;
+        entityToIndexMap[entity] = newIndex;
+        indexToEntityMap[newIndex] = entity;
+        componentArray[newIndex] = component;
+        ++size;
+    }
+
+    T& GetData(NtEntity entity) {
+        return componentArray[entityToIndexMap[entity]];
+    }
+
+private:
+    std::vector<T> componentArray;
+    std::unordered_map<NtEntity, size_t> entityToIndexMap;
+    std::unordered_map<size_t, NtEntity> indexToEntityMap;
+    size_t size = 0;
+};
+
+// Stand-ins with the sizes of cTransform and cModel, the pair a render frame fetches
+struct BenchTransform {
+    float translation[3]{};
+    float rotation[3]{};
+    float scale[3]{1.0f, 1.0f, 1.0f};
+    float orientation[4]{0.0f, 0.0f, 0.0f, 1.0f};
+    bool bUseOrientation = false;
+};
+
+struct BenchModel {
+    void* mesh = nullptr;
+    uint32_t handle = 0;
+    bool bDropShadow = false;
+};
+
+// Mean of several runs, in microseconds
+template<typename F>
+double Time(F&& f, int runs) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (int run = 0; run < runs; ++run) f();
+    return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / runs;
+}
+
+}
+
+int main() {
+    std::printf("%9s %22s %20s\n", "entities", "unordered_map", "sparse set");
+    for (size_t count : {5000ul, 50000ul, 500000ul}) {
+        // Components are added in shuffled order, as spawning and streaming would
+        std::vector<NtEntity> entities(count);
+        std::iota(entities.begin(), entities.end(), NtEntity{0});
+        std::mt19937 rng(1);
+        std::shuffle(entities.begin(), entities.end(), rng);
+
+        HashMapComponentArray<BenchTransform> oldTransforms(count);
+        HashMapComponentArray<BenchModel> oldModels(count);
+        NtComponentArray<BenchTransform> transforms;
+        NtComponentArray<BenchModel> models;
+        for (NtEntity entity : entities) {
+            oldTransforms.InsertData(entity, {});
+            oldModels.InsertData(entity, {});
+            transforms.InsertData(entity, {}, 0);
+            models.InsertData(entity, {}, 0);
+        }
+
+        // One frame: every entity in id order fetches its model and transform
+        volatile float sink = 0.0f;
+        const int runs = count > 100000 ? 5 : 50;
+        const double hashMapUs = Time([&] {
+            float sum = 0.0f;
+            for (NtEntity entity = 0; entity < count; ++entity) {
+                sum += oldTransforms.GetData(entity).translation[0] + oldModels.GetData(entity).bDropShadow;
+            }
+            sink = sum;
+        }, runs);
+        const double sparseSetUs = Time([&] {
+            float sum = 0.0f;
+            for (NtEntity entity = 0; entity < count; ++entity) {
+                sum += transforms.GetData(entity).translation[0] + models.GetData(entity).bDropShadow;
+            }
+            sink = sum;
+        }, runs);
+
+        std::printf("%9zu %14.1f us/frame %12.1f us/frame (%.1fx)\n", count, hashMapUs, sparseSetUs, hashMapUs / sparseSetUs);
+    }
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Batch transform kernel against the scalar per-entity path, see nt_transform_batch.hpp.
+// Build and run with: xmake build bench_transform_batch && xmake run bench_transform_batch
+
+#include "nt_transform_batch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace nt;
+
+namespace {
+
+struct Matrix {
+    float m[16];
+};
+
+// Same formulas as cTransform::mat4() and cTransform::normalMatrix(), on plain floats so
+// the benchmark needs neither glm nor the rest of the engine. Like the component, the
+// normal matrix computes its trig again.
+void ScalarTransform(const float* t, const float* r, const float* s, Matrix& model, Matrix& normal) {
+    {
+        const float c3 = std::cos(r[2]), s3 = std::sin(r[2]);
+        const float c2 = std::cos(r[0]), s2 = std::sin(r[0]);
+        const float c1 = std::cos(r[1]), s1 = std::sin(r[1]);
+        const float rotation[9] = {
+            c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1,
+            c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3,
+            c2 * s1, -s2, c1 * c2};
+        for (int column = 0; column < 3; ++column) {
+            for (int row = 0; row < 3; ++row) model.m[column * 4 + row] = s[column] * rotation[column * 3 + row];
+            model.m[column * 4 + 3] = 0.0f;
+        }
+        model.m[12] = t[0]; model.m[13] = t[1]; model.m[14] = t[2]; model.m[15] = 1.0f;
+    }
+    {
+        const float c3 = std::cos(r[2]), s3 = std::sin(r[2]);
+        const float c2 = std::cos(r[0]), s2 = std::sin(r[0]);
+        const float c1 = std::cos(r[1]), s1 = std::sin(r[1]);
+        const float rotation[9] = {
+            c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1,
+            c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3,
+            c2 * s1, -s2, c1 * c2};
+        for (int column = 0; column < 3; ++column) {
+            for (int row = 0; row < 3; ++row) normal.m[column * 4 + row] = rotation[column * 3 + row] / s[column];
+            normal.m[column * 4 + 3] = 0.0f;
+        }
+        normal.m[12] = normal.m[13] = normal.m[14] = 0.0f; normal.m[15] = 1.0f;
+    }
+}
+
+// Best of several runs, in microseconds
+template<typename F>
+double Time(F&& f, int runs) {
+    double best = 1e30;
+    for (int run = 0; run < runs; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+}
+
+int main() {
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> angle(-3.14f, 3.14f), position(-50.0f, 50.0f), scale(0.2f, 3.0f);
+
+    std::printf("%9s %14s %22s %20s %12s\n", "count", "scalar Euler", "Euler->quat + batch", "quaternion input", "max error");
+    for (size_t count : {10000ul, 100000ul, 1000000ul}) {
+        // The scalar path reads cTransform-like structs, the kernel SoA streams
+        std::vector<float> components(count * 9);
+        std::vector<float> translation[3], euler[3], scales[3], quaternion[4];
+        for (auto* streams : {translation, euler, scales}) {
+            for (int axis = 0; axis < 3; ++axis) streams[axis].resize(count);
+        }
+        for (auto& stream : quaternion) stream.resize(count);
+
+        for (size_t i = 0; i < count; ++i) {
+            for (int axis = 0; axis < 3; ++axis) {
+                translation[axis][i] = components[i * 9 + axis] = position(rng);
+                euler[axis][i] = components[i * 9 + 3 + axis] = angle(rng);
+                scales[axis][i] = components[i * 9 + 6 + axis] = scale(rng);
+            }
+        }
+
+        std::vector<Matrix> scalarModel(count), scalarNormal(count), batchModel(count), batchNormal(count);
+        const int runs = count > 100000 ? 5 : 20;
+
+        const double scalarUs = Time([&] {
+            for (size_t i = 0; i < count; ++i) {
+                const float* transform = &components[i * 9];
+                ScalarTransform(transform, transform + 3, transform + 6, scalarModel[i], scalarNormal[i]);
+            }
+        }, runs);
+
+        const double convertUs = Time([&] {
+            EulerToQuaternionBatch(euler[0].data(), euler[1].data(), euler[2].data(),
+                quaternion[0].data(), quaternion[1].data(), quaternion[2].data(), quaternion[3].data(), count);
+        }, runs);
+
+        const NtTransformStreams streams{
+            {translation[0].data(), translation[1].data(), translation[2].data()},
+            {quaternion[0].data(), quaternion[1].data(), quaternion[2].data(), quaternion[3].data()},
+            {scales[0].data(), scales[1].data(), scales[2].data()}};
+        const double batchUs = Time([&] {
+            ComputeTransformMatricesBatch(streams, batchModel[0].m, batchNormal[0].m, count);
+        }, runs);
+
+        // Relative to the element, or absolute below 1
+        float maxError = 0.0f;
+        for (size_t i = 0; i < count; ++i) {
+            for (int k = 0; k < 16; ++k) {
+                maxError = std::max(maxError, std::fabs(scalarModel[i].m[k] - batchModel[i].m[k]) /
+                                              std::max(1.0f, std::fabs(scalarModel[i].m[k])));
+                maxError = std::max(maxError, std::fabs(scalarNormal[i].m[k] - batchNormal[i].m[k]) /
+                                              std::max(1.0f, std::fabs(scalarNormal[i].m[k])));
+            }
+        }
+
+        std::printf("%9zu %11.0f us %11.0f us (%.1fx) %9.0f us (%.1fx) %12.1e\n", count, scalarUs,
+            convertUs + batchUs, scalarUs / (convertUs + batchUs), batchUs, scalarUs / batchUs, maxError);
+    }
+    return 0;
+}
@@ -8,7 +8,10 @@
 #include "nt_input_system.hpp"
 #include "nt_light_system.hpp"
 #include "nt_material.hpp"
+#include "nt_gpu_culling.hpp"
 #include "nt_render_system.hpp"
+#include "nt_skinning.hpp"
+#include "nt_transform_system.hpp"
 #include "nt_anim_system.hpp"
 #include "nt_physics_system.hpp"
 #include "nt_types.hpp"
@@ -87,11 +90,13 @@ AstralApp::AstralApp()
     .setMaxSets(NtSwapChain::MAX_FRAMES_IN_FLIGHT)
     .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, NtSwapChain::MAX_FRAMES_IN_FLIGHT)
     .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, NtSwapChain::MAX_FRAMES_IN_FLIGHT * 2)
+    .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NtSwapChain::MAX_FRAMES_IN_FLIGHT)
     .build();
 
   globalSetLayout = NtDescriptorSetLayout::Builder(ntDevice)
     .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
     .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // Shadow map
+    .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT) // Instances
     .build();
 
 
@@ -107,8 +112,10 @@ AstralApp::AstralApp()
     .build();
 
 
+  // Per animated entity, read and written by the skinning pass, see NtSkeletonPose
   boneSetLayout = NtDescriptorSetLayout::Builder(ntDevice)
-    .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+    .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Joint matrices
+    .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Skinned vertices
     .build();
 
   bonePool = NtDescriptorPool::Builder(ntDevice)
@@ -120,7 +127,6 @@ AstralApp::AstralApp()
       ntDevice,
       globalSetLayout->getDescriptorSetLayout(),
       modelSetLayout->getDescriptorSetLayout(),
-      boneSetLayout->getDescriptorSetLayout(),
       *ntRenderer.getSwapChain());
 }
 AstralApp::~AstralApp() {
@@ -142,6 +148,18 @@ void AstralApp::run()
 
       uboBuffers[i]->map();
     }
+    // Per-instance data of every draw in the frame, see RenderSystem::getInstances
+    std::vector<std::unique_ptr<NtBuffer>> instanceBuffers(NtSwapChain::MAX_FRAMES_IN_FLIGHT);
+    for (int i = 0; i < instanceBuffers.size(); i++) {
+      instanceBuffers[i] = std::make_unique<NtBuffer> (
+        ntDevice,
+        sizeof(NtInstanceData),
+        MAX_INSTANCES,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+
+      instanceBuffers[i]->map();
+    }
     std::vector<VkDescriptorSet> globalDescriptorSets(NtSwapChain::MAX_FRAMES_IN_FLIGHT);
     // Shadow map descriptor image info
     VkDescriptorImageInfo shadowMapImageInfo{};
@@ -151,13 +169,29 @@ void AstralApp::run()
 
     for(int i = 0; i < globalDescriptorSets.size(); i++) {
       auto bufferInfo = uboBuffers[i]->descriptorInfo();
+      auto instanceInfo = instanceBuffers[i]->descriptorInfo();
 
       NtDescriptorWriter(*globalSetLayout, *globalPool)
         .writeBuffer(0, &bufferInfo)
         .writeImage(1, &shadowMapImageInfo)
+        .writeBuffer(2, &instanceInfo)
         .build(globalDescriptorSets[i]);
     }
 
+    // Animated instances are skinned once per frame, ahead of both passes
+    auto skinningPass = std::make_shared<NtSkinningPass>(ntDevice, geometryArena, boneSetLayout->getDescriptorSetLayout());
+
+    // Compute culling for GPU-driven draws, it writes the visible instances into the same buffers,
+    // behind the ones the CPU path wrote
+    std::shared_ptr<NtGpuCuller> gpuCuller;
+    if (ntDevice.supportsDrawIndirectCount()) {
+      std::vector<VkDescriptorBufferInfo> instanceInfos;
+      for (const auto& instanceBuffer : instanceBuffers) {
+        instanceInfos.push_back(instanceBuffer->descriptorInfo());
+      }
+      gpuCuller = std::make_shared<NtGpuCuller>(ntDevice, instanceInfos);
+    }
+
 // ⌛
     auto currentTime = std::chrono::high_resolution_clock::now();
 
@@ -167,6 +201,7 @@ void AstralApp::run()
     // Component Types setup
     Nexus.RegisterComponent<cMeta>();
     Nexus.RegisterComponent<cTransform>();
+    Nexus.RegisterComponent<cParent>();
     Nexus.RegisterComponent<cLight>();
     Nexus.RegisterComponent<cModel>();
     Nexus.RegisterComponent<cAnimator>();
@@ -187,9 +222,18 @@ void AstralApp::run()
     inputSignature.set(Nexus.GetComponentType<cPlayerController>());
     Nexus.SetSystemSignature<InputSystem>(inputSignature);
 
+    auto transformSystem = Nexus.RegisterSystem<TransformSystem>();
+    NtSignature transformSignature;
+    transformSignature.set(Nexus.GetComponentType<cTransform>());
+    Nexus.SetSystemSignature<TransformSystem>(transformSignature);
+
     auto renderSystem = Nexus.RegisterSystem<RenderSystem>(ntDevice,
         *ntRenderer.getSwapChain(),
-        materialLibrary);
+        geometryArena,
+        materialLibrary,
+        transformSystem,
+        skinningPass,
+        gpuCuller);
     NtSignature renderSignature;
     renderSignature.set(Nexus.GetComponentType<cModel>());
     Nexus.SetSystemSignature<RenderSystem>(renderSignature);
@@ -204,7 +248,9 @@ void AstralApp::run()
     cameraSignature.set(Nexus.GetComponentType<cCamera>());
     Nexus.SetSystemSignature<CameraSystem>(cameraSignature);
 
-    auto animationSystem = Nexus.RegisterSystem<AnimationSystem>();
+    auto animationSystem = Nexus.RegisterSystem<AnimationSystem>(ntDevice,
+        boneSetLayout->getDescriptorSetLayout(),
+        bonePool->getDescriptorPool());
     NtSignature animationSignature;
     animationSignature.set(Nexus.GetComponentType<cAnimator>());
     animationSignature.set(Nexus.GetComponentType<cModel>());
@@ -219,12 +265,13 @@ void AstralApp::run()
     physicsSystem->initialize();
 
     // Spawning entities
-    auto MoonlitCafe = Nexus.CreateEntity();
-    MoonlitCafe.AddComponent(cMeta{"MoonlitCafe"})
+    auto MoonlitCafe = Nexus.BuildEntity()
+        .AddComponent(cMeta{"MoonlitCafe"})
         .AddComponent(cTransform{ glm::vec3(0.0f),
             glm::vec3(0.0f, 0.0f, 0.0f) })
-        .AddComponent(cModel{ createModelFromFile(getAssetPath("assets/meshes/MoonlitCafe/MoonlitCafe.gltf")) })
-        .AddComponent(cStaticCollider{});
+        .AddComponent(cModel{ streamModelFromFile(getAssetPath("assets/meshes/MoonlitCafe/MoonlitCafe.gltf")) })
+        .AddComponent(cStaticCollider{})
+        .Finish();
 
     // Create environment collision boxes for MoonlitCafe
     // Floor - main ground plane
@@ -236,38 +283,45 @@ void AstralApp::run()
     physicsSystem->createStaticBoxCollider(MoonlitCafe.GetID(), glm::vec3(4.0f, 0.4f, 6.0f), glm::vec3(-4.0f, 1.2f, 0.0f), slopeRot);
 
 
-    auto rainSprite = Nexus.CreateEntity();
-    rainSprite.AddComponent(cMeta{"rainBillboard"})
+    // One plane shared by every rain sheet, so they draw as instances of a single mesh
+    std::shared_ptr<NtModel> rainPlane = createPlane(5.0f, getAssetPath("assets/textures/scrollrain.jpg"), MaterialType::SCROLLING_UV);
+
+    auto rainSprite = Nexus.BuildEntity()
+        .AddComponent(cMeta{"rainBillboard"})
         .AddComponent(cTransform{ glm::vec3(14.5f, 7.0f, -23.0f),
             glm::vec3(0.0f, 0.0f, 0.0f) })
-        .AddComponent(cModel{ createPlane(5.0f, getAssetPath("assets/textures/scrollrain.jpg"), MaterialType::SCROLLING_UV) });
+        .AddComponent(cModel{ rainPlane })
+        .Finish();
 
-    auto rainSprite2 = Nexus.CreateEntity();
-    rainSprite2.AddComponent(cMeta{"rainBillboard"})
+    auto rainSprite2 = Nexus.BuildEntity()
+        .AddComponent(cMeta{"rainBillboard"})
         .AddComponent(cTransform{ glm::vec3(-0.3f, 7.0f, -27.0f),
             glm::vec3(0.0f, 0.0f, 0.0f) })
-        .AddComponent(cModel{ createPlane(5.0f, getAssetPath("assets/textures/scrollrain.jpg"), MaterialType::SCROLLING_UV) });
+        .AddComponent(cModel{ rainPlane })
+        .Finish();
 
-    auto rainSprite3 = Nexus.CreateEntity();
-    rainSprite3.AddComponent(cMeta{"rainBillboard"})
+    auto rainSprite3 = Nexus.BuildEntity()
+        .AddComponent(cMeta{"rainBillboard"})
         .AddComponent(cTransform{ glm::vec3(-23.0f, 7.0f, -13.0f),
             glm::vec3(0.0f, 1.55f, 0.0f) })
-        .AddComponent(cModel{ createPlane(5.0f, getAssetPath("assets/textures/scrollrain.jpg"), MaterialType::SCROLLING_UV) });
+        .AddComponent(cModel{ rainPlane })
+        .Finish();
 
-    auto rainSprite4 = Nexus.CreateEntity();
-    rainSprite4.AddComponent(cMeta{"rainBillboard"})
+    auto rainSprite4 = Nexus.BuildEntity()
+        .AddComponent(cMeta{"rainBillboard"})
         .AddComponent(cTransform{ glm::vec3(-23.0f, 7.0f, 12.0f),
             glm::vec3(0.0f, 1.55f, 0.0f) })
-        .AddComponent(cModel{ createPlane(5.0f, getAssetPath("assets/textures/scrollrain.jpg"), MaterialType::SCROLLING_UV) });
+        .AddComponent(cModel{ rainPlane })
+        .Finish();
 
 
     // rainSprite.GetComponent<cModel>().materialParams.scrollSpeed = glm::vec2(0.0f, -0.5f);
 
-    auto Cassandra = Nexus.CreateEntity();
-    Cassandra.AddComponent(cMeta{"Cassandra"})
+    auto Cassandra = Nexus.BuildEntity()
+        .AddComponent(cMeta{"Cassandra"})
         .AddComponent(cTransform{ glm::vec3(0.0f, 3.0f, 0.0f),
             glm::vec3(0.0f, -1.5f, 0.0f) })
-        .AddComponent(cModel{ createModelFromFile(getAssetPath("assets/meshes/Cassandra/Cassandra_256.gltf"), MaterialType::NPR), true })
+        .AddComponent(cModel{ streamModelFromFile(getAssetPath("assets/meshes/Cassandra/Cassandra_256.gltf"), MaterialType::NPR), true })
         .AddComponent(cAnimator {} )
         .AddComponent(cCamera{ 65.f
             ,ntRenderer.getAspectRatio()
@@ -276,37 +330,42 @@ void AstralApp::run()
             ,glm::vec4(1.5f, 2.5f, 0.0f, 14.1f)
             ,{ glm::vec3(-11.f, -10.2f, -6.5f), glm::vec3(0.4f, 5.4f, 0.0f) }})
         .AddComponent(cPlayerController{5.0f, 10.0f})
-        .AddComponent(cCharacterPhysics{});
+        .AddComponent(cCharacterPhysics{})
+        .Finish();
     Cassandra.GetComponent<cAnimator>().play("Idle", true);
 
     // Create character controller for player
     physicsSystem->createCharacterController(Cassandra.GetID());
 
-    auto Mildred = Nexus.CreateEntity();
-    Mildred.AddComponent(cMeta{"Mildred"})
+    auto Mildred = Nexus.BuildEntity()
+        .AddComponent(cMeta{"Mildred"})
         .AddComponent(cTransform{ glm::vec3(-2.5f, 1.5f, -18.0f),
             glm::vec3(0.0f, 0.0f, 0.0f) })
-        .AddComponent(cModel{ createModelFromFile(getAssetPath("assets/meshes/Cassandra/Cassandra_256.gltf"), MaterialType::NPR), true })
+        .AddComponent(cModel{ streamModelFromFile(getAssetPath("assets/meshes/Cassandra/Cassandra_256.gltf"), MaterialType::NPR), true })
         .AddComponent(cAnimator {} )
-        .AddComponent(cCharacterPhysics{});
+        .AddComponent(cCharacterPhysics{})
+        .Finish();
     Mildred.GetComponent<cAnimator>().play("Idle", true);
 
     physicsSystem->createCharacterController(Mildred.GetID());
 
-    auto BarLight = Nexus.CreateEntity();
-    BarLight.AddComponent(cMeta{"Light.Bar"})
+    auto BarLight = Nexus.BuildEntity()
+        .AddComponent(cMeta{"Light.Bar"})
         .AddComponent(cTransform{ glm::vec3(3.5f, 7.5f, 7.2f) })
-        .AddComponent(cLight{100.0f, glm::vec3(1.0f, 0.65f, 0.33f) });
+        .AddComponent(cLight{100.0f, glm::vec3(1.0f, 0.65f, 0.33f) })
+        .Finish();
 
-    auto FireplaceLight = Nexus.CreateEntity();
-    FireplaceLight.AddComponent(cMeta{"Light.Fireplace"})
+    auto FireplaceLight = Nexus.BuildEntity()
+        .AddComponent(cMeta{"Light.Fireplace"})
         .AddComponent(cTransform{ glm::vec3(13.0f, 4.2f, -9.9f) })
-        .AddComponent(cLight{75.0f, glm::vec3(1.0f, 0.3f, 0.03f) });
+        .AddComponent(cLight{75.0f, glm::vec3(1.0f, 0.3f, 0.03f) })
+        .Finish();
 
-    auto SunShadowCaster = Nexus.CreateEntity();
-    SunShadowCaster.AddComponent(cMeta{"Light.Sun"})
+    auto SunShadowCaster = Nexus.BuildEntity()
+        .AddComponent(cMeta{"Light.Sun"})
         .AddComponent(cTransform{ glm::vec3(0.0f), glm::vec3(-0.68, -0.8f, -0.46f) })
-        .AddComponent(cLight{0.0f, glm::vec3(0.5f, 0.35f, 0.33f), true, eLightType::Directional });
+        .AddComponent(cLight{0.0f, glm::vec3(0.5f, 0.35f, 0.33f), true, eLightType::Directional })
+        .Finish();
 
 //  Debug stuff
     imguiShadowMapTexture = ImGui_ImplVulkan_AddTexture(
@@ -316,7 +375,7 @@ void AstralApp::run()
     static float OrthoScale = 31.0f;
     static float OrthoNear = -30.0f;
     static float OrthoFar = 44.0f;
-    static int selectedEntityID = -1;
+    static NtEntity selectedEntityID = INVALID_ENTITY;
 
     im3dRenderer = std::make_unique<NtIm3dRenderer>(
         ntDevice,
@@ -324,6 +383,30 @@ void AstralApp::run()
         globalSetLayout->getDescriptorSetLayout()
     );
 
+    // Component access per system, lets the scheduler overlap systems that don't conflict
+    NtSystemAccess inputAccess{};
+    inputAccess.writes.set(Nexus.GetComponentType<cTransform>())
+        .set(Nexus.GetComponentType<cCamera>())
+        .set(Nexus.GetComponentType<cPlayerController>())
+        .set(Nexus.GetComponentType<cCharacterPhysics>());
+    inputAccess.bMainThread = true; // GLFW input must be polled on the main thread
+
+    NtSystemAccess physicsAccess{};
+    physicsAccess.writes.set(Nexus.GetComponentType<cCharacterPhysics>())
+        .set(Nexus.GetComponentType<cTransform>());
+
+    NtSystemAccess cameraAccess{};
+    cameraAccess.reads.set(Nexus.GetComponentType<cTransform>());
+    cameraAccess.writes.set(Nexus.GetComponentType<cCamera>());
+
+    NtSystemAccess lightAccess{};
+    lightAccess.reads.set(Nexus.GetComponentType<cTransform>())
+        .set(Nexus.GetComponentType<cLight>());
+
+    NtSystemAccess animationAccess{};
+    animationAccess.reads.set(Nexus.GetComponentType<cModel>());
+    animationAccess.writes.set(Nexus.GetComponentType<cAnimator>());
+
     // Enable physics debug drawing by default (can be toggled via ImGui)
     physicsSystem->setDebugDrawEnabled(true);
 
@@ -395,6 +478,82 @@ void AstralApp::run()
 
         ImGui::Text("Current FPS: %.1f", io.Framerate);
 
+        if (ImGui::TreeNode("Systems")) {
+            const auto& schedulerStats = systemScheduler.GetStats();
+            ImGui::Text("Wall: %.3f ms  Critical path: %.3f ms", schedulerStats.wallMs, schedulerStats.criticalPathMs);
+            ImGui::Text("Serial sum: %.3f ms  Workers: %u", schedulerStats.serialMs, jobSystem.GetWorkerCount());
+            ImGui::Text("Transforms recomputed: %u", transformSystem->getUpdatedCount());
+            const auto& renderStats = renderSystem->getStats();
+            ImGui::Text("Draw calls: %u  Instances: %u  State changes: %u", renderStats.drawCalls, renderStats.instances,
+                renderStats.stateChanges());
+            ImGui::Text("Binds - pipeline: %u  set: %u  buffer: %u  skipped: %u", renderStats.pipelineBinds,
+                renderStats.descriptorSetBinds, renderStats.bufferBinds, renderStats.skippedBinds);
+            ImGui::Text("Culled - shadow: %u  opaque: %u  transparent: %u", renderStats.culledDraws[0],
+                renderStats.culledDraws[1], renderStats.culledDraws[2]);
+            ImGui::Text("LODs - 0: %u  1: %u  2: %u  3: %u", renderStats.lodDraws[0], renderStats.lodDraws[1],
+                renderStats.lodDraws[2], renderStats.lodDraws[3]);
+            ImGui::Text("Skinned - instances: %u  vertices: %u", renderStats.skinnedInstances, renderStats.skinnedVertices);
+            int shadowLodBias = static_cast<int>(renderSystem->getShadowLodBias());
+            if (ImGui::SliderInt("Shadow LOD bias", &shadowLodBias, 0, MAX_LODS - 1))
+              renderSystem->setShadowLodBias(static_cast<uint32_t>(shadowLodBias));
+            ImGui::Text("Render CPU: %.3f ms", renderStats.cpuMs);
+
+            ImGui::BeginDisabled(!renderSystem->canGpuDrive());
+            bool bGpuDriven = renderSystem->isGpuDriven();
+            if (ImGui::Checkbox("GPU-driven draws (indirect)", &bGpuDriven))
+              renderSystem->setGpuDriven(bGpuDriven);
+            ImGui::EndDisabled();
+            if (renderSystem->isGpuDriven())
+              ImGui::TextDisabled("GPU scene: %u meshes, %u rows uploaded. Their culling and LODs are not counted above",
+                  renderStats.gpuObjects, renderStats.gpuRowUploads);
+
+            const auto geometryStats = geometryArena.getStats();
+            ImGui::Text("Geometry: %u meshes in %u blocks, %.1f / %.1f MB", geometryStats.allocations, geometryStats.blocks,
+                geometryStats.usedBytes / (1024.0f * 1024.0f), geometryStats.capacityBytes / (1024.0f * 1024.0f));
+            ImGui::Text("Free ranges: %u  Fragmentation: %.1f%%", geometryStats.freeRanges, geometryStats.fragmentation * 100.0f);
+            if (ImGui::Button("Defragment geometry"))
+              geometryArena.defragment();
+
+            const auto streamingStats = assetStreamer.getStats();
+            ImGui::Text("Streaming: %u decoding, %u waiting, %u uploading  Resident: %u  Failed: %u",
+                streamingStats.queued, streamingStats.decoded, streamingStats.uploading,
+                streamingStats.resident, streamingStats.failed);
+
+            const auto cacheStats = assetCache.getStats();
+            ImGui::Text("Asset cache: %u models, %u textures, %u samplers  Retired: %u", cacheStats.models,
+                cacheStats.textures, cacheStats.samplers, cacheStats.retired);
+            ImGui::Text("Texture hits: %u  misses: %u  Model hits: %u", cacheStats.textureHits, cacheStats.textureMisses,
+                cacheStats.modelHits);
+
+            const auto memoryStats = ntDevice.getMemoryAllocator().getStats();
+            ImGui::Text("Device memory: %u vkAllocateMemory (%u blocks, %u dedicated)", memoryStats.deviceAllocations,
+                memoryStats.blocks, memoryStats.dedicated);
+            ImGui::Text("Blocks: %u allocations, %.1f / %.1f MB (%.1f MB requested)", memoryStats.allocations,
+                memoryStats.usedBytes / (1024.0f * 1024.0f), memoryStats.blockBytes / (1024.0f * 1024.0f),
+                memoryStats.requestedBytes / (1024.0f * 1024.0f));
+            ImGui::Text("Dedicated: %.1f MB  Fragmentation: %.1f%%", memoryStats.dedicatedBytes / (1024.0f * 1024.0f),
+                memoryStats.fragmentation * 100.0f);
+
+            if (ImGui::BeginTable("SystemTimings", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+                ImGui::TableSetupColumn("System");
+                ImGui::TableSetupColumn("Start (ms)");
+                ImGui::TableSetupColumn("Duration (ms)");
+                ImGui::TableHeadersRow();
+                for (const auto& timing : schedulerStats.systems) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s%s", timing.name.c_str(), timing.bMainThread ? " (main)" : "");
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", timing.startMs);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", timing.durationMs);
+                }
+                ImGui::EndTable();
+            }
+
+          ImGui::TreePop();
+        }
+
         if (ImGui::TreeNode("Physics")) {
             static bool bPhysicsVisualize = physicsSystem->isDebugDrawEnabled();
             ImGui::Checkbox("Visualize colliders", &bPhysicsVisualize);
@@ -490,7 +649,7 @@ void AstralApp::run()
             filter.Draw("##");
             for (auto const& entity : debugSystem->entities )
             {
-                std::string displayName = Nexus.GetComponent<cMeta>(entity).name + " (id=" + std::to_string(entity) + ")";
+                std::string displayName = Nexus.GetComponent<const cMeta>(entity).name + " (id=" + std::to_string(entity) + ")";
                 if (filter.PassFilter(displayName.c_str())) {
                     if (ImGui::Selectable(displayName.c_str(), selectedEntityID == entity))
                         selectedEntityID = entity;
@@ -500,15 +659,16 @@ void AstralApp::run()
         ImGui::End();
 
         if (ImGui::Begin("Selected Entity")) {
-            if (selectedEntityID >= 0) {
-                ImGui::Text("Entity ID: %d", selectedEntityID);
+            if (Nexus.IsAlive(selectedEntityID)) {
+                ImGui::Text("Entity ID: %u (index %u, generation %u)", selectedEntityID,
+                    EntityIndex(selectedEntityID), EntityGeneration(selectedEntityID));
                 ImGui::Separator();
 
                 static ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg;
 
                 // Check and display each component type
                 if (Nexus.HasComponent<cMeta>(selectedEntityID)) {
-                    auto& meta = Nexus.GetComponent<cMeta>(selectedEntityID);
+                    auto const& meta = Nexus.GetComponent<const cMeta>(selectedEntityID);
                     ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Meta");
                     if (ImGui::BeginTable("MetaComponent", 2, flags)) {
                         ImGui::TableNextRow();
@@ -522,37 +682,40 @@ void AstralApp::run()
                 }
 
                 if (Nexus.HasComponent<cTransform>(selectedEntityID)) {
-                    auto& transform = Nexus.GetComponent<cTransform>(selectedEntityID);
+                    // Edited on a copy, written back only when changed, so looking doesn't mark it moved
+                    cTransform transform = Nexus.GetComponent<const cTransform>(selectedEntityID);
+                    bool bEdited = false;
                     ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Transform");
                     if (ImGui::BeginTable("TransformComponent", 2, flags)) {
                         ImGui::TableNextRow();
                         ImGui::TableSetColumnIndex(0);
                         ImGui::TextUnformatted("Position");
                         ImGui::TableSetColumnIndex(1);
-                        ImGui::InputFloat3("##position", (float*)&transform.translation);
+                        bEdited |= ImGui::InputFloat3("##position", (float*)&transform.translation);
                         // ImGui::Text("%.1f, %.1f, %.1f", transform.translation.x, transform.translation.y, transform.translation.z);
 
                         ImGui::TableNextRow();
                         ImGui::TableSetColumnIndex(0);
                         ImGui::TextUnformatted("Rotation");
                         ImGui::TableSetColumnIndex(1);
-                        ImGui::InputFloat3("##rotation", (float*)&transform.rotation);
+                        bEdited |= ImGui::InputFloat3("##rotation", (float*)&transform.rotation);
                         // ImGui::Text("%.1f, %.1f, %.1f", transform.rotation.x, transform.rotation.y, transform.rotation.z);
 
                         ImGui::TableNextRow();
                         ImGui::TableSetColumnIndex(0);
                         ImGui::TextUnformatted("Scale");
                         ImGui::TableSetColumnIndex(1);
-                        ImGui::InputFloat3("##scale", (float*)&transform.scale);
+                        bEdited |= ImGui::InputFloat3("##scale", (float*)&transform.scale);
                         // ImGui::Text("%.1f, %.1f, %.1f", transform.scale.x, transform.scale.y, transform.scale.z);
 
                         ImGui::EndTable();
                     }
+                    if (bEdited) Nexus.GetComponent<cTransform>(selectedEntityID) = transform;
                     ImGui::Spacing();
                 }
 
                 if (Nexus.HasComponent<cModel>(selectedEntityID)) {
-                    auto& model = Nexus.GetComponent<cModel>(selectedEntityID);
+                    auto const& model = Nexus.GetComponent<const cModel>(selectedEntityID);
                     ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Model");
                     if (ImGui::BeginTable("ModelComponent", 2, flags)) {
                         ImGui::TableNextRow();
@@ -561,40 +724,48 @@ void AstralApp::run()
                         ImGui::TableSetColumnIndex(1);
                         ImGui::Text("%d", model.bDropShadow);
 
-                        ImGui::TableNextRow();
-                        ImGui::TableSetColumnIndex(0);
-                        ImGui::TextUnformatted("Material:");
-                        ImGui::TableSetColumnIndex(1);
-                        static std::string matType;
-                        switch (model.mesh->getMaterialType())
-                        {
-                            case MaterialType::PBR:        matType="PBR"; break;
-                            case MaterialType::NPR:        matType="NPR"; break;
-                            case MaterialType::UNLIT:        matType="UNLIT"; break;
-                            case MaterialType::SCROLLING_UV:        matType="SCROLLING_UV"; break;
-                            case MaterialType::SHADOW_MAP:        matType="SHADOW_MAP"; break;
-                            default:                       matType="Unknown"; break;
-                        }
-                        ImGui::Text("%s", matType.c_str());
-
-                        if (model.mesh->hasSkeleton()) {
+                        if (!model.mesh) {
                             ImGui::TableNextRow();
                             ImGui::TableSetColumnIndex(0);
-                            ImGui::TextUnformatted("Skeleton bones:");
+                            ImGui::TextUnformatted("Streaming:");
                             ImGui::TableSetColumnIndex(1);
-                            ImGui::Text("%d", model.mesh->getBonesCount());
-                        }
-                        if (model.mesh->getAnimations().size() > 0) {
+                            ImGui::TextUnformatted(model.mesh.getState() == NtAssetState::Failed ? "Failed" : "Loading");
+                        } else {
                             ImGui::TableNextRow();
                             ImGui::TableSetColumnIndex(0);
-                            ImGui::TextUnformatted("Animations:");
+                            ImGui::TextUnformatted("Material:");
                             ImGui::TableSetColumnIndex(1);
-                            std::string animationList = join (
-                                model.mesh->getAnimations(),
-                                ", ",
-                                [](const NtAnimation& anim) { return anim.name; }
-                            );
-                            ImGui::Text("%s", animationList.c_str());
+                            static std::string matType;
+                            switch (model.mesh->getMaterialType())
+                            {
+                                case MaterialType::PBR:        matType="PBR"; break;
+                                case MaterialType::NPR:        matType="NPR"; break;
+                                case MaterialType::UNLIT:        matType="UNLIT"; break;
+                                case MaterialType::SCROLLING_UV:        matType="SCROLLING_UV"; break;
+                                case MaterialType::SHADOW_MAP:        matType="SHADOW_MAP"; break;
+                                default:                       matType="Unknown"; break;
+                            }
+                            ImGui::Text("%s", matType.c_str());
+
+                            if (model.mesh->hasSkeleton()) {
+                                ImGui::TableNextRow();
+                                ImGui::TableSetColumnIndex(0);
+                                ImGui::TextUnformatted("Skeleton bones:");
+                                ImGui::TableSetColumnIndex(1);
+                                ImGui::Text("%d", model.mesh->getBonesCount());
+                            }
+                            if (model.mesh->getAnimations().size() > 0) {
+                                ImGui::TableNextRow();
+                                ImGui::TableSetColumnIndex(0);
+                                ImGui::TextUnformatted("Animations:");
+                                ImGui::TableSetColumnIndex(1);
+                                std::string animationList = join (
+                                    model.mesh->getAnimations(),
+                                    ", ",
+                                    [](const NtAnimation& anim) { return anim.name; }
+                                );
+                                ImGui::Text("%s", animationList.c_str());
+                            }
                         }
                         ImGui::EndTable();
                     }
@@ -602,7 +773,7 @@ void AstralApp::run()
                 }
 
                 if (Nexus.HasComponent<cAnimator>(selectedEntityID)) {
-                    auto& animatorComp = Nexus.GetComponent<cAnimator>(selectedEntityID);
+                    auto const& animatorComp = Nexus.GetComponent<const cAnimator>(selectedEntityID);
                     ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Animator");
                     if (ImGui::BeginTable("AnimatorComponent", 2, flags)) {
                         ImGui::TableNextRow();
@@ -627,7 +798,8 @@ void AstralApp::run()
                 }
 
                 if (Nexus.HasComponent<cLight>(selectedEntityID)) {
-                    auto& light = Nexus.GetComponent<cLight>(selectedEntityID);
+                    cLight light = Nexus.GetComponent<const cLight>(selectedEntityID);
+                    bool bEdited = false;
                     ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Light");
                     if (ImGui::BeginTable("LightComponent", 2, flags)) {
                         ImGui::TableNextRow();
@@ -647,27 +819,28 @@ void AstralApp::run()
                         ImGui::TableSetColumnIndex(0);
                         ImGui::TextUnformatted("Intensity");
                         ImGui::TableSetColumnIndex(1);
-                        ImGui::InputFloat("##intensity", &light.intensity);
+                        bEdited |= ImGui::InputFloat("##intensity", &light.intensity);
 
                         ImGui::TableNextRow();
                         ImGui::TableSetColumnIndex(0);
                         ImGui::TextUnformatted("Color");
                         ImGui::TableSetColumnIndex(1);
-                        ImGui::ColorEdit3("##lightcolor", (float*)&light.color);
+                        bEdited |= ImGui::ColorEdit3("##lightcolor", (float*)&light.color);
 
                         ImGui::TableNextRow();
                         ImGui::TableSetColumnIndex(0);
                         ImGui::TextUnformatted("Cast Shadows");
                         ImGui::TableSetColumnIndex(1);
-                        ImGui::Checkbox("##castshadows", &light.bCastShadows);
+                        bEdited |= ImGui::Checkbox("##castshadows", &light.bCastShadows);
 
                         ImGui::EndTable();
                     }
+                    if (bEdited) Nexus.GetComponent<cLight>(selectedEntityID) = light;
                     ImGui::Spacing();
                 }
 
                 if (Nexus.HasComponent<cCamera>(selectedEntityID)) {
-                    auto& camera = Nexus.GetComponent<cCamera>(selectedEntityID);
+                    auto const& camera = Nexus.GetComponent<const cCamera>(selectedEntityID);
                     ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Camera");
                     if (ImGui::BeginTable("CameraComponent", 2, flags)) {
                         ImGui::TableNextRow();
@@ -712,7 +885,7 @@ void AstralApp::run()
                 }
 
                 if (Nexus.HasComponent<cPlayerController>(selectedEntityID)) {
-                    auto& plController = Nexus.GetComponent<cPlayerController>(selectedEntityID);
+                    auto const& plController = Nexus.GetComponent<const cPlayerController>(selectedEntityID);
                     ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Player Controller");
                     if (ImGui::BeginTable("PlayerControllerComponent", 2, flags)) {
                         ImGui::TableNextRow();
@@ -738,14 +911,30 @@ void AstralApp::run()
         }
     // ---
 
-// Input update
-    inputSystem->update(deltaTime, io.MouseWheel);
+// Assets released long enough ago that no frame in flight can still use them
+    assetCache.collect();
+
+// Streamed assets: hand decoded models to the GPU, publish the ones whose uploads completed
+    assetStreamer.update();
+
+// Systems update
+    // Scheduled by component access: input -> physics -> camera/lights, animation alongside.
+    // Camera and lights write separate parts of the UBO.
+    systemScheduler.Add("Input", inputAccess, [&] { inputSystem->update(deltaTime, io.MouseWheel); });
+    systemScheduler.Add("Physics", physicsAccess, [&] { physicsSystem->update(deltaTime); });
+    systemScheduler.Add("Camera", cameraAccess, [&] { cameraSystem->update(ubo.projection, ubo.view, ubo.inverseView); });
+    systemScheduler.Add("Lights", lightAccess, [&] { lightSystem->updateLights(ubo, OrthoScale, OrthoNear, OrthoFar); });
+    systemScheduler.Add("Animation", animationAccess, [&] { animationSystem->update(deltaTime, &jobSystem); });
+    systemScheduler.Run();
 
-// Physics update
-    physicsSystem->update(deltaTime);
+// Structural changes recorded by systems this frame
+    Nexus.FlushCommands();
 
-// Camera update
-    cameraSystem->update(ubo.projection, ubo.view, ubo.inverseView);
+// World matrices for everything that moved, after all transform writes and structural changes
+    transformSystem->update();
+
+// Draw list for both passes, sorted by state
+    renderSystem->prepare(ubo);
 
 // EVERY FRAME
     if (auto commandBuffer = ntRenderer.beginFrame()) {
@@ -759,16 +948,22 @@ void AstralApp::run()
       };
 
     // UBO
-      // Lighting
-      lightSystem->updateLights(frameInfo, ubo, OrthoScale, OrthoNear, OrthoFar);
-
       // Write the UBOs
       uboBuffers[frameIndex]->writeToBuffer(&ubo);
       uboBuffers[frameIndex]->flush();
-      // ---
 
-// ANIMATION
-    animationSystem->update(deltaTime);
+      // Instances
+      const auto& instances = renderSystem->getInstances();
+      if (!instances.empty()) {
+        const VkDeviceSize instanceBytes = instances.size() * sizeof(NtInstanceData);
+        instanceBuffers[frameIndex]->writeToBuffer((void*)instances.data(), instanceBytes);
+        instanceBuffers[frameIndex]->flush();
+      }
+
+      // Skinned vertices for both passes
+      renderSystem->dispatchSkinning(frameInfo);
+      // GPU-driven frames cull their scene in a compute pass and add its visible instances
+      renderSystem->dispatchCulling(frameInfo);
       // ---
 
     // RENDERING
@@ -1,13 +1,17 @@
 #pragma once
 
+#include "nt_asset_streamer.hpp"
 #include "nt_ecs.hpp"
 #include "nt_material.hpp"
 #include "nt_shadows.hpp"
 #include "nt_window.hpp"
 #include "nt_device.hpp"
 #include "nt_renderer.hpp"
+#include "nt_geometry_arena.hpp"
 #include "nt_descriptors.hpp"
 #include "nt_im3d_renderer.hpp"
+#include "nt_job_system.hpp"
+#include "nt_scheduler.hpp"
 
 #include <filesystem>
 #include <memory>
@@ -41,30 +45,46 @@ namespace nt
 
 	private:
     // Helper functions
-    std::unique_ptr<NtModel> createModelFromFile(const std::string &filepath, MaterialType type = MaterialType::PBR) {
-        return NtModel::createModelFromFile(
+    std::shared_ptr<NtModel> createModelFromFile(const std::string &filepath, MaterialType type = MaterialType::PBR) {
+        return assetCache.share(NtModel::createModelFromFile(
             ntDevice,
+            geometryArena,
             filepath,
             type,
             modelSetLayout->getDescriptorSetLayout(),
             modelPool->getDescriptorPool(),
-            boneSetLayout->getDescriptorSetLayout(),
-            bonePool->getDescriptorPool());
+            &assetCache));
     };
-    std::unique_ptr<NtModel> createPlane(float size, const std::string &filepath, MaterialType type = MaterialType::PBR) {
-        return NtModel::createPlane(
+    // Returns right away, the model shows up once it is resident
+    NtModelHandle streamModelFromFile(const std::string &filepath, MaterialType type = MaterialType::PBR) {
+        return assetStreamer.loadModel(
+            filepath,
+            type,
+            modelSetLayout->getDescriptorSetLayout(),
+            modelPool->getDescriptorPool());
+    };
+    std::shared_ptr<NtModel> createPlane(float size, const std::string &filepath, MaterialType type = MaterialType::PBR) {
+        return assetCache.share(NtModel::createPlane(
             ntDevice,
+            geometryArena,
             size,
             filepath,
             type,
             modelSetLayout->getDescriptorSetLayout(),
-            modelPool->getDescriptorPool());
+            modelPool->getDescriptorPool(),
+            &assetCache));
     };
 
     NtWindow ntWindow{ WIDTH, HEIGHT, "🌋 You are wandering through the Astral Realm.." };
     NtDevice ntDevice{ntWindow};
     NtRenderer ntRenderer{ntWindow, ntDevice};
 
+    // Vertex and index data of every model, must outlive them
+    NtGeometryArena geometryArena{ntDevice};
+    // Shared models, textures and samplers, must outlive everything that holds them
+    NtAssetCache assetCache{ntDevice};
+    NtAssetStreamer assetStreamer{ntDevice, geometryArena, assetCache};
+
     // Descriptors
     std::unique_ptr<NtDescriptorPool> globalPool{};
     std::unique_ptr<NtDescriptorSetLayout> globalSetLayout;
@@ -80,5 +100,9 @@ namespace nt
     std::unique_ptr<NtIm3dRenderer> im3dRenderer;
 
     NtNexus Nexus;
+
+    // Worker pool shared by the system scheduler and systems that split their own work
+    NtJobSystem jobSystem;
+    NtSystemScheduler systemScheduler{jobSystem};
 	};
 }
@@ -3,16 +3,32 @@
 namespace nt
 {
 
-void AnimationSystem::update(float dt) {
-  for (auto const& entity : entities) {
-    if (!nexus->HasComponent<cModel>(entity)) continue;
-    if (!nexus->HasComponent<cAnimator>(entity)) continue;
+void AnimationSystem::update(float dt, NtJobSystem* jobSystem) {
+  animated.clear();
+  nexus->View<const cModel, cAnimator>().Each([&](const cModel& model, cAnimator& animator) {
+    if (!model.mesh || !model.mesh->hasSkeleton()) return;
 
-    auto& model = nexus->GetComponent<cModel>(entity);
-    auto& animator = nexus->GetComponent<cAnimator>(entity);
+    // Poses for models that became resident, here on one thread since the bone pool is not thread-safe
+    NtSkeletonPose& pose = animator.animator->getPose();
+    if (!pose.isCreatedFor(*model.mesh)) {
+      pose.create(ntDevice, *model.mesh, boneLayout, bonePool);
+    }
+    animated.emplace_back(&model, &animator);
+  });
 
-    animator.animator->update(*model.mesh, dt);
-    model.mesh->updateSkeleton();
+  // Models are shared, each animator only writes its own pose
+  auto updateRange = [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; ++i) {
+      auto& [model, animator] = animated[i];
+      animator->animator->update(*model->mesh, dt);
+      animator->animator->getPose().update(*model->mesh);
+    }
+  };
+
+  if (jobSystem) {
+    jobSystem->ParallelFor(static_cast<uint32_t>(animated.size()), 8, updateRange);
+  } else {
+    updateRange(0, static_cast<uint32_t>(animated.size()));
   }
 }
 
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "nt_device.hpp"
 #include "nt_ecs.hpp"
+#include "nt_job_system.hpp"
 
 namespace nt
 {
@@ -8,13 +10,23 @@ namespace nt
 class AnimationSystem : public NtSystem
 {
 public:
-    AnimationSystem(NtNexus* nexus_ptr) : nexus(nexus_ptr) {};
+    // Every animated entity gets its own bone buffer and descriptor set from the pool
+    AnimationSystem(NtNexus* nexus_ptr, NtDevice& device, VkDescriptorSetLayout boneLayout, VkDescriptorPool bonePool)
+        : nexus(nexus_ptr), ntDevice(device), boneLayout(boneLayout), bonePool(bonePool) {};
     ~AnimationSystem() {};
 
-    void update(float dt);
+    // Animators are independent of each other, so with a job system they are
+    // split into ranges and updated across the worker pool
+    void update(float dt, NtJobSystem* jobSystem = nullptr);
 
 private:
     NtNexus* nexus;
+    NtDevice& ntDevice;
+    VkDescriptorSetLayout boneLayout;
+    VkDescriptorPool bonePool;
+
+    // Reused every frame to hand ranges of animated models to the workers
+    std::vector<std::pair<const cModel*, cAnimator*>> animated;
 };
 
 }
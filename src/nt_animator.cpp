@@ -1,5 +1,6 @@
 #include "nt_animator.hpp"
 #include "nt_log.hpp"
+#include <algorithm>
 #include <cmath>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
@@ -7,12 +8,152 @@
 #include <glm/gtx/matrix_decompose.hpp>
 #include <iostream>
 #include <ostream>
+#include <stdexcept>
 #include <vector>
 
 #include "nt_model.hpp"
+#include "nt_swap_chain.hpp"
 
 namespace nt {
 
+void NtSkeletonPose::create(NtDevice& device, const NtModel& model, VkDescriptorSetLayout boneLayout, VkDescriptorPool bonePool) {
+    owner = &model;
+    bones.clear();
+    jointMatrices.clear();
+    boneBuffer.reset();
+    skinnedVertices.reset();
+    meshVertexOffsets.clear();
+    skinnedVertexCount = 0;
+    descriptorSet = VK_NULL_HANDLE;
+
+    const auto& skeleton = model.getSkeleton();
+    if (!skeleton.has_value() || skeleton->bones.empty()) return;
+
+    const size_t boneCount = skeleton->bones.size();
+    bones.resize(boneCount);
+    for (size_t boneIndex = 0; boneIndex < boneCount; ++boneIndex) {
+        const NtModel::Bone& bone = skeleton->bones[boneIndex];
+        bones[boneIndex] = {bone.restTranslation, bone.restRotation, bone.restScale};
+    }
+    jointMatrices.resize(boneCount, glm::mat4(1.0f));
+
+    // Buffer for bone matrices, identity until the first update
+    boneBuffer = std::make_unique<NtBuffer>(
+        device,
+        sizeof(glm::mat4),
+        static_cast<uint32_t>(boneCount),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    );
+    boneBuffer->map();
+    boneBuffer->writeToBuffer(jointMatrices.data());
+    boneBuffer->flush();
+
+    // Skinned copies of every mesh, one set per frame in flight so a frame never overwrites
+    // vertices the one before it still draws
+    meshVertexOffsets.resize(model.getMeshCount());
+    for (uint32_t meshIndex = 0; meshIndex < model.getMeshCount(); ++meshIndex) {
+        meshVertexOffsets[meshIndex] = skinnedVertexCount;
+        skinnedVertexCount += model.getGeometry(meshIndex).vertexCount;
+    }
+    skinnedVertices = std::make_unique<NtBuffer>(
+        device,
+        sizeof(NtModel::StaticVertex),
+        std::max(skinnedVertexCount, 1u) * NtSwapChain::MAX_FRAMES_IN_FLIGHT,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    );
+
+    auto bufferInfo = boneBuffer->descriptorInfo();
+    auto skinnedInfo = skinnedVertices->descriptorInfo();
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = bonePool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &boneLayout;
+
+    if (vkAllocateDescriptorSets(device.device(), &allocInfo, &descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate bone descriptor set!");
+    }
+
+    VkWriteDescriptorSet descriptorWrites[2]{};
+    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstSet = descriptorSet;
+    descriptorWrites[0].dstBinding = 0;
+    descriptorWrites[0].dstArrayElement = 0;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+    descriptorWrites[1] = descriptorWrites[0];
+    descriptorWrites[1].dstBinding = 1;
+    descriptorWrites[1].pBufferInfo = &skinnedInfo;
+
+    vkUpdateDescriptorSets(device.device(), 2, descriptorWrites, 0, nullptr);
+}
+
+void NtSkeletonPose::update(const NtModel& model) {
+    if (!boneBuffer || !isCreatedFor(model)) return;
+    const NtModel::Skeleton& skeleton = *model.getSkeleton();
+    if (bones.size() != skeleton.bones.size()) return;
+
+    // Packed positions in, positions in the skinned box out
+    const glm::mat4& positionDecode = model.getPositionDecode();
+    const glm::mat4 skinnedEncode = glm::inverse(model.getSkinnedPositionDecode());
+
+    const int16_t numberOfBones = static_cast<int16_t>(bones.size());
+
+    if (!skeleton.isAnimated) // used for debugging to check if the model renders w/o deformation
+    {
+        for (int16_t boneIndex = 0; boneIndex < numberOfBones; ++boneIndex)
+        {
+            jointMatrices[boneIndex] = skinnedEncode * positionDecode;
+        }
+    }
+    else
+    {
+        // STEP 1: apply animation results
+        for (int16_t boneIndex = 0; boneIndex < numberOfBones; ++boneIndex)
+        {
+            const BoneTransform& transform = bones[boneIndex];
+            jointMatrices[boneIndex] = glm::translate(glm::mat4(1.0f), transform.translation) * // T
+                                       glm::mat4(transform.rotation) *                          // R
+                                       glm::scale(glm::mat4(1.0f), transform.scale) *           // S
+                                       skeleton.bones[boneIndex].initialNodeMatrix;
+        }
+
+        // STEP 2: recursively update final joint matrices
+        updateJoint(skeleton, 0);
+
+        // STEP 3: from the packed vertex positions, through model space, into the skinned box
+        for (int16_t boneIndex = 0; boneIndex < numberOfBones; ++boneIndex)
+        {
+            jointMatrices[boneIndex] = skinnedEncode * jointMatrices[boneIndex] *
+                                       skeleton.bones[boneIndex].inverseBindMatrix * positionDecode;
+        }
+    }
+
+    boneBuffer->writeToBuffer(jointMatrices.data());
+    boneBuffer->flush();
+}
+
+// Traverses the skeleton from the root, so a joint's parent is always final before the joint
+void NtSkeletonPose::updateJoint(const NtModel::Skeleton& skeleton, int16_t boneIndex) {
+    const auto& currentBone = skeleton.bones[boneIndex];
+
+    int16_t parentBone = currentBone.parentIndex;
+    if (parentBone != -1)
+    {
+        jointMatrices[boneIndex] = jointMatrices[parentBone] * jointMatrices[boneIndex];
+    }
+
+    for (int childJoint : currentBone.childrenIndices)
+    {
+        updateJoint(skeleton, static_cast<int16_t>(childJoint));
+    }
+}
+
 void NtAnimator::play(const std::string& animationName, bool loop) {
     currentAnimationName = animationName;
     currentTime = 0.0f;
@@ -21,8 +162,8 @@ void NtAnimator::play(const std::string& animationName, bool loop) {
     cachedDuration = -1.0f;
 }
 
-void NtAnimator::update(NtModel& model, float deltaTime) {
-    if (!isPlaying || !model.hasSkeleton()) return;
+void NtAnimator::update(const NtModel& model, float deltaTime) {
+    if (!isPlaying || !pose.isCreatedFor(model) || pose.getBones().empty()) return;
 
     // Find animation by name
     const NtAnimation* animation = findAnimation(model, currentAnimationName);
@@ -42,9 +183,7 @@ void NtAnimator::update(NtModel& model, float deltaTime) {
         }
     }
 
-    std::optional<NtModel::Skeleton>& skeletonOpt = const_cast<std::optional<NtModel::Skeleton>&>(model.getSkeleton());
-    if (!skeletonOpt.has_value()) return;
-    NtModel::Skeleton& skeleton = skeletonOpt.value();
+    std::vector<NtSkeletonPose::BoneTransform>& bones = pose.getBones();
 
     // Update node TRS from animation
     for (size_t chanIdx = 0; chanIdx < animation->channels.size(); ++chanIdx) {
@@ -55,25 +194,25 @@ void NtAnimator::update(NtModel& model, float deltaTime) {
             continue;
         }
 
-        if (channel.targetNode >= static_cast<int>(skeleton.bones.size())) {
-            NT_LOG_ERROR(LogAnimation, "[ANIM ERROR] Target node {} out of range (joints size: {})", channel.targetNode, skeleton.bones.size());
+        if (channel.targetNode >= static_cast<int>(bones.size())) {
+            NT_LOG_ERROR(LogAnimation, "[ANIM ERROR] Target node {} out of range (joints size: {})", channel.targetNode, bones.size());
             continue;
         }
 
         const NtAnimationSampler& sampler = animation->samplers[channel.samplerIndex];
         glm::vec4 value = interpolateSampler(sampler, currentTime);
 
-        NtModel::Bone& targetBone = skeleton.bones[channel.targetNode];
+        NtSkeletonPose::BoneTransform& targetBone = bones[channel.targetNode];
 
         switch (channel.path) {
             case NtAnimationChannel::TRANSLATION:
-                targetBone.animatedNodeTranslation = glm::vec3(value);
+                targetBone.translation = glm::vec3(value);
                 break;
             case NtAnimationChannel::ROTATION:
-                targetBone.animatedNodeRotation = glm::quat(value.w, value.x, value.y, value.z);
+                targetBone.rotation = glm::quat(value.w, value.x, value.y, value.z);
                 break;
             case NtAnimationChannel::SCALE:
-                targetBone.animatedNodeScale = glm::vec3(value);
+                targetBone.scale = glm::vec3(value);
                 break;
                 }
         }
@@ -1,21 +1,74 @@
 #pragma once
 
 #include "nt_animation.hpp"
+#include "nt_buffer.hpp"
+#include "nt_device.hpp"
 #include "nt_model.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/fwd.hpp>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace nt {
 
+// The animated state of one entity's skeleton: bone transforms, joint matrices,
+// the bone buffer the skinning pass reads and the vertices it skins into, one
+// copy per frame in flight. Models are shared between entities, their skeleton
+// only holds the bind pose.
+class NtSkeletonPose {
+public:
+    struct BoneTransform {
+        glm::vec3 translation{0.0f};
+        glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+        glm::vec3 scale{1.0f};
+    };
+
+    // Resets to the model's rest pose. Allocates from the bone pool, which is not thread-safe.
+    // boneLayout is binding 0 bones, binding 1 skinned vertices.
+    void create(NtDevice &device, const NtModel &model, VkDescriptorSetLayout boneLayout, VkDescriptorPool bonePool);
+    bool isCreatedFor(const NtModel &model) const { return owner == &model; }
+
+    std::vector<BoneTransform>& getBones() { return bones; }
+    // Joint matrices from the bone transforms, written to the bone buffer. They take packed
+    // positions to the model's skinned position box, see NtModel::getSkinnedPositionDecode().
+    void update(const NtModel &model);
+
+    VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+    bool hasSkinnedVertices() const { return skinnedVertices != nullptr; }
+
+    // Where the skinning pass writes a mesh's vertices in a frame, as NtModel::StaticVertex
+    VkBuffer getSkinnedBuffer() const { return skinnedVertices->getBuffer(); }
+    uint32_t getSkinnedVertex(int frameIndex, uint32_t meshIndex) const {
+        return static_cast<uint32_t>(frameIndex) * skinnedVertexCount + meshVertexOffsets[meshIndex];
+    }
+    VkDeviceSize getSkinnedOffset(int frameIndex, uint32_t meshIndex) const {
+        return VkDeviceSize{getSkinnedVertex(frameIndex, meshIndex)} * sizeof(NtModel::StaticVertex);
+    }
+
+private:
+    void updateJoint(const NtModel::Skeleton &skeleton, int16_t boneIndex);
+
+    const NtModel* owner = nullptr;
+    std::vector<BoneTransform> bones;
+    std::vector<glm::mat4> jointMatrices;
+    std::unique_ptr<NtBuffer> boneBuffer;
+    std::unique_ptr<NtBuffer> skinnedVertices;
+    std::vector<uint32_t> meshVertexOffsets;
+    uint32_t skinnedVertexCount = 0;    // Per frame, over all meshes
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+};
+
 class NtAnimator {
 public:
     NtAnimator() = default;
 
     void play(const std::string &animationName, bool loop = false);
-    void update(NtModel &model, float deltaTime);
+    // Advances the current animation and writes it into the pose
+    void update(const NtModel &model, float deltaTime);
+
+    NtSkeletonPose& getPose() { return pose; }
 
     bool getIsPlaying() const { return isPlaying; }
     std::string getCurrentAnimationName() const { return currentAnimationName; }
@@ -32,8 +85,9 @@ private:
     float cachedDuration = -1.0f;;
     bool isLooping = true;
     bool isPlaying = false;
+    NtSkeletonPose pose;
 
-    const NtAnimation* findAnimation(NtModel& model, const std::string& name) {
+    const NtAnimation* findAnimation(const NtModel& model, const std::string& name) {
         for (const auto& anim : model.getAnimations()) {
             if (anim.name == name) return &anim;
         }
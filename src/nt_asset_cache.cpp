@@ -0,0 +1,187 @@
+#include "nt_asset_cache.hpp"
+#include "nt_log.hpp"
+#include "nt_swap_chain.hpp"
+#include "nt_upload_batch.hpp"
+
+#include <filesystem>
+#include <stdexcept>
+
+namespace nt
+{
+
+NtAssetCache::NtAssetCache(NtDevice& device) : ntDevice{device} {}
+
+NtAssetCache::~NtAssetCache() {
+    vkDeviceWaitIdle(ntDevice.device());
+
+    // Destroying an asset can retire the ones it held, e.g. a model its textures
+    for (;;) {
+        std::vector<Retired> destroying;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            destroying.swap(retired);
+        }
+        if (destroying.empty()) break;
+    }
+
+    for (auto& [settings, sampler] : samplers) {
+        vkDestroySampler(ntDevice.device(), sampler, nullptr);
+    }
+}
+
+VkSampler NtAssetCache::getSampler(const NtSamplerSettings& settings) {
+    std::lock_guard<std::mutex> lock{mutex};
+    for (const auto& [cached, sampler] : samplers) {
+        if (cached == settings) return sampler;
+    }
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = settings.magFilter;
+    samplerInfo.minFilter = settings.minFilter;
+    samplerInfo.addressModeU = settings.addressMode;
+    samplerInfo.addressModeV = settings.addressMode;
+    samplerInfo.addressModeW = settings.addressMode;
+    samplerInfo.anisotropyEnable = settings.bAnisotropy ? VK_TRUE : VK_FALSE;
+    samplerInfo.maxAnisotropy = settings.bAnisotropy ? ntDevice.properties.limits.maxSamplerAnisotropy : 1.0f;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.mipmapMode = settings.mipmapMode;
+    samplerInfo.mipLodBias = 0.0f;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    VkSampler sampler = VK_NULL_HANDLE;
+    if (vkCreateSampler(ntDevice.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create cached sampler!");
+    }
+    samplers.emplace_back(settings, sampler);
+    return sampler;
+}
+
+std::shared_ptr<NtImage> NtAssetCache::loadTexture(const std::string& filepath, bool isLinear, NtUploadBatch* batch) {
+    const std::string key = canonicalPath(filepath) + (isLinear ? "|linear" : "|srgb");
+    return findOrLoadTexture(key, batch, [&] {
+        return NtImage::createTextureFromFile(ntDevice, filepath, isLinear, batch, getSampler());
+    });
+}
+
+std::shared_ptr<NtImage> NtAssetCache::loadTexture(const void* data, size_t size, bool isLinear, NtUploadBatch* batch) {
+    // FNV-1a over the encoded bytes, the size goes into the key as well
+    uint64_t hash = 14695981039346656037ull;
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+
+    const std::string key = fmt::format("hash:{:016x}:{}", hash, size) + (isLinear ? "|linear" : "|srgb");
+    return findOrLoadTexture(key, batch, [&] {
+        return NtImage::createTextureFromMemory(ntDevice, data, size, isLinear, batch, getSampler());
+    });
+}
+
+template<typename Load>
+std::shared_ptr<NtImage> NtAssetCache::findOrLoadTexture(const std::string& key, NtUploadBatch* batch, Load&& load) {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        auto it = textures.find(key);
+        if (it != textures.end() && (it->second.pendingBatch == nullptr || it->second.pendingBatch == batch)) {
+            if (std::shared_ptr<NtImage> cached = it->second.image.lock()) {
+                ++textureHits;
+                return cached;
+            }
+        }
+    }
+
+    // Decoded outside the lock, so loaders decode in parallel
+    std::shared_ptr<NtImage> image = share(load());
+
+    std::lock_guard<std::mutex> lock{mutex};
+    ++textureMisses;
+    TextureEntry& entry = textures[key];
+    if (entry.image.expired()) {
+        entry.image = image;
+        entry.pendingBatch = batch;
+        if (batch) {
+            batch->onComplete([this, key, batch] {
+                std::lock_guard<std::mutex> lock{mutex};
+                auto it = textures.find(key);
+                if (it != textures.end() && it->second.pendingBatch == batch) {
+                    it->second.pendingBatch = nullptr;
+                }
+            });
+        }
+    }
+    return image;
+}
+
+std::shared_ptr<NtModelSlot> NtAssetCache::findModel(const std::string& key) {
+    std::lock_guard<std::mutex> lock{mutex};
+    auto it = models.find(key);
+    if (it == models.end()) return nullptr;
+
+    std::shared_ptr<NtModelSlot> slot = it->second.lock();
+    if (slot) ++modelHits;
+    return slot;
+}
+
+void NtAssetCache::addModel(const std::string& key, const std::shared_ptr<NtModelSlot>& slot) {
+    std::lock_guard<std::mutex> lock{mutex};
+    models[key] = slot;
+}
+
+std::string NtAssetCache::modelKey(const std::string& filepath, MaterialType matType) {
+    return canonicalPath(filepath) + "|" + std::to_string(static_cast<int>(matType));
+}
+
+void NtAssetCache::retire(std::shared_ptr<void> asset) {
+    std::lock_guard<std::mutex> lock{mutex};
+    retired.push_back({std::move(asset), frame});
+}
+
+void NtAssetCache::collect() {
+    // Destroyed on return, outside the lock: destroying a model retires its textures
+    std::vector<Retired> destroying;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        ++frame;
+
+        // Retired during frame N, the last frame that could have recorded it finishes by N + MAX_FRAMES_IN_FLIGHT
+        for (size_t i = 0; i < retired.size();) {
+            if (retired[i].frame + NtSwapChain::MAX_FRAMES_IN_FLIGHT < frame) {
+                destroying.push_back(std::move(retired[i]));
+                retired[i] = std::move(retired.back());
+                retired.pop_back();
+            } else {
+                ++i;
+            }
+        }
+
+        // Forget what expired, keys of streamed models and textures pile up otherwise
+        std::erase_if(textures, [](const auto& entry) { return entry.second.image.expired(); });
+        std::erase_if(models, [](const auto& entry) { return entry.second.expired(); });
+    }
+}
+
+NtAssetCacheStats NtAssetCache::getStats() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    NtAssetCacheStats stats;
+    stats.textures = static_cast<uint32_t>(textures.size());
+    stats.models = static_cast<uint32_t>(models.size());
+    stats.samplers = static_cast<uint32_t>(samplers.size());
+    stats.retired = static_cast<uint32_t>(retired.size());
+    stats.textureHits = textureHits;
+    stats.textureMisses = textureMisses;
+    stats.modelHits = modelHits;
+    return stats;
+}
+
+std::string NtAssetCache::canonicalPath(const std::string& filepath) {
+    std::error_code error;
+    const std::filesystem::path canonical = std::filesystem::weakly_canonical(filepath, error);
+    return error ? filepath : canonical.generic_string();
+}
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "nt_device.hpp"
+#include "nt_image.hpp"
+#include "nt_material.hpp"
+#include "vulkan/vulkan_core.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nt
+{
+
+class NtUploadBatch;
+struct NtModelSlot;
+
+//==============================
+// ASSET CACHE
+//==============================
+// Shares what several models (or the same model loaded twice) would otherwise
+// decode, upload and create again:
+//   - samplers, by their settings, for the lifetime of the cache,
+//   - textures, by canonical path and color space, or by content hash for
+//     images embedded in a glTF,
+//   - model slots, by canonical path and material type, for the streamer.
+// Cached assets are immutable once loaded. The cache only keeps weak
+// references: an asset goes away with its last user, but its GPU objects are
+// destroyed MAX_FRAMES_IN_FLIGHT collect() calls later, once no frame that
+// could still draw with them is in flight.
+
+struct NtSamplerSettings {
+    VkFilter magFilter = VK_FILTER_NEAREST;
+    VkFilter minFilter = VK_FILTER_NEAREST;
+    VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    bool bAnisotropy = true;
+
+    bool operator==(const NtSamplerSettings&) const = default;
+};
+
+struct NtAssetCacheStats {
+    uint32_t textures = 0;      // Alive
+    uint32_t models = 0;
+    uint32_t samplers = 0;
+    uint32_t retired = 0;       // Waiting for the frames in flight
+    uint32_t textureHits = 0;   // Since startup
+    uint32_t textureMisses = 0;
+    uint32_t modelHits = 0;
+};
+
+class NtAssetCache
+{
+public:
+    explicit NtAssetCache(NtDevice& device);
+    ~NtAssetCache();
+
+    NtAssetCache(const NtAssetCache&) = delete;
+    NtAssetCache& operator=(const NtAssetCache&) = delete;
+
+    // Everything below is thread-safe, loader threads go through the cache too
+
+    VkSampler getSampler(const NtSamplerSettings& settings = {});
+
+    // Same arguments as NtImage::createTextureFrom*. A texture still uploading in another
+    // batch is not shared, that batch could complete after the caller's.
+    std::shared_ptr<NtImage> loadTexture(const std::string& filepath, bool isLinear, NtUploadBatch* batch = nullptr);
+    std::shared_ptr<NtImage> loadTexture(const void* data, size_t size, bool isLinear, NtUploadBatch* batch = nullptr);
+
+    // Null when nothing alive is cached under the key
+    std::shared_ptr<NtModelSlot> findModel(const std::string& key);
+    void addModel(const std::string& key, const std::shared_ptr<NtModelSlot>& slot);
+    static std::string modelKey(const std::string& filepath, MaterialType matType);
+
+    // Shared ownership of an asset whose GPU objects are destroyed deferred
+    template<typename T>
+    std::shared_ptr<T> share(std::unique_ptr<T> asset) {
+        return std::shared_ptr<T>(asset.release(), [this](T* retiring) { retire(std::shared_ptr<void>(retiring)); });
+    }
+
+    // Main thread, once per frame: destroys what has been retired for long enough
+    void collect();
+
+    NtAssetCacheStats getStats() const;
+
+private:
+    struct TextureEntry {
+        std::weak_ptr<NtImage> image;
+        NtUploadBatch* pendingBatch = nullptr;  // Until the upload completes
+    };
+
+    struct Retired {
+        std::shared_ptr<void> asset;
+        uint64_t frame = 0;
+    };
+
+    template<typename Load>
+    std::shared_ptr<NtImage> findOrLoadTexture(const std::string& key, NtUploadBatch* batch, Load&& load);
+    void retire(std::shared_ptr<void> asset);
+
+    static std::string canonicalPath(const std::string& filepath);
+
+    NtDevice& ntDevice;
+
+    mutable std::mutex mutex;
+    std::vector<std::pair<NtSamplerSettings, VkSampler>> samplers;
+    std::unordered_map<std::string, TextureEntry> textures;
+    std::unordered_map<std::string, std::weak_ptr<NtModelSlot>> models;
+    std::vector<Retired> retired;
+    uint64_t frame = 0;
+
+    uint32_t textureHits = 0;
+    uint32_t textureMisses = 0;
+    uint32_t modelHits = 0;
+};
+
+}
@@ -0,0 +1,192 @@
+#include "nt_asset_streamer.hpp"
+#include "nt_log.hpp"
+#include "nt_upload_batch.hpp"
+
+#include <cassert>
+#include <stdexcept>
+#include <thread>
+
+namespace nt
+{
+
+//==============================
+// MODEL HANDLE
+//==============================
+
+NtModelHandle::NtModelHandle(std::shared_ptr<NtModel> model) {
+    if (!model) return;
+
+    slot = std::make_shared<NtModelSlot>();
+    slot->model = std::move(model);
+    slot->state.store(NtAssetState::Resident, std::memory_order_release);
+}
+
+const std::string& NtModelHandle::getPath() const {
+    static const std::string empty;
+    return slot ? slot->path : empty;
+}
+
+//==============================
+// ASSET STREAMER
+//==============================
+
+NtAssetStreamer::NtAssetStreamer(NtDevice& device, NtGeometryArena& arena, NtAssetCache& cache) : ntDevice{device},
+    geometryArena{arena}, assetCache{cache}, loaders{std::make_unique<NtJobSystem>(LOADER_THREADS)}
+{
+}
+
+NtAssetStreamer::~NtAssetStreamer() {
+    // Queued requests are dropped, the ones already decoding finish before the loaders join
+    bStopping = true;
+    loaders.reset();
+
+    // Textures and geometry must not go away under in-flight copies
+    for (auto& request : uploading) {
+        request->batch->wait();
+    }
+}
+
+NtModelHandle NtAssetStreamer::loadModel(const std::string& filepath, MaterialType matType,
+    VkDescriptorSetLayout materialLayout,
+    VkDescriptorPool materialPool)
+{
+    // Failed loads are retried, everything else shares the first request's slot
+    const std::string key = NtAssetCache::modelKey(filepath, matType);
+    if (auto slot = assetCache.findModel(key); slot && slot->state.load(std::memory_order_acquire) != NtAssetState::Failed) {
+        return NtModelHandle{std::move(slot)};
+    }
+
+    auto request = std::make_shared<Request>();
+    request->slot = std::make_shared<NtModelSlot>();
+    request->slot->path = filepath;
+    request->matType = matType;
+    request->materialLayout = materialLayout;
+    request->materialPool = materialPool;
+    request->startTime = std::chrono::high_resolution_clock::now();
+
+    NtModelHandle handle{request->slot};
+    assetCache.addModel(key, request->slot);
+
+    ++queuedCount;
+    loaders->Submit([this, request] { decode(request); });
+    return handle;
+}
+
+void NtAssetStreamer::decode(const std::shared_ptr<Request>& request) {
+    if (bStopping) {
+        --queuedCount;
+        return;
+    }
+
+    NtModelSlot& slot = *request->slot;
+    slot.state.store(NtAssetState::Decoding, std::memory_order_release);
+
+    try {
+        request->batch = std::make_unique<NtUploadBatch>(ntDevice);
+        request->builder = std::make_unique<NtModel::Builder>(ntDevice);
+        request->builder->uploadBatch = request->batch.get();
+        request->builder->assetCache = &assetCache;
+        request->builder->loadModel(slot.path);
+    } catch (const std::exception& e) {
+        NT_LOG_ERROR(LogAssets, "Failed to stream {}: {}", slot.path, e.what());
+        request->builder.reset();
+        request->batch.reset();
+        slot.state.store(NtAssetState::Failed, std::memory_order_release);
+        ++failedCount;
+        --queuedCount;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{decodedMutex};
+        decoded.push_back(request);
+    }
+    --queuedCount;
+}
+
+void NtAssetStreamer::submit(Request& request) {
+    // Geometry arena and descriptor pools are not thread-safe, this part stays on the main thread
+    request.model = NtModel::createFromBuilder(ntDevice, geometryArena, *request.builder, request.matType,
+        request.materialLayout, request.materialPool);
+    request.builder.reset();
+
+    request.batch->submit();
+    request.slot->state.store(NtAssetState::Uploading, std::memory_order_release);
+}
+
+void NtAssetStreamer::update() {
+    for (uint32_t i = 0; i < MAX_SUBMITS_PER_UPDATE; ++i) {
+        std::shared_ptr<Request> request;
+        {
+            std::lock_guard<std::mutex> lock{decodedMutex};
+            if (decoded.empty()) break;
+            request = std::move(decoded.front());
+            decoded.pop_front();
+        }
+
+        try {
+            submit(*request);
+            uploading.push_back(std::move(request));
+        } catch (const std::exception& e) {
+            NT_LOG_ERROR(LogAssets, "Failed to stream {}: {}", request->slot->path, e.what());
+            request->slot->state.store(NtAssetState::Failed, std::memory_order_release);
+            ++failedCount;
+        }
+    }
+
+    for (size_t i = 0; i < uploading.size();) {
+        Request& request = *uploading[i];
+        if (!request.batch->isComplete()) {
+            ++i;
+            continue;
+        }
+
+        const float loadMs = std::chrono::duration<float, std::milli>(
+            std::chrono::high_resolution_clock::now() - request.startTime).count();
+        NT_LOG_INFO(LogAssets, "Streamed {} in {:.1f} ms ({} uploads, {:.1f} MB staged)", request.slot->path, loadMs,
+            request.batch->getCopyCount(), request.batch->getStagedBytes() / (1024.0f * 1024.0f));
+
+        // Shared by every handle, destroyed through the cache once no frame in flight can draw it
+        request.slot->model = assetCache.share(std::move(request.model));
+        request.slot->state.store(NtAssetState::Resident, std::memory_order_release);
+        ++residentCount;
+
+        uploading[i] = std::move(uploading.back());
+        uploading.pop_back();
+    }
+}
+
+void NtAssetStreamer::flush() {
+    for (;;) {
+        // Loaders push to decoded before they stop counting a request as queued, so read in this order
+        const bool bLoading = queuedCount > 0;
+        bool bDecodedEmpty;
+        {
+            std::lock_guard<std::mutex> lock{decodedMutex};
+            bDecodedEmpty = decoded.empty();
+        }
+        if (!bLoading && bDecodedEmpty && uploading.empty()) return;
+
+        update();
+        if (!uploading.empty()) {
+            uploading.front()->batch->wait();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+NtStreamingStats NtAssetStreamer::getStats() const {
+    NtStreamingStats stats;
+    stats.queued = queuedCount;
+    {
+        std::lock_guard<std::mutex> lock{decodedMutex};
+        stats.decoded = static_cast<uint32_t>(decoded.size());
+    }
+    stats.uploading = static_cast<uint32_t>(uploading.size());
+    stats.resident = residentCount;
+    stats.failed = failedCount;
+    return stats;
+}
+
+}
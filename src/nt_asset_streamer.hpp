@@ -0,0 +1,149 @@
+#pragma once
+
+#include "nt_asset_cache.hpp"
+#include "nt_device.hpp"
+#include "nt_geometry_arena.hpp"
+#include "nt_job_system.hpp"
+#include "nt_model.hpp"
+#include "vulkan/vulkan_core.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nt
+{
+
+class NtUploadBatch;
+
+//==============================
+// ASSET STREAMING
+//==============================
+// Loads models without stalling the frame loop. A request moves through:
+//   - Decoding, on a loader thread: glTF parse, texture decode, tangents, and
+//     the texture uploads recorded into an NtUploadBatch,
+//   - Uploading, on the main thread in update(): meshes go into the geometry
+//     arena, descriptor sets are written and the batch is submitted,
+//   - Resident, once the batch's fence has signalled.
+// Handles can go into a cModel right away. Until the model is resident they
+// resolve to null, so the entity is simply not drawn. Loading a file that is
+// already loaded or on its way hands out the same slot, through the asset cache.
+
+enum class NtAssetState : uint8_t {
+    Unloaded,   // Empty handle
+    Queued,
+    Decoding,
+    Uploading,
+    Resident,
+    Failed,
+};
+
+// Where a streamed model lands, shared by the streamer and every handle to it
+struct NtModelSlot {
+    std::atomic<NtAssetState> state{NtAssetState::Queued};
+    std::shared_ptr<NtModel> model;     // Written before state becomes Resident
+    std::string path;
+};
+
+class NtModelHandle
+{
+public:
+    NtModelHandle() = default;
+    // Models that are loaded already
+    NtModelHandle(std::shared_ptr<NtModel> model);
+    NtModelHandle(std::unique_ptr<NtModel> model) : NtModelHandle(std::shared_ptr<NtModel>(std::move(model))) {}
+    explicit NtModelHandle(std::shared_ptr<NtModelSlot> slot) : slot{std::move(slot)} {}
+
+    // Null until the model is resident
+    NtModel* get() const {
+        return getState() == NtAssetState::Resident ? slot->model.get() : nullptr;
+    }
+    NtModel* operator->() const { return get(); }
+    NtModel& operator*() const { return *get(); }
+    explicit operator bool() const { return get() != nullptr; }
+
+    NtAssetState getState() const {
+        return slot ? slot->state.load(std::memory_order_acquire) : NtAssetState::Unloaded;
+    }
+    const std::string& getPath() const;
+
+private:
+    std::shared_ptr<NtModelSlot> slot;
+};
+
+struct NtStreamingStats {
+    uint32_t queued = 0;        // Waiting for or on a loader thread
+    uint32_t decoded = 0;       // Waiting for the main thread
+    uint32_t uploading = 0;
+    uint32_t resident = 0;      // Since startup
+    uint32_t failed = 0;
+};
+
+class NtAssetStreamer
+{
+public:
+    static constexpr uint32_t LOADER_THREADS = 2;
+    // Decoded models handed to the GPU per update(), each costs the main thread its mesh copies
+    static constexpr uint32_t MAX_SUBMITS_PER_UPDATE = 1;
+
+    NtAssetStreamer(NtDevice& device, NtGeometryArena& arena, NtAssetCache& cache);
+    ~NtAssetStreamer();
+
+    NtAssetStreamer(const NtAssetStreamer&) = delete;
+    NtAssetStreamer& operator=(const NtAssetStreamer&) = delete;
+
+    // Main thread. The descriptor layout and pool must outlive the request.
+    NtModelHandle loadModel(const std::string& filepath, MaterialType matType,
+        VkDescriptorSetLayout materialLayout,
+        VkDescriptorPool materialPool);
+
+    // Main thread, once per frame: submits decoded models and publishes completed ones
+    void update();
+    // Blocks until every request is resident or failed, for loading screens
+    void flush();
+
+    NtStreamingStats getStats() const;
+
+private:
+    struct Request {
+        std::shared_ptr<NtModelSlot> slot;
+        MaterialType matType{};
+        VkDescriptorSetLayout materialLayout = VK_NULL_HANDLE;
+        VkDescriptorPool materialPool = VK_NULL_HANDLE;
+
+        // The batch outlives the builder's textures only once it has been submitted
+        std::unique_ptr<NtUploadBatch> batch;
+        std::unique_ptr<NtModel::Builder> builder;
+        std::unique_ptr<NtModel> model;
+        std::chrono::high_resolution_clock::time_point startTime;
+    };
+
+    void decode(const std::shared_ptr<Request>& request);
+    void submit(Request& request);
+
+    NtDevice& ntDevice;
+    NtGeometryArena& geometryArena;
+    NtAssetCache& assetCache;
+
+    // Filled by loader threads
+    mutable std::mutex decodedMutex;
+    std::deque<std::shared_ptr<Request>> decoded;
+    std::atomic<uint32_t> queuedCount{0};
+    std::atomic<uint32_t> failedCount{0};
+    std::atomic<bool> bStopping{false};
+
+    // Main thread only
+    std::vector<std::shared_ptr<Request>> uploading;
+    uint32_t residentCount = 0;
+
+    // Its own threads: decode jobs take far longer than a frame, on the shared pool the
+    // frame would end up running them while it waits for its systems
+    std::unique_ptr<NtJobSystem> loaders;
+};
+
+}
@@ -49,12 +49,14 @@ NtBuffer::NtBuffer(
 NtBuffer::~NtBuffer() {
   unmap();
   vkDestroyBuffer(ntDevice.device(), buffer, nullptr);
-  vkFreeMemory(ntDevice.device(), memory, nullptr);
+  ntDevice.freeMemory(memory);
 }
 
 /**
  * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
  *
+ * @note Host-visible memory stays mapped by the allocator, this only points into it
+ *
  * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
  * buffer range.
  * @param offset (Optional) Byte offset from beginning
@@ -62,20 +64,21 @@ NtBuffer::~NtBuffer() {
  * @return VkResult of the buffer mapping call
  */
 VkResult NtBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
-  assert(buffer && memory && "Called map on buffer before create");
-  return vkMapMemory(ntDevice.device(), memory, offset, size, 0, &mapped);
+  assert(buffer && memory.memory && "Called map on buffer before create");
+  if (!memory.mapped) {
+    return VK_ERROR_MEMORY_MAP_FAILED;
+  }
+  mapped = static_cast<char *>(memory.mapped) + offset;
+  return VK_SUCCESS;
 }
 
 /**
  * Unmap a mapped memory range
  *
- * @note Does not return a result as vkUnmapMemory can't fail
+ * @note The memory itself stays mapped until the allocator frees it
  */
 void NtBuffer::unmap() {
-  if (mapped) {
-    vkUnmapMemory(ntDevice.device(), memory);
-    mapped = nullptr;
-  }
+  mapped = nullptr;
 }
 
 /**
@@ -111,12 +114,7 @@ void NtBuffer::writeToBuffer(void *data, VkDeviceSize size, VkDeviceSize offset)
  * @return VkResult of the flush call
  */
 VkResult NtBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-  VkMappedMemoryRange mappedRange = {};
-  mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-  mappedRange.memory = memory;
-  mappedRange.offset = offset;
-  mappedRange.size = size;
-  return vkFlushMappedMemoryRanges(ntDevice.device(), 1, &mappedRange);
+  return ntDevice.getMemoryAllocator().flush(memory, size, offset);
 }
 
 /**
@@ -131,12 +129,7 @@ VkResult NtBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
  * @return VkResult of the invalidate call
  */
 VkResult NtBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
-  VkMappedMemoryRange mappedRange = {};
-  mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-  mappedRange.memory = memory;
-  mappedRange.offset = offset;
-  mappedRange.size = size;
-  return vkInvalidateMappedMemoryRanges(ntDevice.device(), 1, &mappedRange);
+  return ntDevice.getMemoryAllocator().invalidate(memory, size, offset);
 }
 
 /**
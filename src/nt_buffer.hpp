@@ -46,7 +46,7 @@ class NtBuffer {
   NtDevice& ntDevice;
   void* mapped = nullptr;
   VkBuffer buffer = VK_NULL_HANDLE;
-  VkDeviceMemory memory = VK_NULL_HANDLE;
+  NtAllocation memory{};
 
   VkDeviceSize bufferSize;
   uint32_t instanceCount;
@@ -8,7 +8,7 @@
 namespace nt {
 
 void CameraSystem::setPerspectiveProjection() {
-    auto const& camera = nexus->GetComponent<cCamera>(*entities.begin());
+    auto const& camera = nexus->GetComponent<const cCamera>(*entities.begin());
 
     assert(glm::abs(camera.aspect - std::numeric_limits<float>::epsilon()) && "Camera aspect ratio must be non-zero and finite");
     const float tanHalfFovy = tan(glm::radians(camera.fov) / 2.f);
@@ -107,12 +107,14 @@ void CameraSystem::update(glm::mat4 &UBOprojection, glm::mat4 &UBOview, glm::mat
     // Only care about the first camera for now
     assert(!entities.empty() && "No entities found in the Camera System");
 
-    auto const& transform = nexus->GetComponent<cTransform>(*entities.begin());
-    auto& camera = nexus->GetComponent<cCamera>(*entities.begin());
+    // Reads stay const, a mutable access would mark the components changed every frame
+    const NtEntity entity = *entities.begin();
+    auto const& transform = nexus->GetComponent<const cTransform>(entity);
+    auto const& camera = nexus->GetComponent<const cCamera>(entity);
 
     if (camera.projectionDirty) {
         setPerspectiveProjection();
-        camera.projectionDirty = false;
+        nexus->GetComponent<cCamera>(entity).projectionDirty = false;
     }
 
     glm::vec3 cameraPos = { camera.position.translation.x, camera.position.translation.y, camera.position.translation.z };
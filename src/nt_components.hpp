@@ -1,11 +1,14 @@
 #pragma once
 
+#include "nt_asset_streamer.hpp"
 #include "nt_material.hpp"
 #include "nt_model.hpp"
 #include "nt_types.hpp"
 #include "nt_animator.hpp"
+#include "nt_entity.hpp"
 
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <cstddef>
 #include <memory>
 
@@ -23,9 +26,29 @@ struct cTransform {
     glm::vec3 rotation{};
     glm::vec3 scale{1.f, 1.f, 1.f};
 
+    // Optional quaternion rotation. When enabled it replaces the Euler angles
+    // when building matrices, which then needs no trig. getForward/getRight/getUp
+    // still read the Euler angles.
+    glm::quat orientation{1.f, 0.f, 0.f, 0.f};
+    bool bUseOrientation = false;
+
+    void setOrientation(const glm::quat& q) {
+      orientation = glm::normalize(q);
+      bUseOrientation = true;
+    }
+
     // Tait-Bryan angles, Y(1), X(2), Z(3)
     // https://en.wikipedia.org/wiki/Euler_angles#Rotation_matrix
     glm::mat4 mat4() const {
+      if (bUseOrientation) {
+        const glm::mat3 r = glm::mat3_cast(orientation);
+        return glm::mat4{
+            glm::vec4(r[0] * scale.x, 0.0f),
+            glm::vec4(r[1] * scale.y, 0.0f),
+            glm::vec4(r[2] * scale.z, 0.0f),
+            glm::vec4(translation, 1.0f)};
+      }
+
       const float c3 = glm::cos(rotation.z);
       const float s3 = glm::sin(rotation.z);
       const float c2 = glm::cos(rotation.x);
@@ -55,6 +78,11 @@ struct cTransform {
       };
 
     glm::mat3 normalMatrix() const {
+      if (bUseOrientation) {
+        const glm::mat3 r = glm::mat3_cast(orientation);
+        return glm::mat3{r[0] / scale.x, r[1] / scale.y, r[2] / scale.z};
+      }
+
       const float c3 = glm::cos(rotation.z);
       const float s3 = glm::sin(rotation.z);
       const float c2 = glm::cos(rotation.x);
@@ -106,6 +134,12 @@ struct cTransform {
     }
 };
 
+// Makes the entity's cTransform relative to the parent's world transform.
+// World matrices are resolved by TransformSystem.
+struct cParent {
+    NtEntity parent = INVALID_ENTITY;
+};
+
 struct cCamera {
     float fov{65.f};
     float aspect{1.77f};
@@ -126,7 +160,7 @@ struct cLight {
 };
 
 struct cModel {
-    std::shared_ptr<NtModel> mesh;
+    NtModelHandle mesh;     // Streamed models resolve to null until they are resident
     bool bDropShadow = false;
 
     // MaterialType getMaterialType() const { return mesh->getMaterialType(); }
@@ -1,5 +1,6 @@
 #include "nt_device.hpp"
 #include "nt_log.hpp"
+#include "nt_upload_batch.hpp"
 #include "glm/gtc/constants.hpp"
 
 // std headers
@@ -57,9 +58,13 @@ NtDevice::NtDevice(NtWindow &window) : window{window} {
   pickPhysicalDevice();
   createLogicalDevice();
   createCommandPool();
+  memoryAllocator = std::make_unique<NtMemoryAllocator>(device_, physicalDevice_);
+  stagingRing = std::make_unique<NtStagingRing>(*this);
 }
 
 NtDevice::~NtDevice() {
+  stagingRing.reset();
+  memoryAllocator.reset();
   vkDestroyCommandPool(device_, commandPool, nullptr);
   vkDestroyDevice(device_, nullptr);
 
@@ -158,6 +163,9 @@ void NtDevice::createLogicalDevice() {
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
   std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+  if (indices.transferFamilyHasValue) {
+    uniqueQueueFamilies.insert(indices.transferFamily);
+  }
 
   float queuePriority = 1.0f;
   for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -189,6 +197,31 @@ void NtDevice::createLogicalDevice() {
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+  // GPU-driven draws need vkCmdDrawIndexedIndirectCount (core 1.2) and a non-zero firstInstance
+  VkPhysicalDeviceVulkan12Features vulkan12Features{};
+  vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+  bool isInstance_1_2_plus = (instanceVersion.Major > 1) || (instanceVersion.Minor >= 2);
+  if (isInstance_1_2_plus && properties.apiVersion >= VK_API_VERSION_1_2) {
+    VkPhysicalDeviceFeatures2 supportedFeatures2{};
+    supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures2.pNext = &vulkan12Features;
+    vkGetPhysicalDeviceFeatures2(physicalDevice_, &supportedFeatures2);
+
+    bDrawIndirectCount = vulkan12Features.drawIndirectCount && supportedFeatures2.features.drawIndirectFirstInstance;
+  }
+
+  vulkan12Features = {};
+  vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  if (bDrawIndirectCount) {
+    vulkan12Features.drawIndirectCount = VK_TRUE;
+    deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+    dynamicRenderingFeature.pNext = &vulkan12Features;
+    NT_LOG_VERBOSE(LogCore, "Enabling drawIndirectCount for GPU-driven draws");
+  } else {
+    NT_LOG_WARN(LogCore, "drawIndirectCount is not supported, GPU-driven draws are disabled");
+  }
+
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
@@ -214,6 +247,16 @@ void NtDevice::createLogicalDevice() {
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
 
+  // Asset uploads go to the copy engine when there is one, so they run next to rendering
+  graphicsFamily_ = indices.graphicsFamily;
+  transferFamily_ = indices.transferFamilyHasValue ? indices.transferFamily : indices.graphicsFamily;
+  vkGetDeviceQueue(device_, transferFamily_, 0, &transferQueue_);
+  if (hasTransferQueue()) {
+    NT_LOG_VERBOSE(LogCore, "Using queue family {} for asset uploads", transferFamily_);
+  } else {
+    NT_LOG_VERBOSE(LogCore, "No dedicated transfer queue, asset uploads share the graphics queue");
+  }
+
   // Load dynamic rendering function pointers
     vkCmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(
         vkGetDeviceProcAddr(device_, "vkCmdBeginRendering"));
@@ -232,6 +275,12 @@ void NtDevice::createLogicalDevice() {
         NT_LOG_ERROR(LogCore, "Failed to load dynamic rendering functions!");
       throw std::runtime_error("Failed to load dynamic rendering functions!");
     }
+
+    if (bDrawIndirectCount) {
+      vkCmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCount>(
+          vkGetDeviceProcAddr(device_, "vkCmdDrawIndexedIndirectCount"));
+      bDrawIndirectCount = vkCmdDrawIndexedIndirectCount != nullptr;
+    }
 }
 
 void NtDevice::createCommandPool() {
@@ -419,6 +468,16 @@ QueueFamilyIndices NtDevice::findQueueFamilies(VkPhysicalDevice device) {
     i++;
   }
 
+  for (uint32_t family = 0; family < queueFamilyCount; ++family) {
+    const VkQueueFlags flags = queueFamilies[family].queueFlags;
+    if (queueFamilies[family].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) &&
+        !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+      indices.transferFamily = family;
+      indices.transferFamilyHasValue = true;
+      break;
+    }
+  }
+
   return indices;
 }
 
@@ -484,7 +543,7 @@ void NtDevice::createBuffer(
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkBuffer &buffer,
-    VkDeviceMemory &bufferMemory) {
+    NtAllocation &bufferMemory) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = size;
@@ -499,17 +558,11 @@ void NtDevice::createBuffer(
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-      NT_LOG_ERROR(LogCore, "failed to allocate vertex buffer memory!");
-    throw std::runtime_error("failed to allocate vertex buffer memory!");
-  }
+  // Transfer-only buffers are staging uploads, they go to the linear pools
+  const NtMemoryUsage memoryUsage = usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT ? NtMemoryUsage::Staging : NtMemoryUsage::Default;
+  bufferMemory = memoryAllocator->allocate(memRequirements, properties, false, memoryUsage);
 
-  vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+  vkBindBufferMemory(device_, buffer, bufferMemory.memory, bufferMemory.offset);
 }
 
 VkCommandBuffer NtDevice::beginSingleTimeCommands() {
@@ -587,7 +640,8 @@ void NtDevice::createImageWithInfo(
     const VkImageCreateInfo &imageInfo,
     VkMemoryPropertyFlags properties,
     VkImage &image,
-    VkDeviceMemory &imageMemory) {
+    NtAllocation &imageMemory,
+    NtMemoryUsage memoryUsage) {
   if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
       NT_LOG_ERROR(LogCore, "failed to create image!");
     throw std::runtime_error("failed to create image!");
@@ -596,17 +650,9 @@ void NtDevice::createImageWithInfo(
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-      NT_LOG_ERROR(LogCore, "failed to allocate image memory!");
-    throw std::runtime_error("failed to allocate image memory!");
-  }
+  imageMemory = memoryAllocator->allocate(memRequirements, properties, true, memoryUsage);
 
-  if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+  if (vkBindImageMemory(device_, image, imageMemory.memory, imageMemory.offset) != VK_SUCCESS) {
       NT_LOG_ERROR(LogCore, "failed to bind image memory!");
     throw std::runtime_error("failed to bind image memory!");
   }
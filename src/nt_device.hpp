@@ -1,8 +1,10 @@
 #pragma once
 
+#include "nt_memory.hpp"
 #include "nt_window.hpp"
 
 // std lib headers
+#include <memory>
 #include <string>
 #include <vector>
 #include <vulkan/vulkan_core.h>
@@ -10,6 +12,8 @@
 
 namespace nt {
 
+class NtStagingRing;
+
 struct SwapChainSupportDetails {
   VkSurfaceCapabilitiesKHR capabilities;
   std::vector<VkSurfaceFormatKHR> formats;
@@ -19,8 +23,10 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
   uint32_t graphicsFamily;
   uint32_t presentFamily;
+  uint32_t transferFamily;  // Transfer-only family, when the device has one
   bool graphicsFamilyHasValue = false;
   bool presentFamilyHasValue = false;
+  bool transferFamilyHasValue = false;
   bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
@@ -48,12 +54,21 @@ class NtDevice {
   VkSurfaceKHR surface() { return surface_; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  // Dedicated copy queue when there is one, the graphics queue otherwise
+  VkQueue transferQueue() { return transferQueue_; }
+  uint32_t graphicsQueueFamily() const { return graphicsFamily_; }
+  uint32_t transferQueueFamily() const { return transferFamily_; }
+  bool hasTransferQueue() const { return transferFamily_ != graphicsFamily_; }
   VkSampleCountFlagBits getMsaaSamples() { return msaaSamples; }
 
   // Dynamic rendering function pointers
   PFN_vkCmdBeginRenderingKHR vkCmdBeginRendering = nullptr;
   PFN_vkCmdEndRenderingKHR vkCmdEndRendering = nullptr;
 
+  // Indirect count draw, loaded only when supportsDrawIndirectCount()
+  PFN_vkCmdDrawIndexedIndirectCount vkCmdDrawIndexedIndirectCount = nullptr;
+  bool supportsDrawIndirectCount() const { return bDrawIndirectCount; }
+
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice_); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
   QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice_); }
@@ -61,12 +76,13 @@ class NtDevice {
       const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
   // Buffer Helper Functions
+  // Memory comes from the device's sub-allocator, release it with freeMemory
   void createBuffer(
       VkDeviceSize size,
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
-      VkDeviceMemory &bufferMemory);
+      NtAllocation &bufferMemory);
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
   void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -77,7 +93,13 @@ class NtDevice {
       const VkImageCreateInfo &imageInfo,
       VkMemoryPropertyFlags properties,
       VkImage &image,
-      VkDeviceMemory &imageMemory);
+      NtAllocation &imageMemory,
+      NtMemoryUsage memoryUsage = NtMemoryUsage::Default);
+  void freeMemory(NtAllocation &allocation) { memoryAllocator->free(allocation); }
+
+  NtMemoryAllocator &getMemoryAllocator() { return *memoryAllocator; }
+  // Shared by every NtUploadBatch
+  NtStagingRing &getStagingRing() { return *stagingRing; }
 
   VkPhysicalDeviceProperties properties;
 
@@ -112,15 +134,22 @@ class NtDevice {
   VkSurfaceKHR surface_;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  VkQueue transferQueue_;
+  uint32_t graphicsFamily_ = 0;
+  uint32_t transferFamily_ = 0;
 
   VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
 
+  std::unique_ptr<NtMemoryAllocator> memoryAllocator;
+  std::unique_ptr<NtStagingRing> stagingRing;
+
   struct {
       int Major = 0;
       int Minor = 0;
       int Patch = 0;
   } instanceVersion;
   bool isDyReExtensionNeeded = false;
+  bool bDrawIndirectCount = false;
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
   std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
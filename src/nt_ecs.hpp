@@ -1,29 +1,33 @@
 #pragma once
 
 #include "nt_components.hpp"
+#include "nt_entity.hpp"
 
+#include <algorithm>
+#include <bit>
 #include <bitset>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <cwchar>
 #include <iostream>
+#include <limits>
+#include <mutex>
 #include <memory>
-#include <queue>
-#include <set>
+#include <new>
+#include <deque>
+#include <tuple>
 #include <unordered_map>
 #include <array>
+#include <atomic>
+#include <thread>
 #include <typeindex>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace nt {
 
-//==============================
-// ENTITY
-//==============================
-// Type alias
-using NtEntity = std::uint32_t;
-
-const NtEntity MAX_ENTITIES = 5000;
-
 //==============================
 // COMPONENT
 //==============================
@@ -36,140 +40,703 @@ const NtComponentType MAX_COMPONENTS = 32;
 //==============================
 using NtSignature = std::bitset<MAX_COMPONENTS>;
 
+//==============================
+// COMPONENT TYPE ID
+//==============================
+namespace detail {
+    // Incremented once per component type during static initialization
+    inline NtComponentType nextComponentType = 0;
+
+    template<typename T>
+    inline const NtComponentType componentTypeId = nextComponentType++;
+}
+
+// Process-wide ID of a component type. It is both the signature bit and the
+// index of the type's array in NtComponentManager, so it never needs a lookup.
+// Every component array, signature and mask is indexed with it unchecked.
+template<typename T>
+inline NtComponentType ComponentTypeId() {
+    const NtComponentType type = detail::componentTypeId<std::remove_cv_t<T>>;
+    assert(type < MAX_COMPONENTS && "Too many component types");
+    return type;
+}
+
+//==============================
+// STORAGE MODE
+//==============================
+// Sparse keeps one packed array per component type and is the default.
+// Archetype groups entities with identical signatures into fixed-size chunks
+// holding one column per component, so bulk updates stream contiguous memory.
+enum class NtStorageMode
+{
+    Sparse,
+    Archetype
+};
+
+//==============================
+// COMPONENT INFO
+//==============================
+// Type-erased operations that let archetype chunks relocate rows
+struct NtComponentInfo
+{
+    size_t size = 0;
+    size_t alignment = 0;
+    void (*moveConstruct)(void* dst, void* src) = nullptr;
+    void (*destroy)(void* ptr) = nullptr;
+
+    template<typename T>
+    static NtComponentInfo Of() {
+        return {
+            sizeof(T),
+            alignof(T),
+            [](void* dst, void* src) { new (dst) T(std::move(*static_cast<T*>(src))); },
+            [](void* ptr) { static_cast<T*>(ptr)->~T(); }
+        };
+    }
+};
+
+//==============================
+// CHANGE TICKS
+//==============================
+// Stamped on every component row: the world tick it was added at, and the
+// tick it was last handed out through a mutable accessor (GetComponent<T>
+// or a view over non-const T). Compared against a system's last claimed
+// tick by the Changed/Added view filters.
+struct NtComponentTicks
+{
+    uint32_t added = 0;
+    uint32_t changed = 0;
+};
+
 //==============================
 // ENTITY MANAGER
 //==============================
 class NtEntityManager
 {
 public:
-    NtEntityManager() {
-        // Initialize the queue with all possible entity IDs
-        for (NtEntity entity = 0; entity < MAX_ENTITIES; ++entity) {
-            availableEntities.push(entity);
-        }
-    }
+    // Freed slots are only reused once this many are queued, so a single
+    // slot's 8-bit generation wraps around slowly
+    static constexpr size_t MINIMUM_FREE_INDICES = 1024;
 
     NtEntity CreateEntity() {
-        assert(livingEntityCount < MAX_ENTITIES && "Too many entities in existance");
+        uint32_t index;
 
-        // Take an ID from the front of the queue
-        NtEntity id = availableEntities.front();
-        availableEntities.pop();
+        if (freeIndices.size() > MINIMUM_FREE_INDICES) {
+            // Take the oldest freed slot from the front of the free-list
+            index = freeIndices.front();
+            freeIndices.pop_front();
+        }
+        else {
+            // Grow by one slot
+            assert(generations.size() < MAX_ENTITY_INDEX && "Too many entities in existance");
+            index = static_cast<uint32_t>(generations.size());
+            generations.push_back(0);
+            signatures.emplace_back();
+        }
         ++livingEntityCount;
 
-        return id;
+        return MakeEntity(index, generations[index]);
     }
 
     void DestroyEntity(NtEntity entity) {
-        assert(entity < MAX_ENTITIES && "Entity out of range");
+        assert(IsAlive(entity) && "Destroying an entity that is not alive");
 
-        // Invalidate the destroyed entity's signature
-        signatures[entity].reset();
+        const uint32_t index = EntityIndex(entity);
 
-        // Put the destroyed ID at the back of the queue
-        availableEntities.push(entity);
+        // Invalidate the destroyed entity's signature and any handles still pointing at it
+        signatures[index].reset();
+        ++generations[index];
+
+        // Put the slot at the back of the free-list
+        freeIndices.push_back(index);
         --livingEntityCount;
     }
 
+    bool IsAlive(NtEntity entity) const {
+        const uint32_t index = EntityIndex(entity);
+        return index < generations.size() && generations[index] == EntityGeneration(entity);
+    }
+
     void SetSignature(NtEntity entity, NtSignature signature) {
-        assert(entity < MAX_ENTITIES && "Entity out of range");
+        assert(IsAlive(entity) && "Entity is not alive");
 
         // Put this entity's signature into the array
-        signatures[entity] = signature;
+        signatures[EntityIndex(entity)] = signature;
     }
 
     NtSignature GetSignature(NtEntity entity) {
-        assert(entity < MAX_ENTITIES && "Entity out of range");
+        assert(IsAlive(entity) && "Entity is not alive");
 
         // Get this entity's signature from the array
-        return signatures[entity];
+        return signatures[EntityIndex(entity)];
     }
 
+    uint32_t GetLivingEntityCount() const { return livingEntityCount; }
+
 private:
-    // Queue of unused entity IDs
-    std::queue<NtEntity> availableEntities{};
+    // Freed slot indices, oldest first
+    std::deque<uint32_t> freeIndices{};
 
-    // Array of signatures where the index corresponds to the entity
-    std::array<NtSignature, MAX_ENTITIES> signatures{};
+    // Per-slot generation and signature, grown on demand
+    std::vector<uint8_t> generations{};
+    std::vector<NtSignature> signatures{};
 
-    // Total living entities - used to keep limits on how many exist
+    // Total living entities
     uint32_t livingEntityCount{};
 };
 
+//==============================
+// SPARSE SET
+//==============================
+// Maps entities to positions in a packed (dense) array without hashing.
+// The sparse side is keyed by entity index and split into pages that are only
+// allocated once an index in that range is inserted, so lookups are two array
+// reads. The dense side keeps the full entity, which rejects stale handles.
+class NtSparseSet
+{
+public:
+    static constexpr size_t PAGE_SIZE = 1024;
+    static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+    bool Contains(NtEntity entity) const {
+        const uint32_t index = EntityIndex(entity);
+        const size_t page = index / PAGE_SIZE;
+        if (page >= sparse.size() || !sparse[page]) return false;
+
+        const uint32_t denseIndex = (*sparse[page])[index % PAGE_SIZE];
+        return denseIndex != INVALID_INDEX && dense[denseIndex] == entity;
+    }
+
+    // Position of the entity in the dense array - entity must be present
+    uint32_t IndexOf(NtEntity entity) const {
+        assert(Contains(entity) && "Entity not present in sparse set");
+        const uint32_t index = EntityIndex(entity);
+        return (*sparse[index / PAGE_SIZE])[index % PAGE_SIZE];
+    }
+
+    size_t Size() const { return dense.size(); }
+    bool Empty() const { return dense.empty(); }
+    const NtEntity* Entities() const { return dense.data(); }
+
+protected:
+    // Appends the entity to the dense array and returns its position
+    uint32_t Emplace(NtEntity entity) {
+        const uint32_t index = static_cast<uint32_t>(dense.size());
+        dense.push_back(entity);
+        SparseRef(entity) = index;
+        return index;
+    }
+
+    // Moves the last entity into the removed entity's slot to keep the array packed
+    void SwapRemove(NtEntity entity) {
+        const uint32_t index = IndexOf(entity);
+        const NtEntity last = dense.back();
+
+        dense[index] = last;
+        SparseRef(last) = index;
+
+        SparseRef(entity) = INVALID_INDEX;
+        dense.pop_back();
+    }
+
+private:
+    using Page = std::array<uint32_t, PAGE_SIZE>;
+
+    uint32_t& SparseRef(NtEntity entity) {
+        const uint32_t index = EntityIndex(entity);
+        const size_t page = index / PAGE_SIZE;
+        if (page >= sparse.size()) {
+            sparse.resize(page + 1);
+        }
+        if (!sparse[page]) {
+            sparse[page] = std::make_unique<Page>();
+            sparse[page]->fill(INVALID_INDEX);
+        }
+        return (*sparse[page])[index % PAGE_SIZE];
+    }
+
+    // Entity index -> dense index, split into lazily allocated pages
+    std::vector<std::unique_ptr<Page>> sparse;
+
+    // Dense index -> entity
+    std::vector<NtEntity> dense;
+};
+
+//==============================
+// ENTITY SET
+//==============================
+// Unordered set of entities with O(1) insert, erase and lookup.
+// Iterates the packed array, so removal reorders the remaining entities.
+class NtEntitySet : public NtSparseSet
+{
+public:
+    void Insert(NtEntity entity) {
+        if (!Contains(entity)) {
+            Emplace(entity);
+        }
+    }
+
+    void Erase(NtEntity entity) {
+        if (Contains(entity)) {
+            SwapRemove(entity);
+        }
+    }
+
+    const NtEntity* begin() const { return Entities(); }
+    const NtEntity* end() const { return Entities() + Size(); }
+};
+
 //==============================
 // COMPONENT ARRAY
 //==============================
-class IComponentArray
+class IComponentArray : public NtSparseSet
 {
     public:
+    static constexpr size_t TICKS_PER_PAGE = 1024;
+
     virtual ~IComponentArray() = default;
     virtual void EntityDestroyed(NtEntity entity) = 0;
+
+    // Change ticks at a dense index, index-aligned with Entities()
+    NtComponentTicks& TicksAt(size_t index) {
+        return (*tickPages[index / TICKS_PER_PAGE])[index % TICKS_PER_PAGE];
+    }
+
+    const NtComponentTicks& TicksAt(size_t index) const {
+        return (*tickPages[index / TICKS_PER_PAGE])[index % TICKS_PER_PAGE];
+    }
+
+protected:
+    // Ticks are kept outside the typed pages so filters can read them without knowing T
+    void PushTicks(uint32_t index, uint32_t tick) {
+        if (index / TICKS_PER_PAGE == tickPages.size()) {
+            tickPages.push_back(std::make_unique<TickPage>());
+        }
+        TicksAt(index) = {tick, tick};
+    }
+
+    void PopTicks(uint32_t removedIndex, uint32_t lastIndex) {
+        TicksAt(removedIndex) = TicksAt(lastIndex);
+        if (lastIndex % TICKS_PER_PAGE == 0) {
+            tickPages.pop_back();
+        }
+    }
+
+private:
+    using TickPage = std::array<NtComponentTicks, TICKS_PER_PAGE>;
+
+    std::vector<std::unique_ptr<TickPage>> tickPages;
 };
 
 template<typename T>
 class NtComponentArray : public IComponentArray
 {
 public:
-    void InsertData(NtEntity entity, T component) {
-        assert(entityToIndexMap.find(entity) == entityToIndexMap.end() && "Component added to the same entity more than once");
+    // Roughly 16 KiB per page, rounded down to a power of two so indexing is a shift
+    static constexpr size_t COMPONENTS_PER_PAGE = std::bit_floor(std::max<size_t>(1, 16 * 1024 / sizeof(T)));
+
+    NtComponentArray() = default;
+    NtComponentArray(const NtComponentArray&) = delete;
+    NtComponentArray& operator=(const NtComponentArray&) = delete;
 
-        // Put new entry at the end and update the maps
-        size_t newIndex = size;
-        entityToIndexMap[entity] = newIndex;
-        indexToEntityMap[newIndex] = entity;
-        componentArray[newIndex] = component;
-        ++size;
+    ~NtComponentArray() override {
+        for (size_t index = 0; index < Size(); ++index) {
+            At(index).~T();
+        }
     }
 
-    void RemoveData(NtEntity entity) {
-        assert(entityToIndexMap.find(entity) != entityToIndexMap.end() && "Removing non-existent component");
+    void InsertData(NtEntity entity, T component, uint32_t tick) {
+        assert(!Contains(entity) && "Component added to the same entity more than once");
+
+        // Put new entry at the end, the component pages mirror the dense entity array
+        const uint32_t index = Emplace(entity);
+        if (index / COMPONENTS_PER_PAGE == pages.size()) {
+            pages.push_back(std::make_unique<Page>());
+        }
+        new (&At(index)) T(std::move(component));
+        PushTicks(index, tick);
+    }
 
-        // Copy element at the end into deleted element's place to maintain density
-        size_t indexOfRemovedEntity = entityToIndexMap[entity];
-        size_t indexOfLastElement = size - 1;
-        componentArray[indexOfRemovedEntity] = componentArray[indexOfLastElement];
+    void RemoveData(NtEntity entity) {
+        assert(Contains(entity) && "Removing non-existent component");
 
-        // Update the map to point to the moved spot
-        NtEntity entityOfLastElement = indexToEntityMap[indexOfLastElement];
-        entityToIndexMap[entityOfLastElement] = indexOfRemovedEntity;
-        indexToEntityMap[indexOfRemovedEntity] = entityOfLastElement;
+        // Move element at the end into deleted element's place to maintain density
+        const uint32_t indexOfRemovedEntity = IndexOf(entity);
+        const uint32_t indexOfLastElement = static_cast<uint32_t>(Size() - 1);
+        if (indexOfRemovedEntity != indexOfLastElement) {
+            At(indexOfRemovedEntity) = std::move(At(indexOfLastElement));
+        }
+        At(indexOfLastElement).~T();
+        PopTicks(indexOfRemovedEntity, indexOfLastElement);
 
-        entityToIndexMap.erase(entity);
-        indexToEntityMap.erase(indexOfLastElement);
+        // Release the last page once it empties
+        if (indexOfLastElement % COMPONENTS_PER_PAGE == 0) {
+            pages.pop_back();
+        }
 
-        --size;
+        SwapRemove(entity);
     }
 
     bool HasData(NtEntity entity) const {
-            return entityToIndexMap.find(entity) != entityToIndexMap.end();
-        }
+        return Contains(entity);
+    }
 
     T& GetData(NtEntity entity) {
-        assert(entityToIndexMap.find(entity) != entityToIndexMap.end() && "Retrieving non-existent component");
+        assert(Contains(entity) && "Retrieving non-existent component");
 
         // Return a reference to the entity's component
-        return componentArray[entityToIndexMap[entity]];
+        return At(IndexOf(entity));
+    }
+
+    // Packed component at a dense index, index-aligned with Entities()
+    T& At(size_t index) {
+        return reinterpret_cast<T*>(pages[index / COMPONENTS_PER_PAGE]->data)[index % COMPONENTS_PER_PAGE];
     }
 
     void EntityDestroyed(NtEntity entity) override {
-        if (entityToIndexMap.find(entity) != entityToIndexMap.end()) {
+        if (Contains(entity)) {
             // Remove the entity's component if it existed
             RemoveData(entity);
         }
     }
 
 private:
-    // The packed array of components (of generic type T)
-    std::array<T, MAX_ENTITIES> componentArray;
+    // Raw storage for a page of components, constructed in place as rows are added
+    struct Page {
+        alignas(T) std::byte data[sizeof(T) * COMPONENTS_PER_PAGE];
+    };
+
+    // The packed components split into fixed-size pages, so growing never
+    // relocates existing components and memory follows the number in use
+    std::vector<std::unique_ptr<Page>> pages;
+};
+
+//==============================
+// ARCHETYPE
+//==============================
+// All entities sharing one signature. Rows are packed across fixed-size chunks;
+// each chunk stores its entity IDs, one aligned column per component, then the
+// change ticks of each column.
+// Removing a row moves the archetype's last row into the hole, so only the last
+// chunk is ever partially filled.
+class NtArchetype
+{
+public:
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+    static constexpr size_t CHUNK_ALIGNMENT = 64;
+    static constexpr uint8_t NO_COLUMN = std::numeric_limits<uint8_t>::max();
 
-    // Map from an entity ID to an array index
-    std::unordered_map<NtEntity, size_t> entityToIndexMap;
+    NtArchetype(NtSignature sig, const std::array<NtComponentInfo, MAX_COMPONENTS>& infos)
+        : signature(sig)
+    {
+        columnOf.fill(NO_COLUMN);
 
-    // Map from an array index to an entity ID
-    std::unordered_map<size_t, NtEntity> indexToEntityMap;
+        size_t rowSize = sizeof(NtEntity);
+        for (size_t type = 0; type < MAX_COMPONENTS; ++type) {
+            if (!signature.test(type)) continue;
 
-    // Total size of valid entries in the array
-    size_t size = 0;
+            assert(infos[type].size && "Component not registered before use");
+            assert(infos[type].alignment <= CHUNK_ALIGNMENT && "Component alignment exceeds chunk alignment");
+
+            columnOf[type] = static_cast<uint8_t>(columns.size());
+            columns.push_back({0, 0, infos[type]});
+            rowSize += infos[type].size + sizeof(NtComponentTicks);
+        }
+
+        // Start from the unpadded estimate and shrink until the aligned columns fit
+        capacity = static_cast<uint32_t>(CHUNK_SIZE / rowSize);
+        while (capacity > 0 && !LayoutColumns(capacity)) {
+            --capacity;
+        }
+        assert(capacity > 0 && "Components too large for an archetype chunk");
+    }
+
+    ~NtArchetype() {
+        for (uint32_t row = 0; row < rowCount; ++row) {
+            for (uint8_t column = 0; column < columns.size(); ++column) {
+                columns[column].info.destroy(At(column, row));
+            }
+        }
+    }
+
+    NtArchetype(const NtArchetype&) = delete;
+    NtArchetype& operator=(const NtArchetype&) = delete;
+
+    NtSignature Signature() const { return signature; }
+    uint32_t Size() const { return rowCount; }
+    uint32_t ChunkCapacity() const { return capacity; }
+
+    bool HasColumn(NtComponentType type) const { return columnOf[type] != NO_COLUMN; }
+    uint8_t ColumnOf(NtComponentType type) const { return columnOf[type]; }
+
+    // Chunk iteration for bulk updates
+    size_t ChunkCount() const { return chunks.size(); }
+
+    uint32_t ChunkRowCount(size_t chunk) const {
+        const uint32_t first = static_cast<uint32_t>(chunk) * capacity;
+        return std::min(capacity, rowCount - first);
+    }
+
+    const NtEntity* ChunkEntities(size_t chunk) const {
+        return reinterpret_cast<const NtEntity*>(chunks[chunk]->data);
+    }
+
+    template<typename T>
+    T* ChunkColumn(size_t chunk) {
+        const uint8_t column = columnOf[ComponentTypeId<T>()];
+        assert(column != NO_COLUMN && "Archetype has no column for this component");
+        return reinterpret_cast<T*>(chunks[chunk]->data + columns[column].offset);
+    }
+
+    NtComponentTicks* ChunkTicks(uint8_t column, size_t chunk) {
+        return reinterpret_cast<NtComponentTicks*>(chunks[chunk]->data + columns[column].ticksOffset);
+    }
+
+    // Address of one component slot
+    void* At(uint8_t column, uint32_t row) {
+        Chunk& chunk = *chunks[row / capacity];
+        return chunk.data + columns[column].offset + columns[column].info.size * (row % capacity);
+    }
+
+    NtComponentTicks& TicksAt(uint8_t column, uint32_t row) {
+        return ChunkTicks(column, row / capacity)[row % capacity];
+    }
+
+    NtEntity EntityAt(uint32_t row) const {
+        return ChunkEntities(row / capacity)[row % capacity];
+    }
+
+    // Reserves a row for the entity, component slots are left unconstructed
+    uint32_t Emplace(NtEntity entity) {
+        const uint32_t row = rowCount++;
+        if (row / capacity == chunks.size()) {
+            chunks.push_back(std::make_unique<Chunk>());
+        }
+        reinterpret_cast<NtEntity*>(chunks[row / capacity]->data)[row % capacity] = entity;
+        return row;
+    }
+
+    // Releases a row whose components were already moved out or destroyed.
+    // Returns the entity that was moved into it, or INVALID_ENTITY if none was.
+    NtEntity SwapRemove(uint32_t row) {
+        assert(row < rowCount && "Row out of range");
+
+        const uint32_t last = --rowCount;
+        NtEntity moved = INVALID_ENTITY;
+
+        if (row != last) {
+            for (uint8_t column = 0; column < columns.size(); ++column) {
+                void* lastSlot = At(column, last);
+                columns[column].info.moveConstruct(At(column, row), lastSlot);
+                columns[column].info.destroy(lastSlot);
+                TicksAt(column, row) = TicksAt(column, last);
+            }
+            moved = EntityAt(last);
+            reinterpret_cast<NtEntity*>(chunks[row / capacity]->data)[row % capacity] = moved;
+        }
+
+        // Drop the trailing chunk once it empties
+        if (last % capacity == 0) {
+            chunks.pop_back();
+        }
+        return moved;
+    }
+
+private:
+    friend class NtArchetypeStorage;
+
+    struct Column {
+        size_t offset;
+        size_t ticksOffset;
+        NtComponentInfo info;
+    };
+
+    struct Chunk {
+        alignas(CHUNK_ALIGNMENT) std::byte data[CHUNK_SIZE];
+    };
+
+    bool LayoutColumns(uint32_t rows) {
+        size_t offset = sizeof(NtEntity) * rows;
+        for (auto& column : columns) {
+            offset = (offset + column.info.alignment - 1) & ~(column.info.alignment - 1);
+            column.offset = offset;
+            offset += column.info.size * rows;
+        }
+
+        // Tick arrays after the data, they only need uint32_t alignment
+        offset = (offset + alignof(NtComponentTicks) - 1) & ~(alignof(NtComponentTicks) - 1);
+        for (auto& column : columns) {
+            column.ticksOffset = offset;
+            offset += sizeof(NtComponentTicks) * rows;
+        }
+        return offset <= CHUNK_SIZE;
+    }
+
+    NtSignature signature;
+    std::vector<Column> columns;
+    std::array<uint8_t, MAX_COMPONENTS> columnOf{};
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    uint32_t capacity = 0;
+    uint32_t rowCount = 0;
+
+    // Cached neighbours one component away, filled in on first use
+    std::array<NtArchetype*, MAX_COMPONENTS> addEdges{};
+    std::array<NtArchetype*, MAX_COMPONENTS> removeEdges{};
+};
+
+//==============================
+// ARCHETYPE STORAGE
+//==============================
+// Component storage for NtStorageMode::Archetype. Adding or removing a
+// component moves the entity's row into the neighbouring archetype.
+// Entities without components do not occupy a row.
+class NtArchetypeStorage
+{
+public:
+    explicit NtArchetypeStorage(const std::array<NtComponentInfo, MAX_COMPONENTS>& infos)
+        : componentInfos(infos) {}
+
+    template<typename T>
+    void Insert(NtEntity entity, T component, uint32_t tick) {
+        const NtComponentType type = ComponentTypeId<T>();
+        Location& location = LocationOf(entity);
+
+        assert(!(location.archetype && location.archetype->HasColumn(type)) && "Component added to the same entity more than once");
+
+        NtArchetype* target = Transition(location.archetype, type, true);
+        MoveRow(entity, location, target);
+        new (target->At(target->ColumnOf(type), location.row)) T(std::move(component));
+        target->TicksAt(target->ColumnOf(type), location.row) = {tick, tick};
+    }
+
+    template<typename T>
+    void Remove(NtEntity entity) {
+        const NtComponentType type = ComponentTypeId<T>();
+        Location& location = LocationOf(entity);
+
+        assert(location.archetype && location.archetype->HasColumn(type) && "Removing non-existent component");
+
+        // The removed column has no slot in the target, so MoveRow destroys it
+        MoveRow(entity, location, Transition(location.archetype, type, false));
+    }
+
+    template<typename T>
+    bool Has(NtEntity entity) const {
+        const Location* location = Find(entity);
+        return location && location->archetype->HasColumn(ComponentTypeId<T>());
+    }
+
+    template<typename T>
+    T& Get(NtEntity entity) {
+        assert(Has<T>(entity) && "Retrieving non-existent component");
+
+        const Location& location = locations[EntityIndex(entity)];
+        return *static_cast<T*>(location.archetype->At(location.archetype->ColumnOf(ComponentTypeId<T>()), location.row));
+    }
+
+    template<typename T>
+    NtComponentTicks& Ticks(NtEntity entity) {
+        assert(Has<T>(entity) && "Retrieving ticks of a non-existent component");
+
+        const Location& location = locations[EntityIndex(entity)];
+        return location.archetype->TicksAt(location.archetype->ColumnOf(ComponentTypeId<T>()), location.row);
+    }
+
+    void EntityDestroyed(NtEntity entity) {
+        if (Find(entity)) {
+            MoveRow(entity, locations[EntityIndex(entity)], nullptr);
+        }
+    }
+
+    // Every archetype created so far, in creation order
+    const std::vector<NtArchetype*>& Archetypes() const { return archetypeList; }
+
+private:
+    struct Location {
+        NtArchetype* archetype = nullptr;
+        uint32_t row = 0;
+    };
+
+    Location& LocationOf(NtEntity entity) {
+        const uint32_t index = EntityIndex(entity);
+        if (index >= locations.size()) {
+            locations.resize(index + 1);
+        }
+        return locations[index];
+    }
+
+    // Location of an entity that occupies a row, nullptr for stale handles
+    const Location* Find(NtEntity entity) const {
+        const uint32_t index = EntityIndex(entity);
+        if (index >= locations.size() || !locations[index].archetype) return nullptr;
+
+        const Location& location = locations[index];
+        return location.archetype->EntityAt(location.row) == entity ? &location : nullptr;
+    }
+
+    // Archetype reached by adding or removing one component, nullptr for the empty signature
+    NtArchetype* Transition(NtArchetype* source, NtComponentType type, bool add) {
+        if (source) {
+            NtArchetype* cached = add ? source->addEdges[type] : source->removeEdges[type];
+            if (cached) return cached;
+        }
+
+        NtSignature signature = source ? source->Signature() : NtSignature{};
+        signature.set(type, add);
+        if (signature.none()) return nullptr;
+
+        NtArchetype* target = GetOrCreate(signature);
+        if (source) {
+            (add ? source->addEdges[type] : source->removeEdges[type]) = target;
+            (add ? target->removeEdges[type] : target->addEdges[type]) = source;
+        }
+        return target;
+    }
+
+    NtArchetype* GetOrCreate(NtSignature signature) {
+        auto& archetype = archetypes[signature];
+        if (!archetype) {
+            archetype = std::make_unique<NtArchetype>(signature, componentInfos);
+            archetypeList.push_back(archetype.get());
+        }
+        return archetype.get();
+    }
+
+    // Moves the shared columns into a new row of target and destroys the rest
+    void MoveRow(NtEntity entity, Location& location, NtArchetype* target) {
+        NtArchetype* source = location.archetype;
+        const uint32_t sourceRow = location.row;
+        const uint32_t targetRow = target ? target->Emplace(entity) : 0;
+
+        if (source) {
+            for (size_t type = 0; type < MAX_COMPONENTS; ++type) {
+                if (!source->HasColumn(type)) continue;
+
+                void* slot = source->At(source->ColumnOf(type), sourceRow);
+                if (target && target->HasColumn(type)) {
+                    componentInfos[type].moveConstruct(target->At(target->ColumnOf(type), targetRow), slot);
+                    target->TicksAt(target->ColumnOf(type), targetRow) = source->TicksAt(source->ColumnOf(type), sourceRow);
+                }
+                componentInfos[type].destroy(slot);
+            }
+
+            const NtEntity moved = source->SwapRemove(sourceRow);
+            if (moved != INVALID_ENTITY) {
+                locations[EntityIndex(moved)].row = sourceRow;
+            }
+        }
+
+        location = {target, targetRow};
+    }
+
+    const std::array<NtComponentInfo, MAX_COMPONENTS>& componentInfos;
+
+    std::unordered_map<NtSignature, std::unique_ptr<NtArchetype>> archetypes;
+    std::vector<NtArchetype*> archetypeList;
+
+    // Entity index -> archetype and row
+    std::vector<Location> locations;
 };
 
 //==============================
@@ -178,91 +745,406 @@ private:
 class NtComponentManager
 {
 public:
+    explicit NtComponentManager(NtStorageMode mode = NtStorageMode::Sparse)
+        : storageMode(mode)
+    {
+        if (storageMode == NtStorageMode::Archetype) {
+            archetypeStorage = std::make_unique<NtArchetypeStorage>(componentInfos);
+        }
+    }
+
     template<typename T>
     void RegisterComponent()
     {
-        std::type_index typeName(typeid(T));
-
-        assert(componentTypes.find(typeName) == componentTypes.end() && "Registering component type more than once");
+        const NtComponentType type = ComponentTypeId<T>();
 
-        // Add this component type to the component type map
-        componentTypes.insert({typeName, nextComponentType});
+        assert(type < MAX_COMPONENTS && "Too many component types");
+        assert(!componentInfos[type].size && "Registering component type more than once");
 
-        // Create a componentArray pointer and add it to the component arrays map
-        componentArrays.insert({typeName, std::make_shared<NtComponentArray<T>>()});
+        componentInfos[type] = NtComponentInfo::Of<T>();
 
-        // Increment the value so that the next component registered will be different
-        ++nextComponentType;
+        // Archetype mode builds its columns from the info, sparse mode keeps an array per type
+        if (storageMode == NtStorageMode::Sparse) {
+            componentArrays[type] = std::make_unique<NtComponentArray<T>>();
+        }
     }
 
     template<typename T>
     NtComponentType GetComponentType()
     {
-        std::type_index typeIndex(typeid(T));
+        const NtComponentType type = ComponentTypeId<T>();
 
-        assert(componentTypes.find(typeIndex) != componentTypes.end() && "Component not registered before use");
+        assert(componentInfos[type].size && "Component not registered before use");
 
         // Return this component's type - used for creating signatures
-        return componentTypes[typeIndex];
+        return type;
     }
 
     template<typename T>
     void AddComponent(NtEntity entity, T component)
     {
-        // Add a component to the array for an entity
-        GetComponentArray<T>()->InsertData(entity, component);
+        const uint32_t tick = GetChangeTick();
+        if (storageMode == NtStorageMode::Archetype) {
+            archetypeStorage->Insert<T>(entity, std::move(component), tick);
+        }
+        else {
+            GetComponentArray<T>()->InsertData(entity, std::move(component), tick);
+        }
     }
 
     template<typename T>
     void RemoveComponent(NtEntity entity)
     {
-        // Remove a component from the array for an entity
-        GetComponentArray<T>()->RemoveData(entity);
+        if (storageMode == NtStorageMode::Archetype) {
+            archetypeStorage->Remove<T>(entity);
+        }
+        else {
+            GetComponentArray<T>()->RemoveData(entity);
+        }
     }
 
     template<typename T>
     bool HasComponent(NtEntity entity) {
+        if (storageMode == NtStorageMode::Archetype) {
+            return archetypeStorage->Has<T>(entity);
+        }
         return GetComponentArray<T>()->HasData(entity);
     }
 
+    // A non-const T counts as a write and stamps the row's changed tick
     template<typename T>
     T& GetComponent(NtEntity entity)
     {
-        // Get a reference to a component from the array for an entity
-        return GetComponentArray<T>()->GetData(entity);
+        using Component = std::remove_const_t<T>;
+
+        if constexpr (!std::is_const_v<T>) {
+            GetTicks<Component>(entity).changed = GetChangeTick();
+        }
+        if (storageMode == NtStorageMode::Archetype) {
+            return archetypeStorage->Get<Component>(entity);
+        }
+        return GetComponentArray<Component>()->GetData(entity);
+    }
+
+    template<typename T>
+    NtComponentTicks& GetTicks(NtEntity entity)
+    {
+        if (storageMode == NtStorageMode::Archetype) {
+            return archetypeStorage->Ticks<T>(entity);
+        }
+        auto* array = GetComponentArray<T>();
+        return array->TicksAt(array->IndexOf(entity));
     }
 
+    // Tick stamped on rows written right now
+    uint32_t GetChangeTick() const { return changeTick.load(std::memory_order_relaxed); }
+
+    // Returns the current tick and advances it, so every write made after the
+    // call compares greater than the returned value
+    uint32_t ClaimChangeTick() { return changeTick.fetch_add(1, std::memory_order_relaxed); }
+
     void EntityDestroyed(NtEntity entity)
     {
+        if (storageMode == NtStorageMode::Archetype) {
+            archetypeStorage->EntityDestroyed(entity);
+            return;
+        }
+
         // Notify each component array that an entity has been destroyed
         // If it has a component for that entity, it will remove it
-        for (auto const& pair : componentArrays)
+        for (auto const& component : componentArrays)
         {
-            auto const& component = pair.second;
+            if (component) {
+                component->EntityDestroyed(entity);
+            }
+        }
+    }
+
+    NtStorageMode GetStorageMode() const { return storageMode; }
+
+    // Non-owning access to the component array of type T, no refcounting or hashing
+    template<typename T>
+    NtComponentArray<T>* GetComponentArray() {
+        const NtComponentType type = ComponentTypeId<T>();
+
+        assert(storageMode == NtStorageMode::Sparse && "Component arrays only exist in sparse storage mode");
+        assert(componentArrays[type] && "Component not registered before use");
+
+        return static_cast<NtComponentArray<T>*>(componentArrays[type].get());
+    }
+
+    // Only valid in archetype storage mode
+    NtArchetypeStorage* GetArchetypeStorage() {
+        assert(storageMode == NtStorageMode::Archetype && "Archetypes only exist in archetype storage mode");
+        return archetypeStorage.get();
+    }
+
+private:
+    NtStorageMode storageMode;
+
+    // Size, alignment and relocation functions indexed by component type ID
+    std::array<NtComponentInfo, MAX_COMPONENTS> componentInfos{};
+
+    // Sparse mode: component arrays indexed by component type ID
+    std::array<std::unique_ptr<IComponentArray>, MAX_COMPONENTS> componentArrays{};
 
-            component->EntityDestroyed(entity);
+    // Archetype mode: rows grouped by signature
+    std::unique_ptr<NtArchetypeStorage> archetypeStorage;
+
+    // Starts at 1 so rows written before a system's first claim compare newer than its initial 0
+    std::atomic<uint32_t> changeTick{1};
+};
+
+//==============================
+// VIEW
+//==============================
+// Joined iteration over every entity that has all of Ts. A const T hands out
+// const references; a non-const T counts as a write and stamps the changed
+// tick of every row it visits. Components must not be added or removed while
+// iterating.
+// In sparse mode the smallest pool drives the loop and the others are probed
+// through their sparse arrays, so the cost follows the rarest component.
+// In archetype mode only matching archetypes are visited, chunk by chunk.
+template<typename... Ts>
+class NtView
+{
+    static_assert(sizeof...(Ts) > 0, "View needs at least one component type");
+
+public:
+    explicit NtView(NtComponentManager& manager)
+        : componentManager(&manager)
+    {
+        (required.set(manager.GetComponentType<std::remove_const_t<Ts>>()), ...);
+
+        if (manager.GetStorageMode() == NtStorageMode::Sparse) {
+            pools = {manager.GetComponentArray<std::remove_const_t<Ts>>()...};
+        }
+    }
+
+    // Skip entities that have any of Ex
+    template<typename... Ex>
+    NtView& Exclude() {
+        (excludedSignature.set(componentManager->GetComponentType<Ex>()), ...);
+
+        if (componentManager->GetStorageMode() == NtStorageMode::Sparse) {
+            ((excluded[excludedCount++] = componentManager->GetComponentArray<Ex>()), ...);
+        }
+        return *this;
+    }
+
+    // Only entities that have all of Cs, where any of them was written after
+    // sinceTick. Pass the tick returned by the previous NtNexus::ClaimChangeTick().
+    template<typename... Cs>
+    NtView& Changed(uint32_t sinceTick) {
+        (AddTickFilter<Cs>(changedFilter), ...);
+        changedFilter.since = sinceTick;
+        return *this;
+    }
+
+    // Only entities that have all of Cs, where any of them was added after sinceTick
+    template<typename... Cs>
+    NtView& Added(uint32_t sinceTick) {
+        (AddTickFilter<Cs>(addedFilter), ...);
+        addedFilter.since = sinceTick;
+        return *this;
+    }
+
+    // func(NtEntity, Ts&...) or func(Ts&...)
+    template<typename Func>
+    void Each(Func&& func) {
+        if (componentManager->GetStorageMode() == NtStorageMode::Archetype) {
+            EachArchetypeChunk([&](uint32_t count, const NtEntity* entities, Ts*... columns) {
+                for (uint32_t row = 0; row < count; ++row) {
+                    Invoke(func, entities[row], columns[row]...);
+                }
+            });
+        }
+        else {
+            EachSparse(func, std::index_sequence_for<Ts...>{});
+        }
+    }
+
+    // func(uint32_t count, const NtEntity* entities, Ts*... columns) for bulk updates.
+    // Archetype mode hands out whole chunk columns, or runs of matching rows when
+    // a tick filter is set. Sparse mode has no shared row order between pools so
+    // it degrades to one entity per call.
+    template<typename Func>
+    void EachChunk(Func&& func) {
+        if (componentManager->GetStorageMode() == NtStorageMode::Archetype) {
+            EachArchetypeChunk(func);
+        }
+        else {
+            auto single = [&](NtEntity entity, Ts&... components) { func(1u, &entity, &components...); };
+            EachSparse(single, std::index_sequence_for<Ts...>{});
         }
     }
 
 private:
-    // Map from type string pointer to a component type
-    std::unordered_map<std::type_index, NtComponentType> componentTypes{};
+    // Rows pass when any of the listed components has a tick newer than since
+    struct TickFilter {
+        std::array<NtComponentType, MAX_COMPONENTS> types{};
+        std::array<const IComponentArray*, MAX_COMPONENTS> pools{}; // Sparse mode only
+        size_t count = 0;
+        uint32_t since = 0;
+    };
+
+    template<typename C>
+    void AddTickFilter(TickFilter& filter) {
+        const NtComponentType type = componentManager->GetComponentType<C>();
+        required.set(type);
+
+        filter.types[filter.count] = type;
+        if (componentManager->GetStorageMode() == NtStorageMode::Sparse) {
+            filter.pools[filter.count] = componentManager->GetComponentArray<C>();
+        }
+        ++filter.count;
+    }
+
+    bool HasTickFilters() const { return changedFilter.count > 0 || addedFilter.count > 0; }
+
+    template<typename Func>
+    static void Invoke(Func& func, NtEntity entity, Ts&... components) {
+        if constexpr (std::is_invocable_v<Func&, NtEntity, Ts&...>) {
+            func(entity, components...);
+        } else {
+            func(components...);
+        }
+    }
 
-    // Map from type striong pointer to a component array
-    std::unordered_map<std::type_index, std::shared_ptr<IComponentArray>> componentArrays{};
+    template<typename Func>
+    void EachArchetypeChunk(Func&& func) {
+        const uint32_t tick = componentManager->GetChangeTick();
+
+        for (NtArchetype* archetype : componentManager->GetArchetypeStorage()->Archetypes()) {
+            const NtSignature signature = archetype->Signature();
+            if ((signature & required) != required || (signature & excludedSignature).any()) continue;
+
+            for (size_t chunk = 0; chunk < archetype->ChunkCount(); ++chunk) {
+                const uint32_t count = archetype->ChunkRowCount(chunk);
+                if (!HasTickFilters()) {
+                    EmitRun(func, *archetype, chunk, 0, count, tick);
+                    continue;
+                }
+
+                // Hand out each run of consecutive rows that pass the filters
+                for (uint32_t row = 0; row < count;) {
+                    while (row < count && !PassesTickFilters(*archetype, chunk, row)) ++row;
+                    const uint32_t first = row;
+                    while (row < count && PassesTickFilters(*archetype, chunk, row)) ++row;
+
+                    if (row > first) EmitRun(func, *archetype, chunk, first, row - first, tick);
+                }
+            }
+        }
+    }
 
-    // The component type to be assigned to the next registered component, starting at 0
-    NtComponentType nextComponentType{};
+    template<typename Func>
+    static void EmitRun(Func& func, NtArchetype& archetype, size_t chunk, uint32_t first, uint32_t count, uint32_t tick) {
+        (StampRun<Ts>(archetype, chunk, first, count, tick), ...);
+        func(count, archetype.ChunkEntities(chunk) + first,
+            archetype.template ChunkColumn<std::remove_const_t<Ts>>(chunk) + first...);
+    }
 
-    // Convenience function to get the statically casted pointer to the ComponentArray of type T
     template<typename T>
-    std::shared_ptr<NtComponentArray<T>> GetComponentArray() {
-        std::type_index typeIndex(typeid(T));
+    static void StampRun(NtArchetype& archetype, size_t chunk, uint32_t first, uint32_t count, uint32_t tick) {
+        if constexpr (!std::is_const_v<T>) {
+            NtComponentTicks* ticks = archetype.ChunkTicks(archetype.ColumnOf(ComponentTypeId<T>()), chunk) + first;
+            for (uint32_t row = 0; row < count; ++row) {
+                ticks[row].changed = tick;
+            }
+        }
+    }
+
+    bool PassesTickFilters(NtArchetype& archetype, size_t chunk, uint32_t row) const {
+        return Passes(changedFilter, &NtComponentTicks::changed, [&](size_t i) -> const NtComponentTicks* {
+                return archetype.ChunkTicks(archetype.ColumnOf(changedFilter.types[i]), chunk) + row;
+            })
+            && Passes(addedFilter, &NtComponentTicks::added, [&](size_t i) -> const NtComponentTicks* {
+                return archetype.ChunkTicks(archetype.ColumnOf(addedFilter.types[i]), chunk) + row;
+            });
+    }
+
+    bool PassesTickFilters(NtEntity entity) const {
+        return Passes(changedFilter, &NtComponentTicks::changed, [&](size_t i) { return SparseTicks(changedFilter.pools[i], entity); })
+            && Passes(addedFilter, &NtComponentTicks::added, [&](size_t i) { return SparseTicks(addedFilter.pools[i], entity); });
+    }
+
+    // ticksOf(i) returns the row's ticks for the filter's i-th component, nullptr if it is missing
+    template<typename TicksOf>
+    static bool Passes(const TickFilter& filter, uint32_t NtComponentTicks::* tick, TicksOf&& ticksOf) {
+        if (filter.count == 0) return true;
+
+        bool bAny = false;
+        for (size_t i = 0; i < filter.count; ++i) {
+            const NtComponentTicks* ticks = ticksOf(i);
+            if (!ticks) return false;
+            bAny |= ticks->*tick > filter.since;
+        }
+        return bAny;
+    }
 
-        assert (componentTypes.find(typeIndex) != componentTypes.end() && "Component not registered before use");
+    static const NtComponentTicks* SparseTicks(const IComponentArray* pool, NtEntity entity) {
+        return pool->Contains(entity) ? &pool->TicksAt(pool->IndexOf(entity)) : nullptr;
+    }
+
+    template<typename Func, size_t... I>
+    void EachSparse(Func& func, std::index_sequence<I...>) {
+        const uint32_t tick = componentManager->GetChangeTick();
+        const NtSparseSet* driver = SmallestPool();
+        const NtEntity* entities = driver->Entities();
+
+        for (size_t index = 0, count = driver->Size(); index < count; ++index) {
+            const NtEntity entity = entities[index];
+
+            if (!(Probe(std::get<I>(pools), driver, entity) && ...)) continue;
+            if (IsExcluded(entity)) continue;
+            if (HasTickFilters() && !PassesTickFilters(entity)) continue;
+
+            Invoke(func, entity, Fetch<I>(driver, entity, index, tick)...);
+        }
+    }
+
+    const NtSparseSet* SmallestPool() const {
+        const NtSparseSet* smallest = std::get<0>(pools);
+        std::apply([&](auto*... pool) {
+            ((smallest = pool->Size() < smallest->Size() ? pool : smallest), ...);
+        }, pools);
+        return smallest;
+    }
+
+    static bool Probe(const NtSparseSet* pool, const NtSparseSet* driver, NtEntity entity) {
+        return pool == driver || pool->Contains(entity);
+    }
+
+    bool IsExcluded(NtEntity entity) const {
+        for (size_t i = 0; i < excludedCount; ++i) {
+            if (excluded[i]->Contains(entity)) return true;
+        }
+        return false;
+    }
 
-        return std::static_pointer_cast<NtComponentArray<T>>(componentArrays[typeIndex]);
+    // The driving pool is already at the right row, the rest go through the sparse array
+    template<size_t I>
+    std::tuple_element_t<I, std::tuple<Ts...>>& Fetch(const NtSparseSet* driver, NtEntity entity, size_t index, uint32_t tick) {
+        auto* pool = std::get<I>(pools);
+        const size_t row = pool == driver ? index : pool->IndexOf(entity);
+
+        if constexpr (!std::is_const_v<std::tuple_element_t<I, std::tuple<Ts...>>>) {
+            pool->TicksAt(row).changed = tick;
+        }
+        return pool->At(row);
     }
+
+    NtComponentManager* componentManager;
+    NtSignature required;
+    NtSignature excludedSignature;
+    TickFilter changedFilter;
+    TickFilter addedFilter;
+
+    // Sparse mode only
+    std::tuple<NtComponentArray<std::remove_const_t<Ts>>*...> pools{};
+    std::array<const NtSparseSet*, MAX_COMPONENTS> excluded{};
+    size_t excludedCount = 0;
 };
 
 //==============================
@@ -271,7 +1153,10 @@ private:
 class NtSystem
 {
 public:
-    std::set<NtEntity> entities;
+    NtEntitySet entities;
+
+    // Tick claimed at the start of the previous update, for Changed/Added filters
+    uint32_t lastRunTick = 0;
 };
 
 //==============================
@@ -287,63 +1172,172 @@ public:
     {
         std::type_index typeIndex(typeid(T));
 
-        assert(systems.find(typeIndex) == systems.end() && "Registering system more than once");
+        assert(systemIndices.find(typeIndex) == systemIndices.end() && "Registering system more than once");
 
         // Create a pointer to the system and return it so it can be used externally
         auto system = std::make_shared<T>(std::forward<Args>(args)...);
-        systems.insert({typeIndex, system});
+        systemIndices.insert({typeIndex, systems.size()});
+        systems.push_back(system);
+        signatures.emplace_back();
         return system;
     }
 
     template<typename T>
     void SetSignature(NtSignature signature)
     {
-        std::type_index typeIndex(typeid(T));
+        auto it = systemIndices.find(std::type_index(typeid(T)));
 
-        assert(systems.find(typeIndex) != systems.end() && "System used before registered");
+        assert(it != systemIndices.end() && "System used before registered");
 
         // Set the signature for this system
-        signatures.insert({typeIndex, signature});
+        signatures[it->second] = signature;
     }
 
     void EntityDestroyed(NtEntity entity)
     {
         // Erase a destroyed entity from all system lists
-        // entities is a set so no check needed
-        for (auto const& pair : systems)
+        for (auto const& system : systems)
         {
-            auto const& system = pair.second;
-
-            system->entities.erase(entity);
+            system->entities.Erase(entity);
         }
     }
 
-    void EntitySignatureChanged(NtEntity entity, NtSignature entitySignature)
+    void EntitySignatureChanged(NtEntity entity, NtSignature oldSignature, NtSignature newSignature)
     {
-        // Notify each system taht an entity's signature changed
-        for (auto const& pair : systems)
+        // Only systems that require one of the changed components can gain or lose the entity
+        const NtSignature changed = oldSignature ^ newSignature;
+
+        for (size_t i = 0; i < signatures.size(); ++i)
         {
-            auto const& type = pair.first;
-            auto const& system = pair.second;
-            auto const& systemSignature = signatures[type];
+            const NtSignature& systemSignature = signatures[i];
+            if ((systemSignature & changed).none()) continue;
 
             // Entity signature matches system signature - insert into set
-            if ((entitySignature & systemSignature) == systemSignature) {
-                system->entities.insert(entity);
+            if ((newSignature & systemSignature) == systemSignature) {
+                systems[i]->entities.Insert(entity);
             }
             // Entity signature does not match system signature - erase from set
             else {
-                system->entities.erase(entity);
+                systems[i]->entities.Erase(entity);
             }
         }
     }
 
 private:
-    // Map from system type string pointer to a signature
-    std::unordered_map<std::type_index, NtSignature> signatures{};
+    // System signatures, index-aligned with systems and scanned on every signature change
+    std::vector<NtSignature> signatures{};
+    std::vector<std::shared_ptr<NtSystem>> systems{};
+
+    // Only consulted when registering systems and setting their signatures
+    std::unordered_map<std::type_index, size_t> systemIndices{};
+};
+
+//==============================
+// COMMAND BUFFER
+//==============================
+// Entity created inside a command buffer. It only gets a real NtEntity when
+// the buffer is played back, and is only meaningful to the buffer that made it.
+struct NtPendingEntity
+{
+    uint32_t index;
+};
+
+class NtCommandPlayback;
+
+// Component adds and removes of one type, kept together so playback touches each pool once
+class ICommandQueue
+{
+public:
+    virtual ~ICommandQueue() = default;
+    virtual void ApplyRemoves(NtCommandPlayback& playback) = 0;
+    virtual void ApplyAdds(NtCommandPlayback& playback) = 0;
+    virtual void Clear() = 0;
+};
+
+// Records structural changes for later playback with NtNexus::FlushCommands().
+// Recording is not synchronized: each thread records into its own buffer,
+// see NtNexus::GetCommandBuffer(). On playback, per component type, removes
+// run before adds, and destroys run last. An add followed by a remove of the
+// same entity in one buffer is dropped, so the last command recorded wins.
+// Adding a component the entity already has overwrites it. Commands on dead
+// entities are dropped.
+class NtCommandBuffer
+{
+public:
+    // Target of a command: a live entity, or the index of an entity pending in this buffer
+    struct Target {
+        NtEntity entity;
+        bool bPending;
+    };
+
+    NtPendingEntity CreateEntity() {
+        return NtPendingEntity{pendingCount++};
+    }
+
+    void DestroyEntity(NtEntity entity) {
+        destroyed.push_back(entity);
+    }
+
+    template<typename T>
+    void AddComponent(NtEntity entity, T component) {
+        GetQueue<T>().adds.push_back({Target{entity, false}, std::move(component)});
+    }
+
+    template<typename T>
+    void AddComponent(NtPendingEntity entity, T component) {
+        GetQueue<T>().adds.push_back({Target{entity.index, true}, std::move(component)});
+    }
+
+    template<typename T>
+    void RemoveComponent(NtEntity entity) {
+        auto& queue = GetQueue<T>();
+        queue.removes.push_back({entity, static_cast<uint32_t>(queue.adds.size())});
+    }
+
+    bool Empty() const { return pendingCount == 0 && destroyed.empty() && !bHasComponentCommands; }
+
+    void Clear() {
+        pendingCount = 0;
+        destroyed.clear();
+        for (auto const& queue : queues) {
+            if (queue) queue->Clear();
+        }
+        bHasComponentCommands = false;
+    }
+
+private:
+    friend class NtCommandPlayback;
+    friend class NtNexus;
+
+    template<typename T>
+    struct ComponentQueue : ICommandQueue {
+        // Removes keep the number of adds recorded before them, to order the two per entity
+        std::vector<std::pair<Target, T>> adds;
+        std::vector<std::pair<NtEntity, uint32_t>> removes;
+
+        void ApplyRemoves(NtCommandPlayback& playback) override;
+        void ApplyAdds(NtCommandPlayback& playback) override;
+
+        void Clear() override {
+            adds.clear();
+            removes.clear();
+        }
+    };
+
+    template<typename T>
+    ComponentQueue<T>& GetQueue() {
+        auto& queue = queues[ComponentTypeId<T>()];
+        if (!queue) {
+            queue = std::make_unique<ComponentQueue<T>>();
+        }
+        bHasComponentCommands = true;
+        return static_cast<ComponentQueue<T>&>(*queue);
+    }
 
-    // Map from system type string pointer to a system pointer
-    std::unordered_map<std::type_index, std::shared_ptr<NtSystem>> systems{};
+    uint32_t pendingCount = 0;
+    std::vector<NtEntity> destroyed;
+    std::array<std::unique_ptr<ICommandQueue>, MAX_COMPONENTS> queues{};
+    bool bHasComponentCommands = false;
 };
 
 // Forward declaration
@@ -373,16 +1367,41 @@ private:
     NtNexus* nexus;
 };
 
+//==============================
+// Entity Builder Forward Declaration (batched construction)
+//==============================
+// Adds components without touching systems, then resolves system membership
+// once in Finish(), or when the builder goes out of scope.
+class NtEntityBuilder {
+public:
+    NtEntityBuilder(NtEntity id, NtNexus* nexus) : entity(id), nexus(nexus) {}
+    ~NtEntityBuilder();
+
+    NtEntityBuilder(const NtEntityBuilder&) = delete;
+    NtEntityBuilder& operator=(const NtEntityBuilder&) = delete;
+
+    template<typename T>
+    NtEntityBuilder& AddComponent(T component);
+
+    NtEntityHandle Finish();
+
+private:
+    NtEntity entity;
+    NtNexus* nexus;
+    NtSignature addedSignature{};
+    bool bFinished = false;
+};
+
 //==============================
 // Main ECS controller
 //==============================
 class NtNexus
 {
 public:
-    void Init()
+    void Init(NtStorageMode storageMode = NtStorageMode::Sparse)
     {
         // Create pointers to each manager
-        componentManager = std::make_unique<NtComponentManager>();
+        componentManager = std::make_unique<NtComponentManager>(storageMode);
         entityManager = std::make_unique<NtEntityManager>();
         systemManager = std::make_unique<NtSystemManager>();
     }
@@ -391,6 +1410,11 @@ public:
         return NtEntityHandle(entityManager->CreateEntity(), this);
     }
 
+    // Creates an entity whose system membership is resolved once, after all components are added
+    NtEntityBuilder BuildEntity() {
+        return NtEntityBuilder(entityManager->CreateEntity(), this);
+    }
+
     void DestroyEntity(NtEntity entity)
     {
         entityManager->DestroyEntity(entity);
@@ -398,6 +1422,17 @@ public:
         systemManager->EntityDestroyed(entity);
     }
 
+    // False once the entity is destroyed, even if its slot was recycled
+    bool IsAlive(NtEntity entity) const
+    {
+        return entityManager->IsAlive(entity);
+    }
+
+    uint32_t GetLivingEntityCount() const
+    {
+        return entityManager->GetLivingEntityCount();
+    }
+
     // Component methods
     template<typename T>
     void RegisterComponent()
@@ -408,13 +1443,14 @@ public:
     template<typename T>
     void AddComponent(NtEntity entity, T component)
     {
-        componentManager->AddComponent<T>(entity, component);
+        componentManager->AddComponent<T>(entity, std::move(component));
 
-        auto signature = entityManager->GetSignature(entity);
+        auto oldSignature = entityManager->GetSignature(entity);
+        auto signature = oldSignature;
         signature.set(componentManager->GetComponentType<T>(), true);
         entityManager->SetSignature(entity, signature);
 
-        systemManager->EntitySignatureChanged(entity, signature);
+        systemManager->EntitySignatureChanged(entity, oldSignature, signature);
     }
 
     template<typename T>
@@ -422,11 +1458,12 @@ public:
     {
         componentManager->RemoveComponent<T>(entity);
 
-        auto signature = entityManager->GetSignature(entity);
+        auto oldSignature = entityManager->GetSignature(entity);
+        auto signature = oldSignature;
         signature.set(componentManager->GetComponentType<T>(), false);
         entityManager->SetSignature(entity, signature);
 
-        systemManager->EntitySignatureChanged(entity, signature);
+        systemManager->EntitySignatureChanged(entity, oldSignature, signature);
     }
 
     template<typename T>
@@ -446,6 +1483,52 @@ public:
         return componentManager->GetComponentType<T>();
     }
 
+    NtStorageMode GetStorageMode() const
+    {
+        return componentManager->GetStorageMode();
+    }
+
+    // Change tracking. A system claims a tick at the start of its update and
+    // filters on the one it claimed last time:
+    //   const uint32_t since = std::exchange(lastRunTick, Nexus.ClaimChangeTick());
+    //   Nexus.View<const cTransform>().Changed<cTransform>(since).Each(...);
+    // Writes the system makes itself come after its claim, so it sees them on its next update.
+    uint32_t ClaimChangeTick()
+    {
+        return componentManager->ClaimChangeTick();
+    }
+
+    uint32_t GetChangeTick() const
+    {
+        return componentManager->GetChangeTick();
+    }
+
+    // Command buffer owned by the calling thread. Created on first use; later
+    // calls on the same thread return the same buffer without locking.
+    NtCommandBuffer& GetCommandBuffer()
+    {
+        thread_local struct {
+            uint64_t nexusId = 0;
+            NtCommandBuffer* buffer = nullptr;
+        } cached;
+
+        if (cached.nexusId != nexusId) {
+            cached = {nexusId, &RegisterCommandBuffer(std::this_thread::get_id())};
+        }
+        return *cached.buffer;
+    }
+
+    // Plays back every thread's command buffer. Must run at a sync point where
+    // no thread is recording and no system is iterating.
+    void FlushCommands();
+
+    // Joined iteration over all entities that have every component in Ts
+    template<typename... Ts>
+    NtView<Ts...> View()
+    {
+        return NtView<Ts...>(*componentManager);
+    }
+
     // System methods
     template<typename T, typename... Args>
     std::shared_ptr<T> RegisterSystem(Args&&... args)
@@ -460,9 +1543,52 @@ public:
     }
 
 private:
+    friend class NtEntityBuilder;
+    friend class NtCommandPlayback;
+
+    NtCommandBuffer& RegisterCommandBuffer(std::thread::id thread)
+    {
+        std::lock_guard<std::mutex> lock(commandBufferMutex);
+
+        for (auto const& [owner, buffer] : commandBuffers) {
+            if (owner == thread) return *buffer;
+        }
+        commandBuffers.emplace_back(thread, std::make_unique<NtCommandBuffer>());
+        return *commandBuffers.back().second;
+    }
+
+    // Stores a component without updating the signature or system membership
+    template<typename T>
+    void StoreComponent(NtEntity entity, T component)
+    {
+        componentManager->AddComponent<T>(entity, std::move(component));
+    }
+
+    // Applies a batch of stored components to the signature and systems in one go
+    void CommitComponents(NtEntity entity, NtSignature added)
+    {
+        CommitSignature(entity, entityManager->GetSignature(entity) | added);
+    }
+
+    void CommitSignature(NtEntity entity, NtSignature signature)
+    {
+        auto oldSignature = entityManager->GetSignature(entity);
+        entityManager->SetSignature(entity, signature);
+
+        systemManager->EntitySignatureChanged(entity, oldSignature, signature);
+    }
+
     std::unique_ptr<NtComponentManager> componentManager;
     std::unique_ptr<NtEntityManager> entityManager;
     std::unique_ptr<NtSystemManager> systemManager;
+
+    // Per-thread command buffers in registration order, the mutex only guards registration and playback
+    std::vector<std::pair<std::thread::id, std::unique_ptr<NtCommandBuffer>>> commandBuffers;
+    std::mutex commandBufferMutex;
+
+    // Distinguishes nexus instances in the per-thread command buffer cache
+    static inline std::atomic<uint64_t> nextNexusId{1};
+    const uint64_t nexusId = nextNexusId++;
 };
 
 //==============================
@@ -470,7 +1596,7 @@ private:
 //==============================
 template<typename T>
 NtEntityHandle& NtEntityHandle::AddComponent(T component) {
-    nexus->AddComponent<T>(entity, component);
+    nexus->AddComponent<T>(entity, std::move(component));
     return *this;
 }
 
@@ -484,4 +1610,195 @@ T& NtEntityHandle::GetComponent() {
     return nexus->GetComponent<T>(entity);
 }
 
+//==============================
+// Entity Builder Implementation (batched construction)
+//==============================
+template<typename T>
+NtEntityBuilder& NtEntityBuilder::AddComponent(T component) {
+    assert(!bFinished && "Adding components to a finished entity builder");
+
+    nexus->StoreComponent<T>(entity, std::move(component));
+    addedSignature.set(nexus->GetComponentType<T>());
+    return *this;
+}
+
+inline NtEntityHandle NtEntityBuilder::Finish() {
+    if (!bFinished) {
+        nexus->CommitComponents(entity, addedSignature);
+        bFinished = true;
+    }
+    return NtEntityHandle(entity, nexus);
+}
+
+inline NtEntityBuilder::~NtEntityBuilder() {
+    Finish();
+}
+
+//==============================
+// Command Buffer Playback
+//==============================
+// State shared by all queues during NtNexus::FlushCommands()
+class NtCommandPlayback
+{
+public:
+    NtCommandPlayback(NtNexus& nexus, const std::vector<NtCommandBuffer*>& buffers)
+        : nexus(nexus), created(buffers.size())
+    {
+        // Create pending entities, one list of real IDs per buffer
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            created[i].resize(buffers[i]->pendingCount);
+            for (auto& entity : created[i]) {
+                entity.entity = nexus.entityManager->CreateEntity();
+            }
+        }
+    }
+
+    // Selects the buffer whose pending entities targets refer to
+    void SetBuffer(size_t index) { buffer = index; }
+
+    NtEntity Resolve(NtCommandBuffer::Target target) const {
+        return target.bPending ? created[buffer][target.entity].entity : target.entity;
+    }
+
+    bool IsAlive(NtEntity entity) const { return nexus.IsAlive(entity); }
+
+    template<typename T>
+    bool HasComponent(NtEntity entity) { return nexus.componentManager->HasComponent<T>(entity); }
+
+    template<typename T>
+    T& GetComponent(NtEntity entity) { return nexus.componentManager->GetComponent<T>(entity); }
+
+    template<typename T>
+    void StoreComponent(NtCommandBuffer::Target target, NtEntity entity, T component) {
+        nexus.componentManager->AddComponent<T>(entity, std::move(component));
+        SignatureOf(target, entity).set(ComponentTypeId<T>());
+    }
+
+    template<typename T>
+    void EraseComponent(NtEntity entity) {
+        nexus.componentManager->RemoveComponent<T>(entity);
+        SignatureOf({entity, false}, entity).reset(ComponentTypeId<T>());
+    }
+
+    // Resolves system membership once per touched entity
+    void CommitSignatures() {
+        for (auto const& entities : created) {
+            for (auto const& [entity, signature] : entities) {
+                if (nexus.IsAlive(entity) && signature.any()) {
+                    nexus.CommitSignature(entity, signature);
+                }
+            }
+        }
+        for (auto const& [entity, signature] : signatures) {
+            if (nexus.IsAlive(entity)) {
+                nexus.CommitSignature(entity, signature);
+            }
+        }
+    }
+
+private:
+    struct CreatedEntity {
+        NtEntity entity;
+        NtSignature signature;
+    };
+
+    NtSignature& SignatureOf(NtCommandBuffer::Target target, NtEntity entity) {
+        // Pending entities start out empty and are tracked by index
+        if (target.bPending) {
+            return created[buffer][target.entity].signature;
+        }
+
+        auto [it, inserted] = signatures.try_emplace(entity);
+        if (inserted) {
+            it->second = nexus.entityManager->GetSignature(entity);
+        }
+        return it->second;
+    }
+
+    NtNexus& nexus;
+
+    // Entities created for each buffer's pending entities, with the signature they build up
+    std::vector<std::vector<CreatedEntity>> created;
+    size_t buffer = 0;
+
+    // Signature each touched pre-existing entity will have once playback is done
+    std::unordered_map<NtEntity, NtSignature> signatures;
+};
+
+template<typename T>
+void NtCommandBuffer::ComponentQueue<T>::ApplyRemoves(NtCommandPlayback& playback) {
+    for (auto const& [entity, addsBefore] : removes) {
+        if (playback.IsAlive(entity) && playback.HasComponent<T>(entity)) {
+            playback.EraseComponent<T>(entity);
+        }
+    }
+}
+
+template<typename T>
+void NtCommandBuffer::ComponentQueue<T>::ApplyAdds(NtCommandPlayback& playback) {
+    // Adds recorded before the entity's last remove were undone by it, pending entities
+    // can't be removed yet
+    std::unordered_map<NtEntity, uint32_t> lastRemove;
+    for (auto const& [entity, addsBefore] : removes) {
+        lastRemove[entity] = addsBefore;
+    }
+
+    for (uint32_t i = 0; i < adds.size(); ++i) {
+        auto& [target, component] = adds[i];
+        if (!target.bPending && !lastRemove.empty()) {
+            auto it = lastRemove.find(target.entity);
+            if (it != lastRemove.end() && i < it->second) continue;
+        }
+
+        const NtEntity entity = playback.Resolve(target);
+        if (!playback.IsAlive(entity)) continue;
+
+        if (playback.HasComponent<T>(entity)) {
+            playback.GetComponent<T>(entity) = std::move(component);
+        }
+        else {
+            playback.StoreComponent<T>(target, entity, std::move(component));
+        }
+    }
+}
+
+inline void NtNexus::FlushCommands()
+{
+    std::lock_guard<std::mutex> lock(commandBufferMutex);
+
+    std::vector<NtCommandBuffer*> buffers;
+    for (auto const& [thread, buffer] : commandBuffers) {
+        if (!buffer->Empty()) buffers.push_back(buffer.get());
+    }
+    if (buffers.empty()) return;
+
+    NtCommandPlayback playback(*this, buffers);
+
+    // Apply component commands one type at a time across all buffers
+    for (size_t type = 0; type < MAX_COMPONENTS; ++type) {
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            if (auto const& queue = buffers[i]->queues[type]) queue->ApplyRemoves(playback);
+        }
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            if (auto const& queue = buffers[i]->queues[type]) {
+                playback.SetBuffer(i);
+                queue->ApplyAdds(playback);
+            }
+        }
+    }
+
+    // Destroy before resolving membership so dead entities are skipped
+    for (NtCommandBuffer* buffer : buffers) {
+        for (NtEntity entity : buffer->destroyed) {
+            if (IsAlive(entity)) DestroyEntity(entity);
+        }
+    }
+
+    playback.CommitSignatures();
+
+    for (NtCommandBuffer* buffer : buffers) {
+        buffer->Clear();
+    }
+}
+
 }
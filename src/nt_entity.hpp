@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace nt {
+
+//==============================
+// ENTITY
+//==============================
+// A 24-bit slot index plus an 8-bit generation that is bumped every time the
+// slot is recycled, so handles to destroyed entities can be told apart.
+using NtEntity = std::uint32_t;
+
+constexpr uint32_t ENTITY_INDEX_BITS = 24;
+constexpr uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+constexpr uint32_t MAX_ENTITY_INDEX = ENTITY_INDEX_MASK;
+
+constexpr NtEntity INVALID_ENTITY = std::numeric_limits<NtEntity>::max();
+
+constexpr uint32_t EntityIndex(NtEntity entity) { return entity & ENTITY_INDEX_MASK; }
+constexpr uint32_t EntityGeneration(NtEntity entity) { return entity >> ENTITY_INDEX_BITS; }
+constexpr NtEntity MakeEntity(uint32_t index, uint32_t generation) { return (generation << ENTITY_INDEX_BITS) | index; }
+
+}
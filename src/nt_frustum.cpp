@@ -0,0 +1,84 @@
+#include "nt_frustum.hpp"
+
+#include <Jolt/Jolt.h>
+#include <Jolt/Math/Vec4.h>
+
+#include <algorithm>
+
+namespace nt
+{
+
+namespace {
+
+using JPH::Float4;
+using JPH::UVec4;
+using JPH::Vec4;
+
+constexpr size_t LANES = 4;
+
+Vec4 Load(const float* values) {
+    return Vec4::sLoadFloat4(reinterpret_cast<const Float4*>(values));
+}
+
+void CullSpheresFour(const NtFrustum& frustum, const float* x, const float* y, const float* z, const float* r,
+    uint8_t* outVisible, size_t count) {
+    const Vec4 cx = Load(x), cy = Load(y), cz = Load(z);
+    const Vec4 negRadius = -Load(r);
+
+    UVec4 inside = UVec4::sReplicate(0xffffffff);
+    for (const glm::vec4& plane : frustum.planes) {
+        const Vec4 distance = cx * plane.x + cy * plane.y + cz * plane.z + Vec4::sReplicate(plane.w);
+        inside = UVec4::sAnd(inside, Vec4::sGreaterOrEqual(distance, negRadius));
+    }
+
+    const int mask = inside.GetTrues();
+    for (size_t lane = 0; lane < count; ++lane) {
+        outVisible[lane] = (mask >> lane) & 1;
+    }
+}
+
+}
+
+NtFrustum NtFrustum::fromViewProjection(const glm::mat4& viewProjection) {
+    // Rows of the matrix; glm indexes columns first
+    glm::vec4 rows[4];
+    for (int row = 0; row < 4; ++row) {
+        rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row], viewProjection[2][row], viewProjection[3][row]);
+    }
+
+    // -w <= x, y <= w and 0 <= z <= w in clip space
+    NtFrustum frustum{{
+        rows[3] + rows[0],
+        rows[3] - rows[0],
+        rows[3] + rows[1],
+        rows[3] - rows[1],
+        rows[2],
+        rows[3] - rows[2]
+    }};
+
+    for (glm::vec4& plane : frustum.planes) {
+        const float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) plane /= length;
+    }
+    return frustum;
+}
+
+void CullSpheresBatch(const NtFrustum& frustum, const NtSphereStreams& spheres, uint8_t* outVisible, size_t count) {
+    const size_t fullCount = count - count % LANES;
+    for (size_t i = 0; i < fullCount; i += LANES) {
+        CullSpheresFour(frustum, spheres.centerX + i, spheres.centerY + i, spheres.centerZ + i, spheres.radius + i,
+            outVisible + i, LANES);
+    }
+
+    // Last partial group through zero-padded copies, the padding lanes are never written out
+    if (const size_t remaining = count - fullCount) {
+        alignas(16) float tail[4][LANES] = {};
+        const float* sources[4] = {spheres.centerX, spheres.centerY, spheres.centerZ, spheres.radius};
+        for (size_t stream = 0; stream < 4; ++stream) {
+            std::copy(sources[stream] + fullCount, sources[stream] + count, tail[stream]);
+        }
+        CullSpheresFour(frustum, tail[0], tail[1], tail[2], tail[3], outVisible + fullCount, remaining);
+    }
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nt
+{
+
+//==============================
+// FRUSTUM CULLING
+//==============================
+// Six normalized planes taken from a view-projection matrix, with Vulkan's
+// [0, 1] clip depth, and a sphere test that checks four spheres per step
+// using Jolt's Vec4 over structure-of-arrays bounds.
+
+struct NtFrustum
+{
+    // xyz = inward normal, w = distance; a point p is inside when dot(xyz, p) + w >= 0
+    glm::vec4 planes[6];
+
+    // Works for perspective and orthographic projections alike
+    static NtFrustum fromViewProjection(const glm::mat4& viewProjection);
+};
+
+struct NtSphereStreams
+{
+    const float* centerX;
+    const float* centerY;
+    const float* centerZ;
+    const float* radius;
+};
+
+// Writes 1 to outVisible for spheres touching the frustum, 0 otherwise.
+// Conservative: spheres near a frustum corner can pass without being inside.
+void CullSpheresBatch(const NtFrustum& frustum, const NtSphereStreams& spheres, uint8_t* outVisible, size_t count);
+
+}
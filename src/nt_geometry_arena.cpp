@@ -0,0 +1,306 @@
+#include "nt_geometry_arena.hpp"
+#include "nt_log.hpp"
+#include "nt_upload_batch.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+namespace nt
+{
+
+//==============================
+// RANGE ALLOCATOR
+//==============================
+
+NtGeometryArena::RangeAllocator::RangeAllocator(uint32_t capacity) : capacity{capacity}, freeCount{0} {
+    reset(0);
+}
+
+bool NtGeometryArena::RangeAllocator::allocate(uint32_t count, uint32_t& outOffset) {
+    if (count == 0) {
+        outOffset = 0;
+        return true;
+    }
+
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+        if (it->second < count) continue;
+
+        outOffset = it->first;
+        const uint32_t remaining = it->second - count;
+        freeRanges.erase(it);
+        if (remaining > 0) freeRanges.emplace(outOffset + count, remaining);
+
+        freeCount -= count;
+        return true;
+    }
+    return false;
+}
+
+void NtGeometryArena::RangeAllocator::release(uint32_t offset, uint32_t count) {
+    if (count == 0) return;
+    assert(offset + count <= capacity && "Released range is outside of the block");
+    freeCount += count;
+
+    auto next = freeRanges.lower_bound(offset);
+    assert((next == freeRanges.end() || next->first >= offset + count) && "Range released twice");
+
+    // Merge with the free range that ends where this one starts
+    if (next != freeRanges.begin()) {
+        auto previous = std::prev(next);
+        assert(previous->first + previous->second <= offset && "Range released twice");
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            count += previous->second;
+            freeRanges.erase(previous);
+        }
+    }
+
+    // And with the one that starts where it ends
+    if (next != freeRanges.end() && next->first == offset + count) {
+        count += next->second;
+        freeRanges.erase(next);
+    }
+
+    freeRanges.emplace(offset, count);
+}
+
+void NtGeometryArena::RangeAllocator::reset(uint32_t used) {
+    assert(used <= capacity && "Block overfilled");
+    freeRanges.clear();
+    if (used < capacity) freeRanges.emplace(used, capacity - used);
+    freeCount = capacity - used;
+}
+
+uint32_t NtGeometryArena::RangeAllocator::getLargestFree() const {
+    uint32_t largest = 0;
+    for (const auto& [offset, count] : freeRanges) largest = std::max(largest, count);
+    return largest;
+}
+
+//==============================
+// GEOMETRY ARENA
+//==============================
+
+// Blocks are created on demand, one vertex layout at a time
+NtGeometryArena::NtGeometryArena(NtDevice& device) : ntDevice{device} {}
+
+NtGeometryArena::~NtGeometryArena() {
+    if (entries.size() != freeHandles.size()) {
+        NT_LOG_WARN(LogRendering, "Geometry arena destroyed with {} live meshes", entries.size() - freeHandles.size());
+    }
+}
+
+uint32_t NtGeometryArena::createBlock(VkDeviceSize vertexStride, VkIndexType indexType, uint32_t vertexCapacity,
+    uint32_t indexCapacity) {
+    blocks.push_back({vertexStride, indexType, nullptr, nullptr, RangeAllocator{vertexCapacity}, RangeAllocator{indexCapacity}});
+    createBlockBuffers(blocks.back());
+
+    NT_LOG_VERBOSE(LogRendering, "Geometry block {} created: {} vertices of {} bytes, {} indices of {} bytes",
+        blocks.size() - 1, vertexCapacity, vertexStride, indexCapacity, blocks.back().indexSize());
+    return static_cast<uint32_t>(blocks.size() - 1);
+}
+
+void NtGeometryArena::createBlockBuffers(Block& block) {
+    // Transfer source as well, defragmenting copies out of the old buffers. Vertices are
+    // storage buffers too, the skinning pass reads them.
+    block.vertexBuffer = std::make_unique<NtBuffer>(
+        ntDevice,
+        block.vertexStride,
+        block.vertices.getCapacity(),
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    block.indexBuffer = std::make_unique<NtBuffer>(
+        ntDevice,
+        block.indexSize(),
+        block.indices.getCapacity(),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+NtGeometryHandle NtGeometryArena::allocate(const void* vertices, uint32_t vertexCount, VkDeviceSize vertexStride,
+    const void* indices, uint32_t indexCount, VkIndexType indexType, NtUploadBatch* batch) {
+    NtGeometryRange range{};
+    range.vertexCount = vertexCount;
+    range.indexCount = indexCount;
+
+    // First block of the same layouts with room for both streams, a new one otherwise
+    bool bPlaced = false;
+    for (uint32_t i = 0; i < blocks.size() && !bPlaced; ++i) {
+        auto& block = blocks[i];
+        if (block.vertexStride != vertexStride || block.indexType != indexType) continue;
+        if (block.vertices.getFree() < vertexCount || block.indices.getFree() < indexCount) continue;
+        if (!block.vertices.allocate(vertexCount, range.vertexOffset)) continue;
+        if (!block.indices.allocate(indexCount, range.firstIndex)) {
+            block.vertices.release(range.vertexOffset, vertexCount);
+            continue;
+        }
+        range.block = i;
+        bPlaced = true;
+    }
+
+    if (!bPlaced) {
+        range.block = createBlock(vertexStride, indexType, std::max(vertexCount, BLOCK_VERTICES), std::max(indexCount, BLOCK_INDICES));
+        auto& block = blocks[range.block];
+        block.vertices.allocate(vertexCount, range.vertexOffset);
+        block.indices.allocate(indexCount, range.firstIndex);
+    }
+
+    // Both streams go up through the staging ring, in the caller's batch when there is one
+    const VkDeviceSize vertexBytes = vertexStride * vertexCount;
+    const VkDeviceSize indexSize = blocks[range.block].indexSize();
+    const VkDeviceSize indexBytes = indexSize * indexCount;
+    if (vertexBytes + indexBytes > 0) {
+        std::optional<NtUploadBatch> ownBatch;
+        if (!batch) {
+            ownBatch.emplace(ntDevice);
+            batch = &*ownBatch;
+        }
+
+        const auto& block = blocks[range.block];
+        batch->copyToBuffer(block.vertexBuffer->getBuffer(), vertexStride * range.vertexOffset, vertices, vertexBytes);
+        batch->copyToBuffer(block.indexBuffer->getBuffer(), indexSize * range.firstIndex, indices, indexBytes);
+
+        if (ownBatch) {
+            ownBatch->submit();
+            ownBatch->wait();
+        }
+    }
+
+    NtGeometryHandle handle;
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    } else {
+        handle = static_cast<NtGeometryHandle>(entries.size());
+        entries.emplace_back();
+    }
+    entries[handle] = {range, true};
+    return handle;
+}
+
+void NtGeometryArena::release(NtGeometryHandle handle) {
+    if (handle == NT_INVALID_GEOMETRY) return;
+    assert(handle < entries.size() && entries[handle].bLive && "Releasing a dead geometry handle");
+
+    auto& entry = entries[handle];
+    auto& block = blocks[entry.range.block];
+    block.vertices.release(entry.range.vertexOffset, entry.range.vertexCount);
+    block.indices.release(entry.range.firstIndex, entry.range.indexCount);
+
+    entry = {};
+    freeHandles.push_back(handle);
+}
+
+void NtGeometryArena::bind(VkCommandBuffer commandBuffer, uint32_t block) const {
+    assert(block < blocks.size() && "Geometry block out of range");
+
+    VkBuffer buffers[] = {blocks[block].vertexBuffer->getBuffer()};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, blocks[block].indexBuffer->getBuffer(), 0, blocks[block].indexType);
+}
+
+void NtGeometryArena::bindIndices(VkCommandBuffer commandBuffer, uint32_t block) const {
+    assert(block < blocks.size() && "Geometry block out of range");
+
+    vkCmdBindIndexBuffer(commandBuffer, blocks[block].indexBuffer->getBuffer(), 0, blocks[block].indexType);
+}
+
+VkDescriptorBufferInfo NtGeometryArena::getVertexBufferInfo(uint32_t block) const {
+    assert(block < blocks.size() && "Geometry block out of range");
+
+    return blocks[block].vertexBuffer->descriptorInfo();
+}
+
+void NtGeometryArena::defragment() {
+    // Old buffers may still be read by frames in flight
+    vkDeviceWaitIdle(ntDevice.device());
+
+    for (uint32_t blockIndex = 0; blockIndex < blocks.size(); ++blockIndex) {
+        auto& block = blocks[blockIndex];
+        if (block.vertices.getFreeRangeCount() <= 1 && block.indices.getFreeRangeCount() <= 1) continue;
+        const VkDeviceSize vertexStride = block.vertexStride;
+        const VkDeviceSize indexSize = block.indexSize();
+
+        // Live ranges of this block in their current order, packed to the front
+        std::vector<Entry*> live;
+        for (auto& entry : entries) {
+            if (entry.bLive && entry.range.block == blockIndex) live.push_back(&entry);
+        }
+        std::sort(live.begin(), live.end(), [](const Entry* a, const Entry* b) {
+            return a->range.vertexOffset < b->range.vertexOffset;
+        });
+
+        std::vector<VkBufferCopy> vertexRegions;
+        std::vector<VkBufferCopy> indexRegions;
+        uint32_t vertexCursor = 0;
+        uint32_t indexCursor = 0;
+        for (Entry* entry : live) {
+            auto& range = entry->range;
+            if (range.vertexCount > 0) {
+                vertexRegions.push_back({vertexStride * range.vertexOffset, vertexStride * vertexCursor, vertexStride * range.vertexCount});
+            }
+            if (range.indexCount > 0) {
+                indexRegions.push_back({indexSize * range.firstIndex, indexSize * indexCursor, indexSize * range.indexCount});
+            }
+            range.vertexOffset = range.vertexCount > 0 ? vertexCursor : 0;
+            range.firstIndex = range.indexCount > 0 ? indexCursor : 0;
+            vertexCursor += range.vertexCount;
+            indexCursor += range.indexCount;
+        }
+
+        // Copy into fresh buffers, regions within one buffer must not overlap
+        std::unique_ptr<NtBuffer> oldVertices = std::move(block.vertexBuffer);
+        std::unique_ptr<NtBuffer> oldIndices = std::move(block.indexBuffer);
+        createBlockBuffers(block);
+
+        VkCommandBuffer commandBuffer = ntDevice.beginSingleTimeCommands();
+        if (!vertexRegions.empty()) {
+            vkCmdCopyBuffer(commandBuffer, oldVertices->getBuffer(), block.vertexBuffer->getBuffer(),
+                static_cast<uint32_t>(vertexRegions.size()), vertexRegions.data());
+        }
+        if (!indexRegions.empty()) {
+            vkCmdCopyBuffer(commandBuffer, oldIndices->getBuffer(), block.indexBuffer->getBuffer(),
+                static_cast<uint32_t>(indexRegions.size()), indexRegions.data());
+        }
+        ntDevice.endSingleTimeCommands(commandBuffer);
+
+        block.vertices.reset(vertexCursor);
+        block.indices.reset(indexCursor);
+        ++rangeVersion;
+
+        NT_LOG_VERBOSE(LogRendering, "Geometry block {} defragmented: {} meshes, {} vertices, {} indices",
+            blockIndex, live.size(), vertexCursor, indexCursor);
+    }
+}
+
+NtGeometryStats NtGeometryArena::getStats() const {
+    NtGeometryStats stats{};
+    stats.blocks = static_cast<uint32_t>(blocks.size());
+    stats.allocations = static_cast<uint32_t>(entries.size() - freeHandles.size());
+
+    VkDeviceSize freeBytes = 0;
+    VkDeviceSize largestFreeBytes = 0;
+    for (const auto& block : blocks) {
+        const VkDeviceSize vertexStride = block.vertexStride;
+        const VkDeviceSize indexSize = block.indexSize();
+        const VkDeviceSize capacity = vertexStride * block.vertices.getCapacity() + indexSize * block.indices.getCapacity();
+        const VkDeviceSize blockFree = vertexStride * block.vertices.getFree() + indexSize * block.indices.getFree();
+
+        stats.capacityBytes += capacity;
+        stats.usedBytes += capacity - blockFree;
+        stats.freeRanges += block.vertices.getFreeRangeCount() + block.indices.getFreeRangeCount();
+
+        freeBytes += blockFree;
+        largestFreeBytes += vertexStride * block.vertices.getLargestFree() + indexSize * block.indices.getLargestFree();
+    }
+    stats.fragmentation = freeBytes > 0 ? 1.0f - static_cast<float>(largestFreeBytes) / static_cast<float>(freeBytes) : 0.0f;
+    return stats;
+}
+
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "nt_buffer.hpp"
+#include "nt_device.hpp"
+#include "vulkan/vulkan_core.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace nt
+{
+
+class NtUploadBatch;
+
+//==============================
+// GEOMETRY ARENA
+//==============================
+// Vertex and index data of every mesh, suballocated from a few large
+// device-local buffers. A block pairs one vertex buffer with one index buffer,
+// so meshes in the same block share their bindings and are told apart by
+// firstIndex / vertexOffset. Ranges are handed out first fit from a free list
+// that coalesces neighbours on release. Meshes bigger than a block get a block
+// of their own. Each block holds one vertex layout and one index type, meshes
+// only share blocks with meshes of the same vertex stride and index width.
+
+using NtGeometryHandle = uint32_t;
+constexpr NtGeometryHandle NT_INVALID_GEOMETRY = UINT32_MAX;
+
+// Where a mesh lives, in vertices and indices (not bytes)
+struct NtGeometryRange {
+    uint32_t block = 0;
+    uint32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+};
+
+struct NtGeometryStats {
+    uint32_t blocks = 0;
+    uint32_t allocations = 0;
+    VkDeviceSize usedBytes = 0;
+    VkDeviceSize capacityBytes = 0;
+    uint32_t freeRanges = 0;
+    float fragmentation = 0.0f;     // 1 - largest free range of each block and stream / free space
+};
+
+class NtGeometryArena
+{
+public:
+    static constexpr uint32_t BLOCK_VERTICES = 1u << 19;
+    static constexpr uint32_t BLOCK_INDICES = 1u << 21;
+
+    explicit NtGeometryArena(NtDevice& device);
+    ~NtGeometryArena();
+
+    NtGeometryArena(const NtGeometryArena&) = delete;
+    NtGeometryArena& operator=(const NtGeometryArena&) = delete;
+
+    // Reserves a range and records the upload into the batch, the range is drawable once
+    // the batch completes. Without a batch it is uploaded before returning.
+    // Indices are uint16_t or uint32_t as indexType says.
+    NtGeometryHandle allocate(const void* vertices, uint32_t vertexCount, VkDeviceSize vertexStride,
+        const void* indices, uint32_t indexCount, VkIndexType indexType, NtUploadBatch* batch = nullptr);
+    void release(NtGeometryHandle handle);
+
+    // Ranges move on defragment, look them up again rather than keeping copies
+    const NtGeometryRange& getRange(NtGeometryHandle handle) const { return entries[handle].range; }
+
+    void bind(VkCommandBuffer commandBuffer, uint32_t block) const;
+    // Index buffer only, for vertices that come from elsewhere (skinned meshes)
+    void bindIndices(VkCommandBuffer commandBuffer, uint32_t block) const;
+    // A block's vertex buffer as a storage buffer, for the skinning pass. Defragmenting
+    // replaces the buffers, so descriptors must be written again afterwards.
+    VkDescriptorBufferInfo getVertexBufferInfo(uint32_t block) const;
+
+    // Packs the live ranges of every block to its front. Waits for the device to be idle,
+    // so call it between frames.
+    void defragment();
+    // Bumped by every defragment that moved ranges, for caches of range offsets
+    uint32_t getRangeVersion() const { return rangeVersion; }
+
+    NtGeometryStats getStats() const;
+
+private:
+    // First-fit free list over [0, capacity), in elements
+    class RangeAllocator {
+    public:
+        explicit RangeAllocator(uint32_t capacity);
+
+        bool allocate(uint32_t count, uint32_t& outOffset);
+        void release(uint32_t offset, uint32_t count);
+        void reset(uint32_t used);  // Everything below used is taken, the rest is free
+
+        uint32_t getCapacity() const { return capacity; }
+        uint32_t getFree() const { return freeCount; }
+        uint32_t getLargestFree() const;
+        uint32_t getFreeRangeCount() const { return static_cast<uint32_t>(freeRanges.size()); }
+
+    private:
+        uint32_t capacity;
+        uint32_t freeCount;
+        std::map<uint32_t, uint32_t> freeRanges;    // offset -> count
+    };
+
+    struct Block {
+        VkDeviceSize vertexStride;
+        VkIndexType indexType;
+        VkDeviceSize indexSize() const { return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t); }
+        std::unique_ptr<NtBuffer> vertexBuffer;
+        std::unique_ptr<NtBuffer> indexBuffer;
+        RangeAllocator vertices;
+        RangeAllocator indices;
+    };
+
+    struct Entry {
+        NtGeometryRange range{};
+        bool bLive = false;
+    };
+
+    uint32_t createBlock(VkDeviceSize vertexStride, VkIndexType indexType, uint32_t vertexCapacity, uint32_t indexCapacity);
+    void createBlockBuffers(Block& block);
+
+    NtDevice& ntDevice;
+
+    std::vector<Block> blocks;
+    std::vector<Entry> entries;
+    std::vector<NtGeometryHandle> freeHandles;
+    uint32_t rangeVersion = 0;
+};
+
+}
@@ -0,0 +1,312 @@
+#include "nt_gpu_culling.hpp"
+#include "nt_log.hpp"
+#include "nt_pipeline.hpp"
+#include "nt_swap_chain.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <stdexcept>
+
+namespace nt
+{
+
+namespace {
+
+constexpr uint32_t WORKGROUP_SIZE = 64;     // local_size_x in cull.comp
+constexpr uint32_t STORAGE_BINDINGS = 13;
+constexpr VkBufferUsageFlags INDIRECT_USAGE = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+constexpr VkBufferUsageFlags COUNTER_USAGE = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+// Steps of cull.comp, in dispatch order
+constexpr uint32_t STEP_UPLOAD = 0;
+constexpr uint32_t STEP_CULL = 1;
+constexpr uint32_t STEP_ALLOCATE = 2;
+constexpr uint32_t STEP_SCATTER = 3;
+
+}
+
+NtGpuCuller::NtGpuCuller(NtDevice& device, const std::vector<VkDescriptorBufferInfo>& instanceBuffers)
+    : ntDevice{device} {
+    assert(instanceBuffers.size() == NtSwapChain::MAX_FRAMES_IN_FLIGHT && "One instance buffer per frame in flight");
+
+    setLayout = NtDescriptorSetLayout::Builder(ntDevice)
+        .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)  // Objects
+        .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)  // Object instances
+        .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)  // Draw slots
+        .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)  // Object LODs
+        .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)  // Object uploads
+        .addBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)  // Slot uploads
+        .addBinding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)  // Object draws
+        .addBinding(7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)  // Slot counts
+        .addBinding(8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)  // Slot bases
+        .addBinding(9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)  // Instance cursor
+        .addBinding(10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Draw commands
+        .addBinding(11, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Run draw counts
+        .addBinding(12, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Visible instances
+        .addBinding(13, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Frusta and LOD thresholds
+        .build();
+
+    pool = NtDescriptorPool::Builder(ntDevice)
+        .setMaxSets(NtSwapChain::MAX_FRAMES_IN_FLIGHT)
+        .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NtSwapChain::MAX_FRAMES_IN_FLIGHT * STORAGE_BINDINGS)
+        .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, NtSwapChain::MAX_FRAMES_IN_FLIGHT)
+        .build();
+
+    // Scene tables are only written by the upload step, so they live in device-local memory
+    objectBuffer = std::make_unique<NtBuffer>(ntDevice, sizeof(NtGpuObject), MAX_OBJECTS,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    objectInstanceBuffer = std::make_unique<NtBuffer>(ntDevice, sizeof(NtInstanceData), MAX_OBJECTS,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    slotBuffer = std::make_unique<NtBuffer>(ntDevice, sizeof(NtGpuDrawSlot), MAX_SLOTS,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    objectLodBuffer = std::make_unique<NtBuffer>(ntDevice, sizeof(uint32_t), MAX_OBJECTS,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    // Uploads and parameters are host-visible like the UBO, written every frame. The rest is
+    // only touched by the GPU, counters are reset with vkCmdFillBuffer.
+    frames.resize(NtSwapChain::MAX_FRAMES_IN_FLIGHT);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        auto& frame = frames[i];
+        frame.objectUploads = std::make_unique<NtBuffer>(ntDevice, sizeof(ObjectUpload), MAX_OBJECTS,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        frame.slotUploads = std::make_unique<NtBuffer>(ntDevice, sizeof(NtGpuDrawSlot), MAX_SLOTS,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        frame.params = std::make_unique<NtBuffer>(ntDevice, sizeof(CullParams), 1,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        frame.objectDraws = std::make_unique<NtBuffer>(ntDevice, 4 * sizeof(uint32_t), MAX_OBJECTS,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        frame.slotCounts = std::make_unique<NtBuffer>(ntDevice, sizeof(uint32_t), MAX_SLOTS,
+            COUNTER_USAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        frame.slotBases = std::make_unique<NtBuffer>(ntDevice, sizeof(uint32_t), MAX_SLOTS,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        frame.instanceCursor = std::make_unique<NtBuffer>(ntDevice, sizeof(uint32_t), 1,
+            COUNTER_USAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        frame.commands = std::make_unique<NtBuffer>(ntDevice, sizeof(VkDrawIndexedIndirectCommand), MAX_SLOTS,
+            INDIRECT_USAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        frame.runCounts = std::make_unique<NtBuffer>(ntDevice, sizeof(uint32_t), MAX_SLOTS,
+            INDIRECT_USAGE | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        for (NtBuffer* buffer : {frame.objectUploads.get(), frame.slotUploads.get(), frame.params.get()}) {
+            buffer->map();
+        }
+
+        VkDescriptorBufferInfo infos[] = {
+            objectBuffer->descriptorInfo(),
+            objectInstanceBuffer->descriptorInfo(),
+            slotBuffer->descriptorInfo(),
+            objectLodBuffer->descriptorInfo(),
+            frame.objectUploads->descriptorInfo(),
+            frame.slotUploads->descriptorInfo(),
+            frame.objectDraws->descriptorInfo(),
+            frame.slotCounts->descriptorInfo(),
+            frame.slotBases->descriptorInfo(),
+            frame.instanceCursor->descriptorInfo(),
+            frame.commands->descriptorInfo(),
+            frame.runCounts->descriptorInfo(),
+            instanceBuffers[i],
+            frame.params->descriptorInfo(),
+        };
+
+        NtDescriptorWriter writer(*setLayout, *pool);
+        for (uint32_t binding = 0; binding < std::size(infos); ++binding) {
+            writer.writeBuffer(binding, &infos[binding]);
+        }
+        writer.build(frame.descriptorSet);
+    }
+
+    createPipeline();
+}
+
+NtGpuCuller::~NtGpuCuller() {
+    vkDestroyPipeline(ntDevice.device(), pipeline, nullptr);
+    vkDestroyPipelineLayout(ntDevice.device(), pipelineLayout, nullptr);
+}
+
+void NtGpuCuller::createPipeline() {
+    VkDescriptorSetLayout layout = setLayout->getDescriptorSetLayout();
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &layout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(ntDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create cull pipeline layout!");
+    }
+
+    auto code = NtPipeline::readFile("shaders/cull.comp.spv");
+
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = code.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(ntDevice.device(), &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create cull shader module!");
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pipelineLayout;
+
+    const VkResult result = vkCreateComputePipelines(ntDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+    vkDestroyShaderModule(ntDevice.device(), shaderModule, nullptr);
+
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create cull pipeline!");
+    }
+    NT_LOG_VERBOSE(LogRendering, "GPU culling pipeline created");
+}
+
+void NtGpuCuller::resetScene(uint32_t newObjectCount, uint32_t newSlotCount, uint32_t newRunCount) {
+    assert(newObjectCount <= MAX_OBJECTS && newSlotCount <= MAX_SLOTS && "GPU scene capacity exceeded");
+    assert(newRunCount <= newSlotCount && "Every run holds at least one slot");
+
+    objects.assign(newObjectCount, {});
+    objectInstances.assign(newObjectCount, {});
+    objectDirty.assign(newObjectCount, 0);
+    dirtyObjects.clear();
+    slots.assign(newSlotCount, {});
+    slotCount = newSlotCount;
+    runCount = newRunCount;
+    bSlotsDirty = true;
+    bResetLods = true;
+}
+
+void NtGpuCuller::writeObject(uint32_t index, const NtGpuObject& object, const NtInstanceData& instance) {
+    assert(index < objects.size() && "Object outside of the scene");
+
+    objects[index] = object;
+    objectInstances[index] = instance;
+    if (!objectDirty[index]) {
+        objectDirty[index] = 1;
+        dirtyObjects.push_back(index);
+    }
+}
+
+void NtGpuCuller::writeSlot(uint32_t index, const NtGpuDrawSlot& slot) {
+    assert(index < slots.size() && "Slot outside of the scene");
+
+    slots[index] = slot;
+    bSlotsDirty = true;
+}
+
+void NtGpuCuller::runStep(VkCommandBuffer commandBuffer, uint32_t step, uint32_t invocations) {
+    if (invocations == 0) return;
+
+    const PushConstants push{step};
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &push);
+    vkCmdDispatch(commandBuffer, (invocations + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+    // Each step reads what the one before it wrote
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void NtGpuCuller::dispatch(VkCommandBuffer commandBuffer, int frameIndex, const NtGpuCullView& view, uint32_t firstInstance) {
+    auto& frame = frames[frameIndex];
+    const uint32_t objectCount = static_cast<uint32_t>(objects.size());
+    if (objectCount == 0) {
+        dirtyObjects.clear();
+        bSlotsDirty = false;
+        return;
+    }
+
+    // Rows written since the last dispatch, the upload step scatters them into the tables
+    auto* objectUploads = static_cast<ObjectUpload*>(frame.objectUploads->getMappedMemory());
+    for (size_t i = 0; i < dirtyObjects.size(); ++i) {
+        const uint32_t index = dirtyObjects[i];
+        objectUploads[i] = {index, {}, objects[index], objectInstances[index]};
+        objectDirty[index] = 0;
+    }
+    const uint32_t objectUploadCount = static_cast<uint32_t>(dirtyObjects.size());
+    const uint32_t slotUploadCount = bSlotsDirty ? slotCount : 0;
+    if (slotUploadCount > 0) {
+        frame.slotUploads->writeToBuffer(slots.data(), slotUploadCount * sizeof(NtGpuDrawSlot));
+        frame.slotUploads->flush(slotUploadCount * sizeof(NtGpuDrawSlot));
+    }
+    if (objectUploadCount > 0) {
+        frame.objectUploads->flush(objectUploadCount * sizeof(ObjectUpload));
+    }
+
+    CullParams params{};
+    std::copy(std::begin(view.camera.planes), std::end(view.camera.planes), params.planes[0]);
+    std::copy(std::begin(view.light.planes), std::end(view.light.planes), params.planes[1]);
+    params.depthRow = view.depthRow;
+    std::copy(std::begin(view.lodScreenSizes), std::end(view.lodScreenSizes), &params.lodScreenSizes[0]);
+    params.projectionScale = view.projectionScale;
+    params.lodHysteresis = view.lodHysteresis;
+    params.shadowLodBias = view.shadowLodBias;
+    params.bShadowFrustum = view.bHasLight ? 1 : 0;
+    params.objectCount = objectCount;
+    params.slotCount = slotCount;
+    params.instanceCapacity = MAX_INSTANCES;
+    params.objectUploadCount = objectUploadCount;
+    params.slotUploadCount = slotUploadCount;
+    params.bResetLods = bResetLods ? 1 : 0;
+    frame.params->writeToBuffer(&params);
+    frame.params->flush();
+
+    dirtyObjects.clear();
+    bSlotsDirty = false;
+    bResetLods = false;
+
+    // The frame's counters were last read by its draws, which its fence has seen through
+    if (slotCount > 0) {
+        vkCmdFillBuffer(commandBuffer, frame.slotCounts->getBuffer(), 0, slotCount * sizeof(uint32_t), 0);
+        vkCmdFillBuffer(commandBuffer, frame.runCounts->getBuffer(), 0, runCount * sizeof(uint32_t), 0);
+    }
+    vkCmdFillBuffer(commandBuffer, frame.instanceCursor->getBuffer(), 0, sizeof(uint32_t), firstInstance);
+
+    // Also orders this frame's table writes after the previous frame's cull pass
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout,
+        0, 1, &frame.descriptorSet, 0, nullptr);
+
+    runStep(commandBuffer, STEP_UPLOAD, std::max(objectUploadCount, slotUploadCount));
+    runStep(commandBuffer, STEP_CULL, objectCount);
+    runStep(commandBuffer, STEP_ALLOCATE, slotCount);
+
+    const PushConstants push{STEP_SCATTER};
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &push);
+    vkCmdDispatch(commandBuffer, (objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+    // Draw commands and counts are read as indirect arguments, instances by the shaders
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+}
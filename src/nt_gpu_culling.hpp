@@ -0,0 +1,173 @@
+#pragma once
+
+#include "nt_buffer.hpp"
+#include "nt_descriptors.hpp"
+#include "nt_device.hpp"
+#include "nt_frustum.hpp"
+#include "nt_types.hpp"
+#include "vulkan/vulkan_core.h"
+
+#include <memory>
+#include <vector>
+
+namespace nt
+{
+
+//==============================
+// GPU CULLING
+//==============================
+// Backend of the GPU-driven draw path. The scene stays on the GPU between
+// frames as two tables: objects, one per mesh of a drawn entity with its world
+// sphere and instance data, and draw slots, one per mesh LOD and pass. Only
+// rows written since the last dispatch are uploaded.
+//
+// Each frame a compute pass in four steps
+//   0. scatters the uploaded rows into the tables,
+//   1. tests every object against the camera and shadow-light frusta, picks its
+//      LOD from its screen size and counts it into that LOD's slot,
+//   2. gives every slot with visible objects an instance range and appends its
+//      VkDrawIndexedIndirectCommand to its run, counting the run's draws,
+//   3. copies the visible objects' instance data into their slot's range.
+// A run is a stretch of slots that share pipeline, material set and geometry
+// block, drawn by one vkCmdDrawIndexedIndirectCount with a count of its own.
+
+// std430 layout, mirrored in cull.comp
+struct NtGpuObject {
+    glm::vec4 sphere;       // World-space center xyz, radius w
+    uint32_t mainSlot;      // Slot of LOD 0 in the main pass, the other LODs follow it
+    uint32_t shadowSlot;    // Same for the shadow pass, NO_SLOT for objects that cast no shadow
+    uint32_t lodCount;
+    uint32_t padding;
+};
+
+// One mesh LOD of a run, std430 layout mirrored in cull.comp
+struct NtGpuDrawSlot {
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t run;           // Draw count the slot adds to
+    uint32_t firstCommand;  // Run's first draw command, its visible slots are packed from there
+    uint32_t padding[3];
+};
+
+// What the cull pass needs to know about the frame
+struct NtGpuCullView {
+    NtFrustum camera;
+    NtFrustum light;
+    bool bHasLight;                         // Without it every shadow caster is drawn
+    glm::vec4 depthRow;                     // Row of the view-projection that gives clip-space w
+    float projectionScale;                  // |projection[1][1]|, it is negative for the Y flip
+    float lodScreenSizes[MAX_LODS - 1];     // See RenderSystem::LOD_SCREEN_SIZES
+    float lodHysteresis;
+    uint32_t shadowLodBias;
+};
+
+class NtGpuCuller
+{
+public:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+    static constexpr uint32_t MAX_OBJECTS = MAX_INSTANCES;
+    static constexpr uint32_t MAX_SLOTS = MAX_INSTANCES;
+
+    // instanceBuffers are the per-frame buffers bound as the instance buffer of the global set
+    NtGpuCuller(NtDevice& device, const std::vector<VkDescriptorBufferInfo>& instanceBuffers);
+    ~NtGpuCuller();
+
+    NtGpuCuller(const NtGpuCuller&) = delete;
+    NtGpuCuller& operator=(const NtGpuCuller&) = delete;
+
+    // Starts a new scene, every row has to be written again. Slots of one run are
+    // consecutive, runs are numbered in slot order.
+    void resetScene(uint32_t objectCount, uint32_t slotCount, uint32_t runCount);
+    void writeObject(uint32_t index, const NtGpuObject& object, const NtInstanceData& instance);
+    void writeSlot(uint32_t index, const NtGpuDrawSlot& slot);
+
+    // Rows written since the last dispatch
+    uint32_t getPendingRowCount() const { return static_cast<uint32_t>(dirtyObjects.size()) + (bSlotsDirty ? slotCount : 0); }
+
+    // Uploads the written rows and records the cull pass, then the barrier that makes its
+    // output visible to draws. Instances are written from firstInstance on, the ones before
+    // it belong to the CPU path. Must be outside of rendering, before the shadow pass.
+    void dispatch(VkCommandBuffer commandBuffer, int frameIndex, const NtGpuCullView& view, uint32_t firstInstance);
+
+    // Draw commands of a run start at its first slot, its count is at run * sizeof(uint32_t)
+    VkBuffer getCommandBuffer(int frameIndex) const { return frames[frameIndex].commands->getBuffer(); }
+    VkBuffer getCountBuffer(int frameIndex) const { return frames[frameIndex].runCounts->getBuffer(); }
+
+private:
+    // std140, mirrored in cull.comp
+    struct CullParams {
+        glm::vec4 planes[2][6];
+        glm::vec4 depthRow;
+        glm::vec4 lodScreenSizes;
+        float projectionScale;
+        float lodHysteresis;
+        uint32_t shadowLodBias;
+        uint32_t bShadowFrustum;
+        uint32_t objectCount;
+        uint32_t slotCount;
+        uint32_t instanceCapacity;
+        uint32_t objectUploadCount;
+        uint32_t slotUploadCount;
+        uint32_t bResetLods;
+        uint32_t padding[2];
+    };
+
+    // std430, mirrored in cull.comp
+    struct ObjectUpload {
+        uint32_t index;
+        uint32_t padding[3];
+        NtGpuObject object;
+        NtInstanceData instance;
+    };
+
+    // Which of the four steps a dispatch runs, as a push constant
+    struct PushConstants {
+        uint32_t step;
+    };
+
+    struct FrameResources {
+        std::unique_ptr<NtBuffer> objectUploads;
+        std::unique_ptr<NtBuffer> slotUploads;
+        std::unique_ptr<NtBuffer> params;
+        std::unique_ptr<NtBuffer> objectDraws;  // Slot and place in it for both passes, per object
+        std::unique_ptr<NtBuffer> slotCounts;
+        std::unique_ptr<NtBuffer> slotBases;    // First instance handed to each slot
+        std::unique_ptr<NtBuffer> instanceCursor;
+        std::unique_ptr<NtBuffer> commands;
+        std::unique_ptr<NtBuffer> runCounts;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    };
+
+    void createPipeline();
+    void runStep(VkCommandBuffer commandBuffer, uint32_t step, uint32_t invocations);
+
+    NtDevice& ntDevice;
+
+    std::unique_ptr<NtDescriptorSetLayout> setLayout;
+    std::unique_ptr<NtDescriptorPool> pool;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+
+    // Scene tables on the GPU, shared by all frames. Object LODs are written by the
+    // cull pass, the level each object was drawn with last.
+    std::unique_ptr<NtBuffer> objectBuffer;
+    std::unique_ptr<NtBuffer> objectInstanceBuffer;
+    std::unique_ptr<NtBuffer> slotBuffer;
+    std::unique_ptr<NtBuffer> objectLodBuffer;
+
+    // CPU copies of the tables, written rows are uploaded from here
+    std::vector<NtGpuObject> objects;
+    std::vector<NtInstanceData> objectInstances;
+    std::vector<NtGpuDrawSlot> slots;
+    std::vector<uint32_t> dirtyObjects;
+    std::vector<uint8_t> objectDirty;
+    uint32_t slotCount = 0;
+    uint32_t runCount = 0;
+    bool bSlotsDirty = false;
+    bool bResetLods = false;
+
+    std::vector<FrameResources> frames;
+};
+
+}
@@ -1,7 +1,9 @@
 #include "nt_image.hpp"
 #include "nt_log.hpp"
+#include "nt_upload_batch.hpp"
 #include <algorithm>
 #include <iostream>
+#include <optional>
 #include <stdexcept>
 #include <vulkan/vulkan_core.h>
 
@@ -13,118 +15,42 @@ namespace nt {
 NtImage::NtImage(NtDevice &device) : ntDevice{device} {}
 
 NtImage::~NtImage() {
-  if (textureSampler != VK_NULL_HANDLE)
+  if (bOwnsSampler)
     vkDestroySampler(ntDevice.device(), textureSampler, nullptr);
   if (textureImageView != VK_NULL_HANDLE)
     vkDestroyImageView(ntDevice.device(), textureImageView, nullptr);
   if (textureImage != VK_NULL_HANDLE)
     vkDestroyImage(ntDevice.device(), textureImage, nullptr);
-  if (textureImageMemory != VK_NULL_HANDLE)
-    vkFreeMemory(ntDevice.device(), textureImageMemory, nullptr);
+  ntDevice.freeMemory(textureImageMemory);
 }
 
-void NtImage::transitionImageLayout(VkImage image, VkFormat format,
-    VkImageLayout oldLayout, VkImageLayout newLayout) {
-  VkCommandBuffer commandBuffer = ntDevice.beginSingleTimeCommands();
-
-  VkImageMemoryBarrier barrier{};
-  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-  barrier.oldLayout = oldLayout;
-  barrier.newLayout = newLayout;
-  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.image = image;
-  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  barrier.subresourceRange.baseMipLevel = 0;
-  barrier.subresourceRange.levelCount = mipLevels;
-  barrier.subresourceRange.baseArrayLayer = 0;
-  barrier.subresourceRange.layerCount = 1;
-
-  VkPipelineStageFlags sourceStage;
-VkPipelineStageFlags destinationStage;
-
-if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-    barrier.srcAccessMask = 0;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-    sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-    destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-} else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-    sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-} else {
-    throw std::invalid_argument("unsupported layout transition!");
-}
-
-  vkCmdPipelineBarrier(
-    commandBuffer,
-    sourceStage, destinationStage,
-    0,
-    0, nullptr,
-    0, nullptr,
-    1, &barrier
-  );
+void NtImage::uploadPixels(const void *pixels, int32_t texWidth, int32_t texHeight, NtUploadBatch *batch) {
+  std::optional<NtUploadBatch> ownBatch;
+  if (!batch) {
+    ownBatch.emplace(ntDevice);
+    batch = &*ownBatch;
+  }
 
-  ntDevice.endSingleTimeCommands(commandBuffer);
-}
+  // Mip 0 from the staging ring, the rest blitted down from it on the graphics queue
+  batch->copyToImage(textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), mipLevels, pixels,
+      static_cast<VkDeviceSize>(texWidth) * texHeight * 4);
+  generateMipMaps(batch->getCommandBuffer(), texWidth, texHeight);
 
-void NtImage::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-  VkCommandBuffer commandBuffer = ntDevice.beginSingleTimeCommands();
-
-  VkBufferImageCopy region{};
-  region.bufferOffset = 0;
-  region.bufferRowLength = 0;
-  region.bufferImageHeight = 0;
-
-  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  region.imageSubresource.mipLevel = 0;
-  region.imageSubresource.baseArrayLayer = 0;
-  region.imageSubresource.layerCount = 1;
-
-  region.imageOffset = {0, 0, 0};
-  region.imageExtent = {
-      width,
-      height,
-      1
-  };
-
-  vkCmdCopyBufferToImage(
-    commandBuffer,
-    buffer,
-    image,
-    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-    1,
-    &region
-  );
-
-  ntDevice.endSingleTimeCommands(commandBuffer);
+  if (ownBatch) {
+    ownBatch->submit();
+    ownBatch->wait();
+  }
 }
 
-std::unique_ptr<NtImage> NtImage::createTextureFromFile(NtDevice &device, const std::string &filepath, bool isLinear) {
+std::unique_ptr<NtImage> NtImage::createTextureFromFile(NtDevice &device, const std::string &filepath, bool isLinear, NtUploadBatch *batch, VkSampler sampler) {
   int texWidth, texHeight, texChannels;
-  stbi_set_flip_vertically_on_load(false);  // Temporarily disable flipping to test UV issues
+  stbi_set_flip_vertically_on_load_thread(false);  // Temporarily disable flipping to test UV issues
   stbi_uc* pixels = stbi_load(filepath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
 
   if (!pixels) {
     throw std::runtime_error("failed to load texture image!");
   }
 
-  VkDeviceSize imageSize = texWidth * texHeight * 4;
-
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBuffMemory;
-  device.createBuffer (imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBuffMemory);
-
-  void* data;
-  vkMapMemory(device.device(), stagingBuffMemory, 0, imageSize, 0, &data);
-  memcpy(data, pixels, static_cast<size_t>(imageSize));
-  vkUnmapMemory(device.device(), stagingBuffMemory);
-
-  stbi_image_free(pixels);
-
   std::unique_ptr<NtImage> image = std::make_unique<NtImage>(device);
 
   image->mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
@@ -135,21 +61,17 @@ std::unique_ptr<NtImage> NtImage::createTextureFromFile(NtDevice &device, const
 
   image->createImage(texWidth, texHeight, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-  image->transitionImageLayout(image->textureImage, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  image->copyBufferToImage(stagingBuffer, image->textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-  // image->transitionImageLayout(image->textureImage, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-  image->generateMipMaps(texWidth, texHeight);
-
-  vkDestroyBuffer(device.device(), stagingBuffer, nullptr);
-  vkFreeMemory(device.device(), stagingBuffMemory, nullptr);
+  // Staged into the ring right away, so the pixels can go
+  image->uploadPixels(pixels, texWidth, texHeight, batch);
+  stbi_image_free(pixels);
 
   image->createTextureImageView(format);
-  image->createTextureSampler();
+  image->createTextureSampler(sampler);
 
   return image;
 }
 
-std::unique_ptr<NtImage> NtImage::createTextureFromMemory(NtDevice &device, const void *data, size_t size, bool isLinear) {
+std::unique_ptr<NtImage> NtImage::createTextureFromMemory(NtDevice &device, const void *data, size_t size, bool isLinear, NtUploadBatch *batch, VkSampler sampler) {
   int texWidth, texHeight, texChannels;
   stbi_uc* pixels = nullptr;
   bool isRawData = false;
@@ -157,7 +79,7 @@ std::unique_ptr<NtImage> NtImage::createTextureFromMemory(NtDevice &device, cons
   // NT_LOG_VERBOSE(LogAssets, "Attempting to load embedded texture from memory, size: {} bytes", size);
 
   // First, try to load as compressed image (JPEG/PNG)
-  stbi_set_flip_vertically_on_load(false);  // Temporarily disable flipping to test UV issues
+  stbi_set_flip_vertically_on_load_thread(false);  // Temporarily disable flipping to test UV issues
   pixels = stbi_load_from_memory(static_cast<const stbi_uc*>(data), static_cast<int>(size), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
 
   if (!pixels) {
@@ -195,24 +117,6 @@ std::unique_ptr<NtImage> NtImage::createTextureFromMemory(NtDevice &device, cons
       NT_LOG_VERBOSE(LogAssets, "Successfully decoded compressed texture: {} x {} channels: {}", texWidth, texHeight, texChannels);
   }
 
-  VkDeviceSize imageSize = texWidth * texHeight * 4;
-
-  // Create staging buffer to transfer pixel data to GPU
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBuffMemory;
-  device.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBuffMemory);
-
-  // Copy pixel data to staging buffer
-  void* mappedData;
-  vkMapMemory(device.device(), stagingBuffMemory, 0, imageSize, 0, &mappedData);
-  memcpy(mappedData, pixels, static_cast<size_t>(imageSize));
-  vkUnmapMemory(device.device(), stagingBuffMemory);
-
-  // Free the pixel data loaded by stb_image (only if it was allocated by stb_image)
-  if (!isRawData) {
-    stbi_image_free(pixels);
-  }
-
   std::unique_ptr<NtImage> image = std::make_unique<NtImage>(device);
 
   image->mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
@@ -222,16 +126,15 @@ std::unique_ptr<NtImage> NtImage::createTextureFromMemory(NtDevice &device, cons
 
   image->createImage(texWidth, texHeight, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-  image->transitionImageLayout(image->textureImage, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  image->copyBufferToImage(stagingBuffer, image->textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-  // image->transitionImageLayout(image->textureImage, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-  image->generateMipMaps(texWidth, texHeight);
+  image->uploadPixels(pixels, texWidth, texHeight, batch);
 
-  vkDestroyBuffer(device.device(), stagingBuffer, nullptr);
-  vkFreeMemory(device.device(), stagingBuffMemory, nullptr);
+  // Free the pixel data loaded by stb_image (only if it was allocated by stb_image)
+  if (!isRawData) {
+    stbi_image_free(pixels);
+  }
 
   image->createTextureImageView(format);
-  image->createTextureSampler();
+  image->createTextureSampler(sampler);
 
   return image;
 }
@@ -260,16 +163,9 @@ void NtImage::createImage(uint32_t width, uint32_t height, VkFormat format, VkIm
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(ntDevice.device(), textureImage, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = ntDevice.findMemoryType(memRequirements.memoryTypeBits, properties);
-
-  if (vkAllocateMemory(ntDevice.device(), &allocInfo, nullptr, &textureImageMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate image memory");
-  }
+  textureImageMemory = ntDevice.getMemoryAllocator().allocate(memRequirements, properties, true);
 
-  vkBindImageMemory(ntDevice.device(), textureImage, textureImageMemory, 0);
+  vkBindImageMemory(ntDevice.device(), textureImage, textureImageMemory.memory, textureImageMemory.offset);
 
 }
 
@@ -290,7 +186,12 @@ void NtImage::createTextureImageView(VkFormat format) {
   }
 }
 
-void NtImage::createTextureSampler() {
+void NtImage::createTextureSampler(VkSampler sharedSampler) {
+  if (sharedSampler != VK_NULL_HANDLE) {
+    textureSampler = sharedSampler;
+    return;
+  }
+
   VkSamplerCreateInfo samplerInfo{};
   samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
   // Don't forget to also set mipmapFilter mode accordingly
@@ -313,10 +214,11 @@ void NtImage::createTextureSampler() {
   if (vkCreateSampler(ntDevice.device(), &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
     throw std::runtime_error("failed to create texture sampler!");
   }
+  bOwnsSampler = true;
 
 }
 
-void NtImage::generateMipMaps(int32_t texWidth, int32_t texHeight) {
+void NtImage::generateMipMaps(VkCommandBuffer commandBuffer, int32_t texWidth, int32_t texHeight) {
     // Check if image format supports linear blitting
     VkFormatProperties formatProperties;
     vkGetPhysicalDeviceFormatProperties(ntDevice.physicalDevice(), imageFormat, &formatProperties);
@@ -324,8 +226,6 @@ void NtImage::generateMipMaps(int32_t texWidth, int32_t texHeight) {
         throw std::runtime_error("texture image format does not support linear blitting!");
     }
 
-    VkCommandBuffer commandBuffer = ntDevice.beginSingleTimeCommands();
-
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.image = textureImage;
@@ -398,8 +298,6 @@ void NtImage::generateMipMaps(int32_t texWidth, int32_t texHeight) {
         0, nullptr,
         0, nullptr,
         1, &barrier);
-
-    ntDevice.endSingleTimeCommands(commandBuffer);
 }
 
 
@@ -5,6 +5,8 @@
 
 namespace nt {
 
+class NtUploadBatch;
+
 class NtImage {
 public:
   NtImage(NtDevice &device);
@@ -13,29 +15,34 @@ public:
   NtImage(const NtImage &) = delete;
   NtImage& operator=(const NtImage &) = delete;
 
-  static std::unique_ptr<NtImage> createTextureFromFile(NtDevice &device, const std::string &filepath, bool isLinear = false);
-  static std::unique_ptr<NtImage> createTextureFromMemory(NtDevice &device, const void *data, size_t size, bool isLinear = false);
+  // Uploads are recorded into the batch when one is given, the image is usable once it completes.
+  // Without one the texture gets a batch of its own and is ready on return.
+  // A shared sampler (NtAssetCache) must outlive the image, without one the image creates its own.
+  static std::unique_ptr<NtImage> createTextureFromFile(NtDevice &device, const std::string &filepath, bool isLinear = false, NtUploadBatch *batch = nullptr,
+      VkSampler sampler = VK_NULL_HANDLE);
+  static std::unique_ptr<NtImage> createTextureFromMemory(NtDevice &device, const void *data, size_t size, bool isLinear = false, NtUploadBatch *batch = nullptr,
+      VkSampler sampler = VK_NULL_HANDLE);
 
   VkImageView getImageView() const { return textureImageView; }
   VkSampler getSampler() const { return textureSampler; }
 
 private:
-  void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-  void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+  void uploadPixels(const void *pixels, int32_t texWidth, int32_t texHeight, NtUploadBatch *batch);
   void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlagBits properties);
   void createTextureImageView(VkFormat format);
-  void createTextureSampler();
+  void createTextureSampler(VkSampler sharedSampler);
 
-  void generateMipMaps(int32_t texWidth, int32_t texHeight);
+  void generateMipMaps(VkCommandBuffer commandBuffer, int32_t texWidth, int32_t texHeight);
 
   NtDevice &ntDevice;
 
   uint32_t mipLevels;
   VkImage textureImage;
-  VkDeviceMemory textureImageMemory;
+  NtAllocation textureImageMemory{};
 
   VkImageView textureImageView;
-  VkSampler textureSampler;
+  VkSampler textureSampler = VK_NULL_HANDLE;
+  bool bOwnsSampler = false;
   VkFormat imageFormat;
 
 };
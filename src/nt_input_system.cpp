@@ -85,7 +85,7 @@ void InputSystem::updateCamControl(float dt, float mouseScrollY) {
         }
     }
 
-    auto& transform = nexus->GetComponent<cTransform>(camEntity);
+    auto const& transform = nexus->GetComponent<const cTransform>(camEntity);
     auto& camera = nexus->GetComponent<cCamera>(camEntity);
 
     if (middleMouse || alt || bRightStick)
@@ -137,7 +137,7 @@ void InputSystem::updatePlayerControl(float dt) {
     float x{0.0f};
     float y{0.0f};
 
-    auto& playerController = nexus->GetComponent<cPlayerController>(camEntity);
+    auto const& playerController = nexus->GetComponent<const cPlayerController>(camEntity);
 
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
         x = -1.0f;
@@ -158,8 +158,8 @@ void InputSystem::updatePlayerControl(float dt) {
     }
 
     // Get camera to calculate movement direction
-    auto& camera = nexus->GetComponent<cCamera>(camEntity);
-    auto& playerTransform = nexus->GetComponent<cTransform>(camEntity);
+    auto const& camera = nexus->GetComponent<const cCamera>(camEntity);
+    auto const& playerTransform = nexus->GetComponent<const cTransform>(camEntity);
 
     float yaw = camera.position.rotation.y;
 
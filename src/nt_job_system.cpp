@@ -0,0 +1,110 @@
+#include "nt_job_system.hpp"
+#include "nt_log.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace nt
+{
+
+uint32_t NtJobSystem::DefaultWorkerCount() {
+    const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+}
+
+NtJobSystem::NtJobSystem(uint32_t workerCount) {
+    assert(workerCount > 0 && "Job system needs at least one worker thread");
+
+    workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back([this] { WorkerLoop(); });
+    }
+
+    NT_LOG_INFO(LogCore, "Job system started with {} worker threads", workerCount);
+}
+
+NtJobSystem::~NtJobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        bStopping = true;
+    }
+    jobAvailable.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void NtJobSystem::Submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        jobs.push_back(std::move(job));
+    }
+    jobAvailable.notify_one();
+}
+
+bool NtJobSystem::TryRunPendingJob() {
+    std::function<void()> job;
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        if (jobs.empty()) return false;
+
+        job = std::move(jobs.front());
+        jobs.pop_front();
+    }
+
+    job();
+    return true;
+}
+
+void NtJobSystem::ParallelFor(uint32_t count, uint32_t grainSize,
+    const std::function<void(uint32_t begin, uint32_t end)>& func) {
+    if (count == 0) return;
+
+    // No more ranges than threads that can work on them
+    const uint32_t threadCount = GetWorkerCount() + 1;
+    const uint32_t rangeSize = std::max(std::max(grainSize, 1u), (count + threadCount - 1) / threadCount);
+    const uint32_t rangeCount = (count + rangeSize - 1) / rangeSize;
+
+    if (rangeCount == 1) {
+        func(0, count);
+        return;
+    }
+
+    std::atomic<uint32_t> remaining{rangeCount - 1};
+    for (uint32_t range = 1; range < rangeCount; ++range) {
+        const uint32_t begin = range * rangeSize;
+        const uint32_t end = std::min(begin + rangeSize, count);
+        Submit([&func, &remaining, begin, end] {
+            func(begin, end);
+            remaining.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    // The calling thread takes the first range, then helps until the rest are done
+    func(0, rangeSize);
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        if (!TryRunPendingJob()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void NtJobSystem::WorkerLoop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobAvailable.wait(lock, [this] { return bStopping || !jobs.empty(); });
+
+            if (bStopping && jobs.empty()) return;
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        job();
+    }
+}
+
+}
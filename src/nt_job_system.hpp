@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nt
+{
+
+//==============================
+// JOB SYSTEM
+//==============================
+// Shared pool of worker threads fed from a single FIFO queue.
+// Threads that wait on jobs (ParallelFor, the system scheduler) run queued
+// jobs themselves instead of sleeping, so nesting never deadlocks.
+class NtJobSystem
+{
+public:
+    // One worker per hardware thread, minus the main thread
+    static uint32_t DefaultWorkerCount();
+
+    explicit NtJobSystem(uint32_t workerCount = DefaultWorkerCount());
+    ~NtJobSystem();
+
+    NtJobSystem(const NtJobSystem&) = delete;
+    NtJobSystem& operator=(const NtJobSystem&) = delete;
+
+    void Submit(std::function<void()> job);
+
+    // Pops one queued job and runs it on the calling thread, false if the queue was empty
+    bool TryRunPendingJob();
+
+    // Splits [0, count) into ranges of at least grainSize and runs them across
+    // the pool and the calling thread. Returns once every range has finished.
+    void ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& func);
+
+    uint32_t GetWorkerCount() const { return static_cast<uint32_t>(workers.size()); }
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+
+    std::deque<std::function<void()>> jobs;
+    std::mutex jobMutex;
+    std::condition_variable jobAvailable;
+    bool bStopping = false;
+};
+
+}
@@ -1,17 +1,33 @@
 #include "nt_light_system.hpp"
 #include "nt_types.hpp"
 
+#include <utility>
+
 namespace nt
 {
 
-void LightSystem::updateLights(FrameInfo &frameInfo, GlobalUbo &ubo, float O_scale, float O_near, float O_far) {
+void LightSystem::updateLights(GlobalUbo &ubo, float O_scale, float O_near, float O_far) {
+  const uint32_t since = std::exchange(lastRunTick, nexus->ClaimChangeTick());
+
+  // The ubo keeps last frame's lights, only rebuild them when a light was
+  // edited, moved, added or removed, or the shadow projection changed
+  bool bDirty = entities.Size() != cachedLightCount
+      || O_scale != cachedOrthoScale || O_near != cachedOrthoNear || O_far != cachedOrthoFar;
+  if (!bDirty) {
+    nexus->View<const cTransform, const cLight>().Changed<cTransform, cLight>(since).Each(
+      [&](const cTransform&, const cLight&) { bDirty = true; });
+  }
+  if (!bDirty) return;
+
+  cachedLightCount = entities.Size();
+  cachedOrthoScale = O_scale;
+  cachedOrthoNear = O_near;
+  cachedOrthoFar = O_far;
+
   int lightIndex = 0;
-  for (auto const& entity : entities) {
+  nexus->View<const cTransform, const cLight>().Each([&](const cTransform& transform, const cLight& light) {
     assert(lightIndex < MAX_LIGHTS && "Point lights exceed maximum specified!");
 
-    auto& transform = nexus->GetComponent<cTransform>(entity);
-    auto& light = nexus->GetComponent<cLight>(entity);
-
     // copy the light to ubo
     if (light.type != eLightType::Directional)
         ubo.pointLights[lightIndex].position = glm::vec4(transform.translation, 1.f);
@@ -62,7 +78,7 @@ void LightSystem::updateLights(FrameInfo &frameInfo, GlobalUbo &ubo, float O_sca
     }
 
     lightIndex += 1;
-  }
+  });
   ubo.numLights = lightIndex;
 }
 
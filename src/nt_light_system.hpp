@@ -12,11 +12,16 @@ class LightSystem : public NtSystem
 public:
     LightSystem(NtNexus* nexus_ptr) : nexus(nexus_ptr) {};
 
-    void updateLights(FrameInfo &frameInfo, GlobalUbo &ubo,
-                    float O_scale, float O_near, float O_far);
+    void updateLights(GlobalUbo &ubo, float O_scale, float O_near, float O_far);
 
 private:
     NtNexus* nexus;
+
+    // Inputs the ubo lights were last built from
+    size_t cachedLightCount = 0;
+    float cachedOrthoScale = 0.0f;
+    float cachedOrthoNear = 0.0f;
+    float cachedOrthoFar = 0.0f;
 };
 
 }
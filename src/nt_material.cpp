@@ -1,6 +1,7 @@
 #include "nt_material.hpp"
 #include "nt_device.hpp"
 #include "nt_log.hpp"
+#include "nt_model.hpp"
 #include "nt_pipeline.hpp"
 #include "nt_types.hpp"
 #include <stdexcept>
@@ -12,9 +13,8 @@ namespace nt {
 NtMaterial::NtMaterial(NtDevice &device, const Config& config,
     VkDescriptorSetLayout globalSetLayout,
     VkDescriptorSetLayout modelSetLayout,
-    VkDescriptorSetLayout boneSetLayout,
     NtSwapChain& swapChain)
-    : device{device}, type{config.type} {
+    : device{device}, type{config.type}, bAlphaBlending{config.bAlphaBlending} {
 
     // Create pipeline layout
     VkPushConstantRange pushConstantRange{};
@@ -24,8 +24,7 @@ NtMaterial::NtMaterial(NtDevice &device, const Config& config,
 
     std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
         globalSetLayout,
-        modelSetLayout,
-        boneSetLayout
+        modelSetLayout
     };
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
@@ -41,6 +40,7 @@ NtMaterial::NtMaterial(NtDevice &device, const Config& config,
 
     // Create pipeline based on material type
     PipelineConfigInfo pipelineConfig{};
+    VkPipelineRenderingCreateInfo pipelineRenderingInfo{};
 
     // Set render mode based on material type
     RenderMode renderMode = RenderMode::PBR;
@@ -62,19 +62,11 @@ NtMaterial::NtMaterial(NtDevice &device, const Config& config,
         pipelineConfig.multisampleInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
         // Create pipeline rendering info for shadow map (depth only, no color)
-        VkPipelineRenderingCreateInfo pipelineRenderingInfo{};
         pipelineRenderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
         pipelineRenderingInfo.colorAttachmentCount = 0;
         pipelineRenderingInfo.pColorAttachmentFormats = nullptr;
         pipelineRenderingInfo.depthAttachmentFormat = pipelineConfig.depthAttachmentFormat;
         pipelineRenderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
-
-        pipeline = std::make_unique<NtPipeline>(
-            device,
-            pipelineConfig,
-            pipelineRenderingInfo,
-            config.vertexShader,
-            config.fragmentShader);
     } else {
         // Regular materials
         pipelineConfig.colorAttachmentFormat = swapChain.getSwapChainImageFormat();
@@ -98,20 +90,29 @@ NtMaterial::NtMaterial(NtDevice &device, const Config& config,
         }
 
         // Create pipeline rendering info for dynamic rendering
-        VkPipelineRenderingCreateInfo pipelineRenderingInfo{};
         pipelineRenderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
         pipelineRenderingInfo.colorAttachmentCount = 1;
         pipelineRenderingInfo.pColorAttachmentFormats = &pipelineConfig.colorAttachmentFormat;
         pipelineRenderingInfo.depthAttachmentFormat = pipelineConfig.depthAttachmentFormat;
         pipelineRenderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
-
-        pipeline = std::make_unique<NtPipeline>(
-            device,
-            pipelineConfig,
-            pipelineRenderingInfo,
-            config.vertexShader,
-            config.fragmentShader);
     }
+
+    // Static vertex layout comes with the default config
+    pipelines[static_cast<size_t>(NtVertexLayout::Static)] = std::make_unique<NtPipeline>(
+        device,
+        pipelineConfig,
+        pipelineRenderingInfo,
+        config.vertexShader,
+        config.fragmentShader);
+
+    // Skinned meshes drawn in their rest pose: same shaders, the joints past the static part go unread
+    pipelineConfig.bindingDescriptions = NtModel::SkinnedVertex::getBindingDescriptions();
+    pipelines[static_cast<size_t>(NtVertexLayout::Skinned)] = std::make_unique<NtPipeline>(
+        device,
+        pipelineConfig,
+        pipelineRenderingInfo,
+        config.vertexShader,
+        config.fragmentShader);
 }
 
 NtMaterial::~NtMaterial() {
@@ -120,19 +121,17 @@ NtMaterial::~NtMaterial() {
     }
 }
 
-void NtMaterial::bind(VkCommandBuffer commandBuffer) {
-    pipeline->bind(commandBuffer);
+void NtMaterial::bind(VkCommandBuffer commandBuffer, NtVertexLayout layout) {
+    pipelines[static_cast<size_t>(layout)]->bind(commandBuffer);
 }
 
 NtMaterialLibrary::NtMaterialLibrary(NtDevice& device,
     VkDescriptorSetLayout globalSetLayout,
     VkDescriptorSetLayout modelSetLayout,
-    VkDescriptorSetLayout boneSetLayout,
     NtSwapChain& swapChain)
     : device{device},
       globalSetLayout{globalSetLayout},
       modelSetLayout{modelSetLayout},
-      boneSetLayout{boneSetLayout},
       swapChain{swapChain} {
     createDefaultMaterials();
 }
@@ -148,7 +147,7 @@ void NtMaterialLibrary::createDefaultMaterials() {
         config.bAlphaBlending = false;
 
         materials[MaterialType::PBR] = std::make_shared<NtMaterial>(
-                   device, config, globalSetLayout, modelSetLayout, boneSetLayout, swapChain);
+                   device, config, globalSetLayout, modelSetLayout, swapChain);
     }
 
     // NPR (Toon Shading)
@@ -161,7 +160,7 @@ void NtMaterialLibrary::createDefaultMaterials() {
         config.bAlphaBlending = false;
 
         materials[MaterialType::NPR] = std::make_shared<NtMaterial>(
-                           device, config, globalSetLayout, modelSetLayout, boneSetLayout, swapChain);
+                           device, config, globalSetLayout, modelSetLayout, swapChain);
     }
 
     // UNLIT (GUI)
@@ -174,7 +173,7 @@ void NtMaterialLibrary::createDefaultMaterials() {
     //     config.bAlphaBlending = false;
 
     //     materials[MaterialType::UNLIT] = std::make_shared<NtMaterial>(
-                       // device, config, globalSetLayout, modelSetLayout, boneSetLayout, swapChain);
+                       // device, config, globalSetLayout, modelSetLayout, swapChain);
     // }
 
     // Scrolling UV
@@ -187,7 +186,7 @@ void NtMaterialLibrary::createDefaultMaterials() {
         config.bAlphaBlending = true;
 
         materials[MaterialType::SCROLLING_UV] = std::make_shared<NtMaterial>(
-                           device, config, globalSetLayout, modelSetLayout, boneSetLayout, swapChain);
+                           device, config, globalSetLayout, modelSetLayout, swapChain);
     }
 
     // Shadow Map
@@ -201,7 +200,7 @@ void NtMaterialLibrary::createDefaultMaterials() {
         config.depthWrite = true;
 
         materials[MaterialType::SHADOW_MAP] = std::make_shared<NtMaterial>(
-            device, config, globalSetLayout, modelSetLayout, boneSetLayout, swapChain);
+            device, config, globalSetLayout, modelSetLayout, swapChain);
     }
 }
 
@@ -75,21 +75,25 @@ public:
 
     NtMaterial(NtDevice& device, const Config& config, VkDescriptorSetLayout globalSetLayout,
     VkDescriptorSetLayout modelSetLayout,
-    VkDescriptorSetLayout boneSetLayout,
     NtSwapChain& swapChain);
 
     ~NtMaterial();
 
-    void bind(VkCommandBuffer commandBuffer);
+    // One pipeline per vertex layout, same layout and state otherwise
+    void bind(VkCommandBuffer commandBuffer, NtVertexLayout layout = NtVertexLayout::Static);
 
-    VkPipeline getPipeline() const { return pipeline->getPipeline(); }
+    VkPipeline getPipeline(NtVertexLayout layout = NtVertexLayout::Static) const {
+        return pipelines[static_cast<size_t>(layout)]->getPipeline();
+    }
     VkPipelineLayout getPipelineLayout() const { return pipelineLayout; }
     MaterialType getType() const { return type; }
+    bool isAlphaBlended() const { return bAlphaBlending; }
 
 private:
     NtDevice& device;
     MaterialType type;
-    std::unique_ptr<NtPipeline> pipeline;
+    bool bAlphaBlending;
+    std::unique_ptr<NtPipeline> pipelines[2];
     VkPipelineLayout pipelineLayout;
 };
 
@@ -98,7 +102,6 @@ public:
     NtMaterialLibrary(NtDevice& device,
                       VkDescriptorSetLayout globalSetLayout,
                       VkDescriptorSetLayout modelSetLayout,
-                      VkDescriptorSetLayout boneSetLayout,
                       NtSwapChain& swapChain);
 
     // Get material by type (or create one if it doesn't exit)
@@ -109,7 +112,6 @@ private:
     NtDevice& device;
     VkDescriptorSetLayout globalSetLayout;
     VkDescriptorSetLayout modelSetLayout;
-    VkDescriptorSetLayout boneSetLayout;
     NtSwapChain& swapChain;
     std::unordered_map<MaterialType, std::shared_ptr<NtMaterial>> materials;
 
@@ -0,0 +1,335 @@
+#include "nt_memory.hpp"
+#include "nt_log.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <stdexcept>
+
+namespace nt
+{
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+NtMemoryAllocator::NtMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice) : device{device} {
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+    // Blocks take at most an eighth of their heap, small heaps (BAR, integrated) would fill up otherwise
+    for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; ++type) {
+        const VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[type].heapIndex].size;
+        const VkDeviceSize blockSize = std::clamp<VkDeviceSize>(std::bit_floor(heapSize / 8), 1ull << 20, BLOCK_SIZE);
+        blockOrders[type] = static_cast<uint32_t>(std::countr_zero(blockSize));
+    }
+}
+
+NtMemoryAllocator::~NtMemoryAllocator() {
+    uint32_t leaked = 0;
+    for (auto& typePools : pools) {
+        for (auto& pool : typePools) {
+            for (auto& block : pool) {
+                if (block.memory == VK_NULL_HANDLE) continue;
+                leaked += block.allocations;
+                vkFreeMemory(device, block.memory, nullptr);
+            }
+        }
+    }
+    if (leaked > 0 || dedicatedCount > 0) {
+        NT_LOG_WARN(LogCore, "Memory allocator destroyed with {} live allocations", leaked + dedicatedCount);
+    }
+}
+
+//==============================
+// SUB-ALLOCATORS
+//==============================
+
+bool NtMemoryAllocator::buddyAllocate(Block& block, uint32_t blockOrder, uint32_t order, VkDeviceSize& outOffset) {
+    // Smallest free range that fits, split down to the requested order
+    uint32_t level = order;
+    while (level <= blockOrder && block.freeLists[level - MIN_ORDER].empty()) ++level;
+    if (level > blockOrder) return false;
+
+    auto& freeList = block.freeLists[level - MIN_ORDER];
+    const VkDeviceSize offset = *freeList.begin();
+    freeList.erase(freeList.begin());
+
+    while (level > order) {
+        --level;
+        block.freeLists[level - MIN_ORDER].insert(offset + (VkDeviceSize{1} << level));
+    }
+
+    outOffset = offset;
+    return true;
+}
+
+void NtMemoryAllocator::buddyFree(Block& block, uint32_t blockOrder, VkDeviceSize offset, uint32_t order) {
+    // Merge with the buddy for as long as it is free as well
+    while (order < blockOrder) {
+        const VkDeviceSize buddy = offset ^ (VkDeviceSize{1} << order);
+        if (block.freeLists[order - MIN_ORDER].erase(buddy) == 0) break;
+        offset = std::min(offset, buddy);
+        ++order;
+    }
+    block.freeLists[order - MIN_ORDER].insert(offset);
+}
+
+bool NtMemoryAllocator::linearAllocate(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& outOffset) {
+    const VkDeviceSize offset = alignUp(block.head, alignment);
+    if (offset + size > block.size) return false;
+
+    block.head = offset + size;
+    outOffset = offset;
+    return true;
+}
+
+//==============================
+// ALLOCATOR
+//==============================
+
+VkDeviceMemory NtMemoryAllocator::allocateMemory(VkDeviceSize size, uint32_t memoryType, void** outMapped) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        NT_LOG_ERROR(LogCore, "failed to allocate {} bytes of device memory!", size);
+        throw std::runtime_error("failed to allocate device memory!");
+    }
+
+    *outMapped = nullptr;
+    if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, outMapped) != VK_SUCCESS) {
+            vkFreeMemory(device, memory, nullptr);
+            throw std::runtime_error("failed to map device memory!");
+        }
+    }
+    return memory;
+}
+
+uint32_t NtMemoryAllocator::createBlock(uint32_t memoryType, Pool pool) {
+    auto& blocks = pools[memoryType][pool];
+
+    // Reuse the slot of a freed block, allocations refer to blocks by index
+    uint32_t index = 0;
+    while (index < blocks.size() && blocks[index].memory != VK_NULL_HANDLE) ++index;
+    if (index == blocks.size()) blocks.emplace_back();
+
+    Block& block = blocks[index];
+    block = {};
+    if (pool == POOL_STAGING) {
+        block.size = std::min(STAGING_BLOCK_SIZE, VkDeviceSize{1} << blockOrders[memoryType]);
+    } else {
+        block.size = VkDeviceSize{1} << blockOrders[memoryType];
+        block.freeLists.resize(blockOrders[memoryType] - MIN_ORDER + 1);
+        block.freeLists.back().insert(0);
+    }
+    block.memory = allocateMemory(block.size, memoryType, &block.mapped);
+
+    NT_LOG_VERBOSE(LogCore, "Memory block created: type {}, pool {}, {} MB", memoryType, static_cast<int>(pool), block.size >> 20);
+    return index;
+}
+
+NtAllocation NtMemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+    bool bImage, NtMemoryUsage usage) {
+    // Same search as NtDevice::findMemoryType
+    uint32_t memoryType = UINT32_MAX;
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+        if ((requirements.memoryTypeBits & (1u << i)) &&
+            (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            memoryType = i;
+            break;
+        }
+    }
+    if (memoryType == UINT32_MAX) {
+        NT_LOG_ERROR(LogCore, "failed to find suitable memory type!");
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
+    const bool bHostVisible = memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    const VkDeviceSize alignment = bHostVisible ? std::max(requirements.alignment, nonCoherentAtomSize) : requirements.alignment;
+
+    const Pool pool = usage == NtMemoryUsage::Staging && !bImage ? POOL_STAGING : (bImage ? POOL_IMAGE : POOL_BUFFER);
+    const VkDeviceSize blockSize = VkDeviceSize{1} << blockOrders[memoryType];
+    const VkDeviceSize poolBlockSize = pool == POOL_STAGING ? std::min(STAGING_BLOCK_SIZE, blockSize) : blockSize;
+
+    const bool bDedicated = usage == NtMemoryUsage::Dedicated ||
+                            requirements.size > poolBlockSize / 2 ||
+                            (bImage && requirements.size >= DEDICATED_IMAGE_SIZE);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    NtAllocation allocation{};
+    allocation.memoryType = memoryType;
+    allocation.size = requirements.size;
+
+    if (bDedicated) {
+        allocation.memory = allocateMemory(requirements.size, memoryType, &allocation.mapped);
+        allocation.memorySize = requirements.size;
+        allocation.bDedicated = true;
+        ++dedicatedCount;
+        dedicatedBytes += requirements.size;
+        return allocation;
+    }
+
+    auto& blocks = pools[memoryType][pool];
+    allocation.pool = pool;
+
+    if (pool == POOL_STAGING) {
+        bool bPlaced = false;
+        for (uint32_t i = 0; i < blocks.size() && !bPlaced; ++i) {
+            if (blocks[i].memory == VK_NULL_HANDLE) continue;
+            if (linearAllocate(blocks[i], requirements.size, alignment, allocation.offset)) {
+                allocation.block = i;
+                bPlaced = true;
+            }
+        }
+        if (!bPlaced) {
+            allocation.block = createBlock(memoryType, pool);
+            linearAllocate(blocks[allocation.block], requirements.size, alignment, allocation.offset);
+        }
+        blocks[allocation.block].used += requirements.size;
+    }
+    else {
+        // Buddy ranges are aligned to their own size, so rounding up covers the alignment as well
+        const VkDeviceSize rangeSize = std::bit_ceil(std::max({requirements.size, alignment, VkDeviceSize{1} << MIN_ORDER}));
+        allocation.order = static_cast<uint8_t>(std::countr_zero(rangeSize));
+
+        bool bPlaced = false;
+        for (uint32_t i = 0; i < blocks.size() && !bPlaced; ++i) {
+            if (blocks[i].memory == VK_NULL_HANDLE) continue;
+            if (buddyAllocate(blocks[i], blockOrders[memoryType], allocation.order, allocation.offset)) {
+                allocation.block = i;
+                bPlaced = true;
+            }
+        }
+        if (!bPlaced) {
+            allocation.block = createBlock(memoryType, pool);
+            buddyAllocate(blocks[allocation.block], blockOrders[memoryType], allocation.order, allocation.offset);
+        }
+        blocks[allocation.block].used += rangeSize;
+    }
+
+    Block& block = blocks[allocation.block];
+    block.requested += requirements.size;
+    ++block.allocations;
+
+    allocation.memory = block.memory;
+    allocation.memorySize = block.size;
+    allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + allocation.offset : nullptr;
+    return allocation;
+}
+
+void NtMemoryAllocator::free(NtAllocation& allocation) {
+    if (allocation.memory == VK_NULL_HANDLE) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (allocation.bDedicated) {
+        // Mapped memory is unmapped implicitly
+        vkFreeMemory(device, allocation.memory, nullptr);
+        --dedicatedCount;
+        dedicatedBytes -= allocation.size;
+        allocation = {};
+        return;
+    }
+
+    auto& blocks = pools[allocation.memoryType][allocation.pool];
+    Block& block = blocks[allocation.block];
+    assert(block.memory == allocation.memory && block.allocations > 0 && "Allocation freed twice");
+
+    if (allocation.pool == POOL_STAGING) {
+        block.used -= allocation.size;
+    } else {
+        buddyFree(block, blockOrders[allocation.memoryType], allocation.offset, allocation.order);
+        block.used -= VkDeviceSize{1} << allocation.order;
+    }
+    block.requested -= allocation.size;
+
+    // Linear blocks rewind once empty. Empty blocks are returned to the driver, except
+    // the first of each pool, which stays around for the next load.
+    if (--block.allocations == 0) {
+        block.head = 0;
+        const bool bKeep = &block == &blocks.front();
+        if (!bKeep) {
+            vkFreeMemory(device, block.memory, nullptr);
+            block = {};
+        }
+    }
+
+    allocation = {};
+}
+
+VkMappedMemoryRange NtMemoryAllocator::mappedRange(const NtAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) const {
+    const VkDeviceSize begin = allocation.offset + offset;
+    const VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : begin + size;
+
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = begin / nonCoherentAtomSize * nonCoherentAtomSize;
+
+    // Past the end of the memory object only VK_WHOLE_SIZE is valid. The size comes with the
+    // allocation: loader threads may grow the pools while frames flush, without the lock.
+    const VkDeviceSize alignedEnd = alignUp(end, nonCoherentAtomSize);
+    range.size = alignedEnd >= allocation.memorySize ? VK_WHOLE_SIZE : alignedEnd - range.offset;
+    return range;
+}
+
+VkResult NtMemoryAllocator::flush(const NtAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) {
+    const VkMappedMemoryRange range = mappedRange(allocation, size, offset);
+    return vkFlushMappedMemoryRanges(device, 1, &range);
+}
+
+VkResult NtMemoryAllocator::invalidate(const NtAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) {
+    const VkMappedMemoryRange range = mappedRange(allocation, size, offset);
+    return vkInvalidateMappedMemoryRanges(device, 1, &range);
+}
+
+NtMemoryStats NtMemoryAllocator::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    NtMemoryStats stats{};
+    stats.dedicated = dedicatedCount;
+    stats.dedicatedBytes = dedicatedBytes;
+
+    VkDeviceSize buddyFree = 0;
+    VkDeviceSize largestBuddyFree = 0;
+    for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; ++type) {
+        for (uint32_t pool = 0; pool < POOL_COUNT; ++pool) {
+            for (const auto& block : pools[type][pool]) {
+                if (block.memory == VK_NULL_HANDLE) continue;
+
+                ++stats.blocks;
+                stats.allocations += block.allocations;
+                stats.blockBytes += block.size;
+                stats.usedBytes += block.used;
+                stats.requestedBytes += block.requested;
+
+                if (pool == POOL_STAGING) continue;
+                buddyFree += block.size - block.used;
+                for (uint32_t level = static_cast<uint32_t>(block.freeLists.size()); level-- > 0;) {
+                    if (block.freeLists[level].empty()) continue;
+                    largestBuddyFree = std::max(largestBuddyFree, VkDeviceSize{1} << (level + MIN_ORDER));
+                    break;
+                }
+            }
+        }
+    }
+
+    stats.deviceAllocations = stats.blocks + stats.dedicated;
+    stats.fragmentation = buddyFree > 0 ? 1.0f - static_cast<float>(largestBuddyFree) / static_cast<float>(buddyFree) : 0.0f;
+    return stats;
+}
+
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "vulkan/vulkan_core.h"
+
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace nt
+{
+
+//==============================
+// DEVICE MEMORY
+//==============================
+// Sub-allocates VkDeviceMemory, so buffers and images no longer cost one
+// vkAllocateMemory each (drivers cap those at maxMemoryAllocationCount, often
+// 4096). Every memory type has pools of large blocks:
+//   - buddy blocks for long-lived resources, split into power-of-two ranges,
+//   - linear blocks for staging uploads, bump allocated and rewound once all of
+//     their allocations are freed.
+// Requests bigger than half a block, large images and callers that ask for it
+// get a dedicated allocation. Buffers and images never share a block, so
+// bufferImageGranularity does not apply. Host-visible memory is mapped once for
+// its lifetime; NtAllocation::mapped points at the allocation's first byte.
+
+enum class NtMemoryUsage : uint8_t {
+    Default,    // Buddy pools
+    Staging,    // Short-lived uploads, linear pools
+    Dedicated,  // Own VkDeviceMemory, for render targets and other large resources
+};
+
+struct NtAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr;     // Null unless the memory type is host-visible
+    VkDeviceSize memorySize = 0; // Of the whole VkDeviceMemory, so flushes never touch the pools
+
+    // Where it came from, for free()
+    uint32_t memoryType = 0;
+    uint32_t block = 0;
+    uint8_t pool = 0;
+    uint8_t order = 0;          // log2 of the buddy range
+    bool bDedicated = false;
+};
+
+struct NtMemoryStats {
+    uint32_t deviceAllocations = 0;     // Live vkAllocateMemory calls: blocks plus dedicated
+    uint32_t blocks = 0;
+    uint32_t dedicated = 0;
+    uint32_t allocations = 0;           // Resources placed in blocks
+    VkDeviceSize blockBytes = 0;
+    VkDeviceSize usedBytes = 0;         // Of blockBytes, buddy ranges are rounded up to powers of two
+    VkDeviceSize requestedBytes = 0;    // What the resources in blocks actually asked for
+    VkDeviceSize dedicatedBytes = 0;
+    float fragmentation = 0.0f;         // 1 - largest free buddy range / free buddy space
+};
+
+class NtMemoryAllocator
+{
+public:
+    static constexpr VkDeviceSize BLOCK_SIZE = 64ull << 20;
+    static constexpr VkDeviceSize STAGING_BLOCK_SIZE = 32ull << 20;
+    static constexpr VkDeviceSize DEDICATED_IMAGE_SIZE = 16ull << 20;
+    static constexpr uint32_t MIN_ORDER = 8;    // 256 byte buddy ranges, covers nonCoherentAtomSize
+
+    NtMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice);
+    ~NtMemoryAllocator();
+
+    NtMemoryAllocator(const NtMemoryAllocator&) = delete;
+    NtMemoryAllocator& operator=(const NtMemoryAllocator&) = delete;
+
+    // Thread-safe. Throws when the memory cannot be allocated.
+    NtAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+        bool bImage, NtMemoryUsage usage = NtMemoryUsage::Default);
+    void free(NtAllocation& allocation);
+
+    // Range relative to the allocation, widened to nonCoherentAtomSize. VK_WHOLE_SIZE
+    // covers the rest of the allocation.
+    VkResult flush(const NtAllocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+    VkResult invalidate(const NtAllocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+
+    NtMemoryStats getStats() const;
+
+private:
+    enum Pool : uint8_t {
+        POOL_BUFFER,
+        POOL_IMAGE,
+        POOL_STAGING,
+        POOL_COUNT
+    };
+
+    struct Block {
+        VkDeviceMemory memory = VK_NULL_HANDLE;     // Null once freed, the slot is reused
+        void* mapped = nullptr;
+        VkDeviceSize size = 0;
+        VkDeviceSize used = 0;
+        VkDeviceSize requested = 0;
+        uint32_t allocations = 0;
+
+        // Buddy: free range offsets per order - MIN_ORDER
+        std::vector<std::set<VkDeviceSize>> freeLists;
+        // Linear: next free byte
+        VkDeviceSize head = 0;
+    };
+
+    static bool buddyAllocate(Block& block, uint32_t blockOrder, uint32_t order, VkDeviceSize& outOffset);
+    static void buddyFree(Block& block, uint32_t blockOrder, VkDeviceSize offset, uint32_t order);
+    static bool linearAllocate(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& outOffset);
+
+    VkDeviceMemory allocateMemory(VkDeviceSize size, uint32_t memoryType, void** outMapped);
+    uint32_t createBlock(uint32_t memoryType, Pool pool);
+    VkMappedMemoryRange mappedRange(const NtAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) const;
+
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    VkDeviceSize nonCoherentAtomSize = 1;
+
+    mutable std::mutex mutex;
+    std::vector<Block> pools[VK_MAX_MEMORY_TYPES][POOL_COUNT];
+    uint32_t blockOrders[VK_MAX_MEMORY_TYPES]{};
+    uint32_t dedicatedCount = 0;
+    VkDeviceSize dedicatedBytes = 0;
+};
+
+}
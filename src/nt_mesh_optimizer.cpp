@@ -0,0 +1,446 @@
+#include "nt_mesh_optimizer.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace nt
+{
+
+namespace {
+
+glm::vec3 LoadPosition(const void* positions, size_t positionStride, uint32_t vertex) {
+    glm::vec3 position;
+    std::memcpy(&position, static_cast<const uint8_t*>(positions) + positionStride * vertex, sizeof(position));
+    return position;
+}
+
+// Sum of area-weighted squared distances to a set of planes, as a symmetric 4x4 matrix
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0;
+    double b2 = 0, bc = 0, bd = 0;
+    double c2 = 0, cd = 0;
+    double d2 = 0;
+    double area = 0;
+
+    static Quadric fromPlane(const glm::vec3& normal, float distance, float weight) {
+        const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+        return {a * a * weight, a * b * weight, a * c * weight, a * d * weight,
+                b * b * weight, b * c * weight, b * d * weight,
+                c * c * weight, c * d * weight,
+                d * d * weight, weight};
+    }
+
+    void add(const Quadric& other) {
+        a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+        b2 += other.b2; bc += other.bc; bd += other.bd;
+        c2 += other.c2; cd += other.cd;
+        d2 += other.d2;
+        area += other.area;
+    }
+
+    double evaluate(const glm::vec3& p) const {
+        const double x = p.x, y = p.y, z = p.z;
+        const double error = a2 * x * x + b2 * y * y + c2 * z * z
+            + 2 * (ab * x * y + ac * x * z + bc * y * z)
+            + 2 * (ad * x + bd * y + cd * z) + d2;
+        return std::max(error, 0.0);
+    }
+};
+
+uint64_t EdgeKey(uint32_t a, uint32_t b) {
+    return a < b ? (uint64_t{a} << 32 | b) : (uint64_t{b} << 32 | a);
+}
+
+}
+
+NtVertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+    NtVertexCacheStats stats;
+    if (indices.empty() || vertexCount == 0) return stats;
+
+    // A vertex is in the FIFO while fewer than cacheSize misses happened since it went in
+    std::vector<uint32_t> insertedAt(vertexCount, 0);
+    uint32_t misses = 0;
+    for (uint32_t index : indices) {
+        if (insertedAt[index] == 0 || misses - insertedAt[index] + 1 > cacheSize) {
+            ++misses;
+            insertedAt[index] = misses;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+    return stats;
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>* clusters,
+    uint32_t cacheSize) {
+    const size_t triangleCount = indices.size() / 3;
+    if (clusters) clusters->assign(1, 0);
+    if (triangleCount == 0 || vertexCount == 0) return;
+
+    // Triangles around each vertex, as offsets into one array
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (uint32_t index : indices) ++liveTriangles[index];
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    uint32_t timestamp = cacheSize + 1;
+    size_t scanCursor = 0;
+    int64_t fanning = indices[0];
+
+    while (fanning >= 0) {
+        // Emit every triangle left around the fanning vertex
+        candidates.clear();
+        const uint32_t vertex = static_cast<uint32_t>(fanning);
+        for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; ++a) {
+            const uint32_t triangle = adjacency[a];
+            if (emitted[triangle]) continue;
+            emitted[triangle] = true;
+
+            for (uint32_t corner = 0; corner < 3; ++corner) {
+                const uint32_t v = indices[triangle * 3 + corner];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --liveTriangles[v];
+                if (timestamp - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = timestamp++;
+                }
+            }
+        }
+
+        // Next fan: the candidate that is still cached and will stay so longest
+        fanning = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (liveTriangles[v] == 0) continue;
+            int64_t priority = 0;
+            if (timestamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+                priority = timestamp - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanning = v;
+            }
+        }
+
+        if (fanning >= 0) continue;
+
+        // Dead end: recently emitted vertices first, then whatever is left in input order
+        while (!deadEnd.empty()) {
+            const uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[v] > 0) {
+                fanning = v;
+                break;
+            }
+        }
+        while (fanning < 0 && scanCursor < vertexCount) {
+            if (liveTriangles[scanCursor] > 0) fanning = static_cast<int64_t>(scanCursor);
+            ++scanCursor;
+        }
+
+        // A jump the cache cannot follow, overdraw sorting may move what comes next
+        if (fanning >= 0 && clusters) {
+            clusters->push_back(static_cast<uint32_t>(output.size() / 3));
+        }
+    }
+
+    assert(output.size() == indices.size() && "Tipsify must emit every triangle");
+    indices.swap(output);
+}
+
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters,
+    const void* positions, size_t positionStride) {
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (clusters.size() < 2 || triangleCount == 0) return;
+
+    // Area-weighted centroid and normal of each cluster, and of the whole mesh
+    struct Cluster {
+        uint32_t begin;
+        uint32_t end;
+        float sortKey;
+    };
+    std::vector<Cluster> sorted(clusters.size());
+    std::vector<glm::vec3> centroids(clusters.size(), glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(clusters.size(), glm::vec3(0.0f));
+    glm::vec3 meshCentroid{0.0f};
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        sorted[c].begin = clusters[c];
+        sorted[c].end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        float clusterArea = 0.0f;
+        for (uint32_t triangle = sorted[c].begin; triangle < sorted[c].end; ++triangle) {
+            const glm::vec3 p0 = LoadPosition(positions, positionStride, indices[triangle * 3]);
+            const glm::vec3 p1 = LoadPosition(positions, positionStride, indices[triangle * 3 + 1]);
+            const glm::vec3 p2 = LoadPosition(positions, positionStride, indices[triangle * 3 + 2]);
+
+            const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            const float area = glm::length(normal);
+            centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+            normals[c] += normal;
+            clusterArea += area;
+        }
+
+        meshCentroid += centroids[c];
+        meshArea += clusterArea;
+        if (clusterArea > 0.0f) centroids[c] /= clusterArea;
+    }
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    // Clusters far out along their own normal occlude the rest from most directions
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        const float length = glm::length(normals[c]);
+        sorted[c].sortKey = length > 0.0f ? glm::dot(centroids[c] - meshCentroid, normals[c] / length) : 0.0f;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (const Cluster& cluster : sorted) {
+        output.insert(output.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    }
+    indices.swap(output);
+}
+
+float SimplifyMesh(std::vector<uint32_t>& destination, const std::vector<uint32_t>& indices,
+    const void* positions, size_t positionStride, size_t vertexCount, const NtSimplifyOptions& options) {
+    destination = indices;
+    if (indices.size() < 3 || vertexCount == 0) return 0.0f;
+
+    // Positions in the unit box, errors are relative to the extent from here on
+    std::vector<glm::vec3> points(vertexCount);
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        points[v] = LoadPosition(positions, positionStride, v);
+        min = glm::min(min, points[v]);
+        max = glm::max(max, points[v]);
+    }
+    const glm::vec3 size = max - min;
+    const float extent = std::max({size.x, size.y, size.z, 1e-12f});
+    for (auto& point : points) {
+        point = (point - min) / extent;
+    }
+
+    // Vertices split at a position are attribute seams; edges are counted per position so
+    // the split vertices still see one surface
+    std::vector<uint32_t> positionId(vertexCount);
+    std::vector<bool> locked(vertexCount, false);
+    {
+        struct PositionHash {
+            size_t operator()(const glm::vec3& p) const {
+                uint32_t bits[3];
+                std::memcpy(bits, &p, sizeof(bits));
+                return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+            }
+        };
+        struct PositionEqual {
+            bool operator()(const glm::vec3& a, const glm::vec3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+        };
+        std::unordered_map<glm::vec3, uint32_t, PositionHash, PositionEqual> firstAt;
+        firstAt.reserve(vertexCount);
+        std::vector<uint32_t> sharing(vertexCount, 0);
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            positionId[v] = firstAt.try_emplace(points[v], v).first->second;
+            ++sharing[positionId[v]];
+        }
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            if (sharing[positionId[v]] > 1) locked[v] = true;
+        }
+
+        // Open borders (one triangle) and non-manifold edges (more than two) stay where they are
+        std::unordered_map<uint64_t, uint32_t> edgeUses;
+        edgeUses.reserve(indices.size());
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (uint32_t e = 0; e < 3; ++e) {
+                ++edgeUses[EdgeKey(positionId[indices[i + e]], positionId[indices[i + (e + 1) % 3]])];
+            }
+        }
+        std::vector<bool> lockedPosition(vertexCount, false);
+        for (const auto& [key, uses] : edgeUses) {
+            if (uses == 2) continue;
+            lockedPosition[key >> 32] = true;
+            lockedPosition[key & 0xffffffffu] = true;
+        }
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            if (lockedPosition[positionId[v]]) locked[v] = true;
+        }
+    }
+
+    // Every vertex starts with the planes of the triangles around it
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const glm::vec3& p0 = points[indices[i]];
+        const glm::vec3 normal = glm::cross(points[indices[i + 1]] - p0, points[indices[i + 2]] - p0);
+        const float length = glm::length(normal);
+        if (length <= 0.0f) continue;
+
+        const glm::vec3 unit = normal / length;
+        const Quadric plane = Quadric::fromPlane(unit, -glm::dot(unit, p0), length * 0.5f);
+        for (uint32_t corner = 0; corner < 3; ++corner) {
+            quadrics[indices[i + corner]].add(plane);
+        }
+    }
+
+    // Mean squared distance over the area the vertex stands for, plus the attributes it would lose
+    auto collapseCost = [&](uint32_t from, uint32_t to) {
+        const Quadric& quadric = quadrics[from];
+        double cost = quadric.evaluate(points[to]) / std::max(quadric.area, 1e-12);
+        for (size_t a = 0; a < options.attributeCount; ++a) {
+            const double delta = options.attributes[from * options.attributeCount + a] - options.attributes[to * options.attributeCount + a];
+            cost += options.attributeWeights[a] * delta * delta;
+        }
+        return cost;
+    };
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+
+    const double maxCost = static_cast<double>(options.maxError) * options.maxError;
+    double reachedCost = 0.0;
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> best(vertexCount);
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> collapseTo(vertexCount);
+    std::vector<bool> touched(vertexCount);
+
+    // Passes of independent collapses, cheapest first, until the target or the error bound
+    while (destination.size() > options.targetIndexCount) {
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index : destination) ++adjacencyOffsets[index + 1];
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+        adjacency.resize(destination.size());
+        {
+            std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < destination.size(); ++i) {
+                adjacency[cursor[destination[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        for (auto& candidate : best) candidate = {UINT32_MAX, UINT32_MAX, std::numeric_limits<double>::max()};
+        for (size_t i = 0; i < destination.size(); i += 3) {
+            for (uint32_t e = 0; e < 3; ++e) {
+                const uint32_t a = destination[i + e];
+                const uint32_t b = destination[i + (e + 1) % 3];
+                if (!locked[a]) {
+                    const double cost = collapseCost(a, b);
+                    if (cost < best[a].cost) best[a] = {a, b, cost};
+                }
+                if (!locked[b]) {
+                    const double cost = collapseCost(b, a);
+                    if (cost < best[b].cost) best[b] = {b, a, cost};
+                }
+            }
+        }
+
+        collapses.clear();
+        for (const auto& candidate : best) {
+            if (candidate.from != UINT32_MAX && candidate.cost <= maxCost) collapses.push_back(candidate);
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        std::iota(collapseTo.begin(), collapseTo.end(), 0u);
+        std::fill(touched.begin(), touched.end(), false);
+        size_t removedIndices = 0;
+        const size_t wantedIndices = destination.size() - options.targetIndexCount;
+
+        for (const auto& collapse : collapses) {
+            if (removedIndices >= wantedIndices) break;
+            if (touched[collapse.from] || touched[collapse.to]) continue;
+
+            // Triangles that keep existing must not turn over
+            bool bFlips = false;
+            size_t dying = 0;
+            for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !bFlips; ++a) {
+                const uint32_t* triangle = &destination[adjacency[a] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                    ++dying;
+                    continue;
+                }
+
+                glm::vec3 corners[3];
+                for (uint32_t c = 0; c < 3; ++c) corners[c] = points[triangle[c]];
+                const glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                for (uint32_t c = 0; c < 3; ++c) {
+                    if (triangle[c] == collapse.from) corners[c] = points[collapse.to];
+                }
+                const glm::vec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                bFlips = glm::dot(before, after) <= 1e-2f * glm::length(before) * glm::length(after);
+            }
+            if (bFlips) continue;
+
+            collapseTo[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            reachedCost = std::max(reachedCost, collapse.cost);
+            removedIndices += dying * 3;
+
+            // Neighbours' triangles changed, they wait for the next pass
+            for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; ++a) {
+                for (uint32_t c = 0; c < 3; ++c) touched[destination[adjacency[a] * 3 + c]] = true;
+            }
+        }
+        if (removedIndices == 0) break;
+
+        // Remap and drop the triangles that collapsed
+        size_t write = 0;
+        for (size_t i = 0; i < destination.size(); i += 3) {
+            const uint32_t a = collapseTo[destination[i]];
+            const uint32_t b = collapseTo[destination[i + 1]];
+            const uint32_t c = collapseTo[destination[i + 2]];
+            if (a == b || b == c || a == c) continue;
+            destination[write++] = a;
+            destination[write++] = b;
+            destination[write++] = c;
+        }
+        destination.resize(write);
+    }
+
+    return static_cast<float>(std::sqrt(reachedCost));
+}
+
+std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount) {
+    std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+    uint32_t next = 0;
+    for (uint32_t& index : indices) {
+        if (remap[index] == UINT32_MAX) remap[index] = next++;
+        index = remap[index];
+    }
+    return remap;
+}
+
+}
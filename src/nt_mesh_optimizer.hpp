@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nt
+{
+
+//==============================
+// MESH OPTIMIZATION
+//==============================
+// Import-time passes over triangle lists, in the order the importer runs them:
+//   - vertex cache: Tipsify (Sander et al. 2007) reorders triangles so
+//     neighbours reuse the vertices the GPU has just shaded,
+//   - overdraw: the clusters Tipsify leaves behind are sorted so outward
+//     facing ones draw first and hide the rest, cache order inside a cluster
+//     stays as it was,
+//   - vertex fetch: vertices are renumbered in first-use order, so the vertex
+//     stream is read front to back. Unreferenced vertices are dropped.
+// Welding lives with the vertex format, in NtModel::Builder. LODs come from
+// SimplifyMesh, an edge collapser on quadric error metrics (Garland and
+// Heckbert 1997) that only moves vertices onto existing ones, so every level
+// indexes the vertices of the full mesh.
+
+// Entries of the FIFO post-transform cache the passes and statistics model
+constexpr uint32_t NT_VERTEX_CACHE_SIZE = 16;
+
+struct NtVertexCacheStats {
+    float acmr = 0.0f;  // Vertices shaded per triangle, 0.5 at best for a regular grid, 3 at worst
+    float atvr = 0.0f;  // Vertices shaded per vertex, 1 at best
+};
+
+NtVertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount,
+    uint32_t cacheSize = NT_VERTEX_CACHE_SIZE);
+
+// Reorders the triangles in place. Fills clusters, when given, with the first triangle
+// of every run that starts over from a cold cache, for OptimizeOverdraw.
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount,
+    std::vector<uint32_t>* clusters = nullptr, uint32_t cacheSize = NT_VERTEX_CACHE_SIZE);
+
+// Reorders whole clusters, positions are read as 3 floats every positionStride bytes
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters,
+    const void* positions, size_t positionStride);
+
+struct NtSimplifyOptions {
+    size_t targetIndexCount = 0;
+    float maxError = 0.05f;             // Relative to the mesh extent, collapses past it are not made
+    // Per-vertex attributes weighed against the geometric error, attributeCount floats each
+    const float* attributes = nullptr;
+    const float* attributeWeights = nullptr;
+    size_t attributeCount = 0;
+};
+
+// Collapses edges of a triangle list until targetIndexCount is reached or no collapse stays
+// within maxError. Vertices on open borders, non-manifold edges and attribute seams (vertices
+// sharing a position) do not move. Returns the largest error reached, relative to the extent.
+float SimplifyMesh(std::vector<uint32_t>& destination, const std::vector<uint32_t>& indices,
+    const void* positions, size_t positionStride, size_t vertexCount, const NtSimplifyOptions& options);
+
+// Renumbers the indices in place, returns the new index of every old vertex or UINT32_MAX
+// for unreferenced ones. The new vertex count is one past the largest index.
+std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+
+}
@@ -1,9 +1,13 @@
 #include "nt_model.hpp"
 #include "imgui.h"
+#include "nt_asset_cache.hpp"
 #include "nt_descriptors.hpp"
 #include "nt_log.hpp"
 #include "nt_material.hpp"
+#include "nt_mesh_optimizer.hpp"
+#include "nt_upload_batch.hpp"
 #include "nt_utils.hpp"
+#include <chrono>
 #include <memory>
 #include <ostream>
 #include <stdexcept>
@@ -13,23 +17,27 @@
 #include "tinygltf/tiny_gltf.h"
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/hash.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <map>
 #include <unordered_map>
 #include <algorithm>
 #include <iostream>
 #include <cctype>
+#include <cmath>
 
 namespace std {
 template<>
 struct hash<nt::NtModel::Vertex> {
   size_t operator()(nt::NtModel::Vertex const &vertex) const {
     size_t seed = 0;
-    nt::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv, vertex.tangent);
+    nt::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv, vertex.tangent,
+      vertex.boneIndices, vertex.boneWeights);
     return seed;
   }
 };
@@ -38,46 +46,163 @@ struct hash<nt::NtModel::Vertex> {
 
 namespace nt {
 
-NtModel::NtModel(NtDevice &device, NtModel::Builder &builder) : ntDevice{device},
+namespace {
+
+int16_t packSnorm16(float value) {
+  return static_cast<int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+// Unit vector folded onto the octahedron and unwrapped into [-1, 1]^2
+void packOctahedral(glm::vec3 direction, int16_t out[2]) {
+  const float length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+  if (length < 1e-8f) direction = glm::vec3(0.0f, 0.0f, 1.0f);
+  else direction /= length;
+
+  glm::vec2 folded{direction.x, direction.y};
+  if (direction.z < 0.0f) {
+    const glm::vec2 sign{direction.x >= 0.0f ? 1.0f : -1.0f, direction.y >= 0.0f ? 1.0f : -1.0f};
+    folded = (1.0f - glm::abs(glm::vec2(direction.y, direction.x))) * sign;
+  }
+  out[0] = packSnorm16(folded.x);
+  out[1] = packSnorm16(folded.y);
+}
+
+void packStaticVertex(const NtModel::Vertex &vertex, const glm::vec3 &center, float invExtent,
+    NtModel::StaticVertex &out) {
+  const glm::vec3 position = (vertex.position - center) * invExtent;
+  out.position[0] = packSnorm16(position.x);
+  out.position[1] = packSnorm16(position.y);
+  out.position[2] = packSnorm16(position.z);
+  out.position[3] = packSnorm16(vertex.tangent.w < 0.0f ? -1.0f : 1.0f);
+  packOctahedral(vertex.normal, out.normal);
+  out.uv[0] = glm::packHalf1x16(vertex.uv.x);
+  out.uv[1] = glm::packHalf1x16(vertex.uv.y);
+  packOctahedral(glm::vec3(vertex.tangent), out.tangent);
+}
+
+glm::mat4 gltfNodeMatrix(const tinygltf::Node &node) {
+  if (node.matrix.size() == 16) return glm::mat4(glm::make_mat4x4(node.matrix.data()));
+
+  glm::mat4 matrix{1.0f};
+  if (node.translation.size() == 3) matrix = glm::translate(matrix, glm::vec3(glm::make_vec3(node.translation.data())));
+  if (node.rotation.size() == 4) matrix = matrix * glm::mat4_cast(glm::quat(glm::make_quat(node.rotation.data())));
+  if (node.scale.size() == 3) matrix = glm::scale(matrix, glm::vec3(glm::make_vec3(node.scale.data())));
+  return matrix;
+}
+
+// Splits the triangles at the median of their centroids along the longest axis until
+// every cluster is small enough, then gives each cluster its own compact vertex list
+void splitStaticCluster(const NtModel::Mesh &source, const std::vector<glm::vec3> &centroids,
+    std::vector<uint32_t>::iterator begin, std::vector<uint32_t>::iterator end, std::vector<NtModel::Mesh> &out) {
+  const size_t triangleCount = static_cast<size_t>(end - begin);
+  if (triangleCount > NtModel::Builder::STATIC_CLUSTER_TRIANGLES) {
+    glm::vec3 min = centroids[*begin];
+    glm::vec3 max = min;
+    for (auto it = begin; it != end; ++it) {
+      min = glm::min(min, centroids[*it]);
+      max = glm::max(max, centroids[*it]);
+    }
+    const glm::vec3 size = max - min;
+    const int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+
+    const auto middle = begin + triangleCount / 2;
+    std::nth_element(begin, middle, end, [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+    splitStaticCluster(source, centroids, begin, middle, out);
+    splitStaticCluster(source, centroids, middle, end, out);
+    return;
+  }
+
+  NtModel::Mesh cluster;
+  cluster.name = fmt::format("{}#{}", source.name, out.size());
+  cluster.materialIndex = source.materialIndex;
+  std::unordered_map<uint32_t, uint32_t> local;
+  for (auto it = begin; it != end; ++it) {
+    for (uint32_t corner = 0; corner < 3; ++corner) {
+      const uint32_t index = source.indices[*it * 3 + corner];
+      const auto [entry, bInserted] = local.try_emplace(index, static_cast<uint32_t>(cluster.vertices.size()));
+      if (bInserted) cluster.vertices.push_back(source.vertices[index]);
+      cluster.indices.push_back(entry->second);
+    }
+  }
+  cluster.bounds = NtModel::Bounds::fromVertices(cluster.vertices);
+  out.push_back(std::move(cluster));
+}
+
+void packSkinnedVertex(const NtModel::Vertex &vertex, const glm::vec3 &center, float invExtent,
+    NtModel::SkinnedVertex &out) {
+  packStaticVertex(vertex, center, invExtent, out.base);
+
+  // Weights rounded to 1/255, the rounding error goes to the largest one so they still sum to 1
+  int largest = 0;
+  int sum = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (vertex.boneIndices[i] < 0 || vertex.boneIndices[i] > UINT16_MAX) {
+      throw std::runtime_error("Joint index " + std::to_string(vertex.boneIndices[i]) + " does not fit the skinned vertex layout");
+    }
+    out.boneIndices[i] = static_cast<uint16_t>(vertex.boneIndices[i]);
+    out.boneWeights[i] = static_cast<uint8_t>(std::round(std::clamp(vertex.boneWeights[i], 0.0f, 1.0f) * 255.0f));
+    sum += out.boneWeights[i];
+    if (vertex.boneWeights[i] > vertex.boneWeights[largest]) largest = i;
+  }
+  if (sum > 0) {
+    out.boneWeights[largest] = static_cast<uint8_t>(std::clamp(out.boneWeights[largest] + 255 - sum, 0, 255));
+  }
+}
+
+}
+
+NtModel::NtModel(NtDevice &device, NtGeometryArena &arena, NtModel::Builder &builder) : ntDevice{device},
+        geometryArena{arena},
         materialDataList{std::move(builder.l_materialData)},
         skeleton{std::move(builder.l_skeleton)},
         animations{std::move(builder.l_animations)}
 {
-  createMeshBuffers(builder.l_meshes);
+  builder.packMeshes();
+  vertexLayout = builder.l_vertexLayout;
+  positionDecode = builder.l_positionDecode;
+  createMeshBuffers(builder.l_meshes, builder.uploadBatch);
   builder.l_meshes.clear();
   builder.l_meshes.shrink_to_fit();
-
-  if (skeleton.has_value() && skeleton->bones.size() > 0) {
-      createBoneBuffer();
-  }
 }
 
 NtModel::~NtModel() {
+  for (const auto &mesh : meshes) {
+    geometryArena.release(mesh.geometry);
+  }
 }
 
-std::unique_ptr<NtModel> NtModel::createModelFromFile(NtDevice &device, const std::string &filepath, MaterialType matType,
+std::unique_ptr<NtModel> NtModel::createModelFromFile(NtDevice &device, NtGeometryArena &arena, const std::string &filepath, MaterialType matType,
     VkDescriptorSetLayout materialLayout,
     VkDescriptorPool materialPool,
-    VkDescriptorSetLayout boneLayout,
-    VkDescriptorPool bonePool) {
+    NtAssetCache *assetCache) {
+  const auto startTime = std::chrono::high_resolution_clock::now();
+
+  // Every texture and mesh of the file goes up in one submit
+  NtUploadBatch uploadBatch{device};
   Builder builder{device};
+  builder.uploadBatch = &uploadBatch;
+  builder.assetCache = assetCache;
+  builder.loadModel(filepath);
 
-  // Determine file type by extension
-  std::string extension = filepath.substr(filepath.find_last_of('.') + 1);
-  std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+  auto model = createFromBuilder(device, arena, builder, matType, materialLayout, materialPool);
 
-  if (extension == "gltf" || extension == "glb") {
-    builder.loadGltfModel(filepath);
-  } else {
-    NT_LOG_ERROR(LogAssets, "Unsupported file format: {} - Supported formats are: .gltf, .glb", extension);
-    throw std::runtime_error("Unsupported file format: " + extension + ". Supported formats are: .gltf, .glb");
-  }
+  uploadBatch.submit();
+  uploadBatch.wait();
 
-  NT_LOG_INFO(LogAssets, "Creating model from file: {}", filepath);
+  const float loadMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+  NT_LOG_INFO(LogAssets, "Loaded {} in {:.1f} ms ({} uploads, {:.1f} MB staged)", filepath, loadMs,
+      uploadBatch.getCopyCount(), uploadBatch.getStagedBytes() / (1024.0f * 1024.0f));
+
+  return model;
+}
+
+std::unique_ptr<NtModel> NtModel::createFromBuilder(NtDevice &device, NtGeometryArena &arena, Builder &builder, MaterialType matType,
+    VkDescriptorSetLayout materialLayout,
+    VkDescriptorPool materialPool) {
   NT_LOG_INFO(LogAssets, "Material data count: {}", builder.l_materialData.size());
 
   // Create the model first so we can call its member function
-  auto model = std::make_unique<NtModel>(device, builder);
+  auto model = std::make_unique<NtModel>(device, arena, builder);
   model->setMaterialType(matType);
 
   NT_LOG_INFO(LogAssets, "Model material data count after construction: {}", model->materialDataList.size());
@@ -90,191 +215,317 @@ std::unique_ptr<NtModel> NtModel::createModelFromFile(NtDevice &device, const st
       NT_LOG_WARN(LogAssets, "No material data to create descriptor sets for!");
   }
 
-  // Initialize bone descriptor sets if skeleton exists
-  if (boneLayout != VK_NULL_HANDLE && bonePool != VK_NULL_HANDLE && model->boneBuffer) {
-    model->updateBoneBuffer(boneLayout, bonePool);
-  }
-
   return model;
 }
 
-
-void NtModel::createMeshBuffers(const std::vector<Mesh> &meshData) {
+void NtModel::createMeshBuffers(const std::vector<Mesh> &meshData, NtUploadBatch *uploadBatch) {
   meshes.resize(meshData.size());
 
+  const VkDeviceSize vertexStride = vertexLayout == NtVertexLayout::Skinned ? sizeof(SkinnedVertex) : sizeof(StaticVertex);
+
   for (size_t i = 0; i < meshData.size(); ++i) {
     const auto &mesh = meshData[i];
-    createVertexBuffer(mesh.vertices, meshes[i]);
-    createIndexBuffer(mesh.indices, meshes[i]);
+    assert(mesh.vertices.size() >= 3 && "Vertex count must be at least 3");
+    assert(mesh.packedVertices.size() == mesh.vertices.size() * vertexStride && "Meshes must be packed first");
+
+    const bool bShortIndices = !mesh.packedIndices.empty();
+    meshes[i].geometry = geometryArena.allocate(
+      mesh.packedVertices.data(), static_cast<uint32_t>(mesh.vertices.size()), vertexStride,
+      bShortIndices ? static_cast<const void *>(mesh.packedIndices.data()) : mesh.indices.data(),
+      static_cast<uint32_t>(mesh.indices.size()), bShortIndices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32,
+      uploadBatch);
     meshes[i].materialIndex = mesh.materialIndex;
+    meshes[i].bounds = mesh.bounds;
+
+    // Meshes that were not optimized draw all their indices as one level
+    if (mesh.lods.empty()) {
+      meshes[i].lods[0] = {0, static_cast<uint32_t>(mesh.indices.size()), 0.0f};
+      meshes[i].lodCount = 1;
+    } else {
+      meshes[i].lodCount = static_cast<uint32_t>(std::min<size_t>(mesh.lods.size(), MAX_LODS));
+      std::copy_n(mesh.lods.begin(), meshes[i].lodCount, meshes[i].lods.begin());
+    }
   }
 }
 
-void NtModel::createVertexBuffer(const std::vector<Vertex> &vertices, MeshBuffers &meshBuffers) {
-  meshBuffers.vertexCount = static_cast<uint32_t>(vertices.size());
-  assert(meshBuffers.vertexCount >= 3 && "Vertex count must be at least 3");
-
-  // Create buffer on Device(GPU) side
-  VkDeviceSize bufferSize = sizeof(vertices[0]) * meshBuffers.vertexCount;
-  uint32_t vertexSize = sizeof(vertices[0]);
-
-  NtBuffer stagingBuffer {
-    ntDevice,
-    vertexSize,
-    meshBuffers.vertexCount,
-    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-  };
+void NtModel::bind (VkCommandBuffer commandBuffer, uint32_t meshIndex) {
+  assert(meshIndex < meshes.size() && "Mesh index out of range");
 
-  stagingBuffer.map();
-  stagingBuffer.writeToBuffer((void *)vertices.data());
+  // Binds the whole arena block, other meshes in it can draw without rebinding
+  geometryArena.bind(commandBuffer, getGeometry(meshIndex).block);
+}
 
-  meshBuffers.vertexBuffer = std::make_unique<NtBuffer>(
-    ntDevice,
-    vertexSize,
-    meshBuffers.vertexCount,
-    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-  );
+void NtModel::bindSkinned (VkCommandBuffer commandBuffer, uint32_t meshIndex, VkBuffer vertexBuffer, VkDeviceSize offset) {
+  assert(meshIndex < meshes.size() && "Mesh index out of range");
 
-  ntDevice.copyBuffer(stagingBuffer.getBuffer(), meshBuffers.vertexBuffer->getBuffer(), bufferSize);
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+  geometryArena.bindIndices(commandBuffer, getGeometry(meshIndex).block);
 }
 
-void NtModel::createIndexBuffer(const std::vector<uint32_t> &indices, MeshBuffers &meshBuffers) {
-  meshBuffers.indexCount = static_cast<uint32_t>(indices.size());
-  meshBuffers.hasIndexBuffer = meshBuffers.indexCount > 0;
-
-  if (!meshBuffers.hasIndexBuffer)
-    return;
+void NtModel::draw (VkCommandBuffer commandBuffer, uint32_t meshIndex, uint32_t instanceCount, uint32_t firstInstance,
+    uint32_t lod, bool bSkinned) {
+  assert(meshIndex < meshes.size() && "Mesh index out of range");
+  assert(lod < meshes[meshIndex].lodCount && "LOD out of range");
+
+  const auto &geometry = getGeometry(meshIndex);
+  const uint32_t vertexOffset = bSkinned ? 0 : geometry.vertexOffset;
+  if (geometry.indexCount > 0) {
+    const Lod &range = meshes[meshIndex].lods[lod];
+    vkCmdDrawIndexed(commandBuffer, range.indexCount, instanceCount, geometry.firstIndex + range.firstIndex,
+      static_cast<int32_t>(vertexOffset), firstInstance);
+  } else {
+    vkCmdDraw(commandBuffer, geometry.vertexCount, instanceCount, vertexOffset, firstInstance);
+  }
+}
 
-  VkDeviceSize bufferSize = sizeof(indices[0]) * meshBuffers.indexCount;
-  uint32_t indexSize = sizeof(indices[0]);
+void NtModel::drawAll (VkCommandBuffer commandBuffer) {
+  for (uint32_t i = 0; i < meshes.size(); ++i) {
+    bind(commandBuffer, i);
+    draw(commandBuffer, i);
+  }
+}
 
-  NtBuffer stagingBuffer {
-    ntDevice,
-    indexSize,
-    meshBuffers.indexCount,
-    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-  };
+NtModel::Bounds NtModel::Bounds::fromVertices(const std::vector<Vertex> &vertices) {
+  Bounds bounds;
+  if (vertices.empty()) return bounds;
 
-  stagingBuffer.map();
-  stagingBuffer.writeToBuffer((void *)indices.data());
+  bounds.min = bounds.max = vertices[0].position;
+  for (const auto &vertex : vertices) {
+    bounds.min = glm::min(bounds.min, vertex.position);
+    bounds.max = glm::max(bounds.max, vertex.position);
+  }
 
-  meshBuffers.indexBuffer = std::make_unique<NtBuffer>(
-    ntDevice,
-    indexSize,
-    meshBuffers.indexCount,
-    VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  bounds.center = (bounds.min + bounds.max) * 0.5f;
+  float radiusSquared = 0.0f;
+  for (const auto &vertex : vertices) {
+    const glm::vec3 offset = vertex.position - bounds.center;
+    radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+  }
+  bounds.radius = std::sqrt(radiusSquared);
 
-  ntDevice.copyBuffer(stagingBuffer.getBuffer(), meshBuffers.indexBuffer->getBuffer(), bufferSize);
+  return bounds;
 }
 
-void NtModel::createBoneBuffer() {
-    size_t boneCount = getBonesCount();
+static_assert(sizeof(NtModel::StaticVertex) == 20, "StaticVertex must stay tightly packed");
+static_assert(sizeof(NtModel::SkinnedVertex) == 32, "SkinnedVertex must stay tightly packed");
 
-    // Buffer for bone matrices
-    boneBuffer = std::make_unique<NtBuffer>(
-        ntDevice,
-        sizeof(glm::mat4),
-        boneCount,
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-    );
-    boneBuffer->map();
+std::vector<VkVertexInputBindingDescription> NtModel::StaticVertex::getBindingDescriptions() {
+  std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
 
-    // Initialize with identity matrices
-    std::vector<glm::mat4> identityMatrices(boneCount, glm::mat4(1.0f));
+  bindingDescriptions[0].binding = 0;
+  bindingDescriptions[0].stride = sizeof(StaticVertex);
+  bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-    boneBuffer->writeToBuffer(identityMatrices.data());
-    boneBuffer->flush();
+  return bindingDescriptions;
 }
 
-void NtModel::updateBoneBuffer(VkDescriptorSetLayout boneLayout, VkDescriptorPool bonePool) {
-    if (!boneBuffer) {
-        NT_LOG_ERROR(LogAssets, "Cannot update bone buffer: buffer doesn't exist!");
-        return;
-    }
-
-    auto bufferInfo = boneBuffer->descriptorInfo();
-
-    // Use raw pool allocate method, not NtDescriptorWriter
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = bonePool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &boneLayout;
-
-    if (vkAllocateDescriptorSets(ntDevice.device(), &allocInfo, &boneDescriptorSet) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate bone descriptor set!");
-    }
+// Locations stay where the float layout had them, location 1 (vertex color) is gone
+std::vector<VkVertexInputAttributeDescription> NtModel::StaticVertex::getAttributeDescriptions() {
+  std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
 
-    VkWriteDescriptorSet descriptorWrite{};
-    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet = boneDescriptorSet;
-    descriptorWrite.dstBinding = 0;
-    descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    descriptorWrite.descriptorCount = 1;
-    descriptorWrite.pBufferInfo = &bufferInfo;
+  attributeDescriptions.push_back({0, 0, VK_FORMAT_R16G16B16A16_SNORM, offsetof(StaticVertex, position)});
+  attributeDescriptions.push_back({2, 0, VK_FORMAT_R16G16_SNORM, offsetof(StaticVertex, normal)});
+  attributeDescriptions.push_back({3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(StaticVertex, uv)});
+  attributeDescriptions.push_back({4, 0, VK_FORMAT_R16G16_SNORM, offsetof(StaticVertex, tangent)});
 
-    vkUpdateDescriptorSets(ntDevice.device(), 1, &descriptorWrite, 0, nullptr);
+  return attributeDescriptions;
 }
 
-void NtModel::bind (VkCommandBuffer commandBuffer, uint32_t meshIndex) {
-  assert(meshIndex < meshes.size() && "Mesh index out of range");
+std::vector<VkVertexInputBindingDescription> NtModel::SkinnedVertex::getBindingDescriptions() {
+  std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
 
-  const auto &mesh = meshes[meshIndex];
-  VkBuffer buffers[] = {mesh.vertexBuffer->getBuffer()};
-  VkDeviceSize offsets[] = {0};
-  vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+  bindingDescriptions[0].binding = 0;
+  bindingDescriptions[0].stride = sizeof(SkinnedVertex);
+  bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-  if (mesh.hasIndexBuffer) {
-    vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
-  }
+  return bindingDescriptions;
 }
 
-void NtModel::draw (VkCommandBuffer commandBuffer, uint32_t meshIndex) {
-  assert(meshIndex < meshes.size() && "Mesh index out of range");
+void NtModel::Builder::loadModel(const std::string &filepath) {
+  // Determine file type by extension
+  std::string extension = filepath.substr(filepath.find_last_of('.') + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
 
-  const auto &mesh = meshes[meshIndex];
-  if (mesh.hasIndexBuffer) {
-    vkCmdDrawIndexed(commandBuffer, mesh.indexCount, 1, 0, 0, 0);
+  if (extension == "gltf" || extension == "glb") {
+    loadGltfModel(filepath);
   } else {
-    vkCmdDraw(commandBuffer, mesh.vertexCount, 1, 0, 0);
+    NT_LOG_ERROR(LogAssets, "Unsupported file format: {} - Supported formats are: .gltf, .glb", extension);
+    throw std::runtime_error("Unsupported file format: " + extension + ". Supported formats are: .gltf, .glb");
   }
-}
 
-void NtModel::drawAll (VkCommandBuffer commandBuffer) {
-  for (uint32_t i = 0; i < meshes.size(); ++i) {
-    bind(commandBuffer, i);
-    draw(commandBuffer, i);
-  }
+  NT_LOG_INFO(LogAssets, "Creating model from file: {}", filepath);
+  optimizeMeshes();
+  packMeshes();
 }
 
-std::vector<VkVertexInputBindingDescription> NtModel::Vertex::getBindingDescriptions() {
-  std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+void NtModel::Builder::optimizeMeshes() {
+  size_t triangles = 0;
+  size_t verticesBefore = 0;
+  size_t verticesAfter = 0;
+  float missesBefore = 0.0f;
+  float missesAfter = 0.0f;
+  size_t lodCount = 0;
+  size_t lodTriangles = 0;
+
+  for (auto &mesh : l_meshes) {
+    if (mesh.indices.empty() || mesh.indices.size() % 3 != 0) continue;
+    const NtVertexCacheStats before = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+    const size_t vertexCount = mesh.vertices.size();
+
+    // Weld: exporters split vertices per face or per primitive, identical ones become one
+    std::unordered_map<Vertex, uint32_t> unique;
+    unique.reserve(mesh.vertices.size());
+    std::vector<Vertex> welded;
+    std::vector<uint32_t> weldRemap(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+      const auto [it, bInserted] = unique.try_emplace(mesh.vertices[i], static_cast<uint32_t>(welded.size()));
+      if (bInserted) welded.push_back(mesh.vertices[i]);
+      weldRemap[i] = it->second;
+    }
+    for (uint32_t &index : mesh.indices) {
+      index = weldRemap[index];
+    }
 
-  bindingDescriptions[0].binding = 0;
-  bindingDescriptions[0].stride = sizeof(Vertex);
-  bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    // Each level simplifies the one before it, onto the vertices of the full mesh
+    std::vector<std::vector<uint32_t>> levels{std::move(mesh.indices)};
+    std::vector<float> levelErrors{0.0f};
+    if (bGenerateLods && levels[0].size() / 3 >= LOD_MIN_TRIANGLES) {
+      // Normals and UVs weigh in, so shading seams and texture stretch hold the collapses back
+      constexpr size_t attributeCount = 5;
+      constexpr float attributeWeights[attributeCount] = {0.002f, 0.002f, 0.002f, 0.01f, 0.01f};
+      std::vector<float> attributes(welded.size() * attributeCount);
+      for (size_t i = 0; i < welded.size(); ++i) {
+        float *attribute = &attributes[i * attributeCount];
+        attribute[0] = welded[i].normal.x;
+        attribute[1] = welded[i].normal.y;
+        attribute[2] = welded[i].normal.z;
+        attribute[3] = welded[i].uv.x;
+        attribute[4] = welded[i].uv.y;
+      }
 
-  return bindingDescriptions;
+      while (levels.size() < MAX_LODS) {
+        NtSimplifyOptions options;
+        options.targetIndexCount = levels.back().size() / 6 * 3;
+        options.maxError = 0.01f * static_cast<float>(1u << levels.size());
+        options.attributes = attributes.data();
+        options.attributeWeights = attributeWeights;
+        options.attributeCount = attributeCount;
+
+        std::vector<uint32_t> simplified;
+        const float error = SimplifyMesh(simplified, levels.back(), &welded[0].position, sizeof(Vertex), welded.size(), options);
+        // Not worth a level when it barely got smaller, locked borders and seams stop it early
+        if (simplified.empty() || simplified.size() * 5 > levels.back().size() * 4) break;
+
+        levels.push_back(std::move(simplified));
+        levelErrors.push_back(std::max(error, levelErrors.back()));
+      }
+    }
+
+    std::vector<uint32_t> clusters;
+    mesh.lods.clear();
+    mesh.indices.clear();
+    for (size_t level = 0; level < levels.size(); ++level) {
+      // Overdraw order only pays off up close, coarser levels keep the cache order
+      const bool bOverdraw = bOptimizeOverdraw && level == 0;
+      OptimizeVertexCache(levels[level], welded.size(), bOverdraw ? &clusters : nullptr);
+      if (bOverdraw) {
+        OptimizeOverdraw(levels[level], clusters, &welded[0].position, sizeof(Vertex));
+      }
+
+      mesh.lods.push_back({static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(levels[level].size()),
+        levelErrors[level]});
+      mesh.indices.insert(mesh.indices.end(), levels[level].begin(), levels[level].end());
+    }
+
+    // Vertices in first-use order, unreferenced ones dropped. Coarser levels only use vertices
+    // of the full mesh, so its order is the one that counts.
+    const std::vector<uint32_t> fetchRemap = OptimizeVertexFetch(mesh.indices, welded.size());
+    mesh.vertices.assign(welded.size() - std::count(fetchRemap.begin(), fetchRemap.end(), UINT32_MAX), Vertex{});
+    for (size_t i = 0; i < welded.size(); ++i) {
+      if (fetchRemap[i] != UINT32_MAX) mesh.vertices[fetchRemap[i]] = welded[i];
+    }
+    mesh.bounds = Bounds::fromVertices(mesh.vertices);
+
+    const std::vector<uint32_t> fullMesh(mesh.indices.begin(), mesh.indices.begin() + mesh.lods[0].indexCount);
+    const NtVertexCacheStats after = AnalyzeVertexCache(fullMesh, mesh.vertices.size());
+    NT_LOG_VERBOSE(LogAssets, "Optimized mesh {}: {} -> {} vertices, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+      mesh.name, vertexCount, mesh.vertices.size(), before.acmr, after.acmr, before.atvr, after.atvr);
+    for (size_t level = 1; level < mesh.lods.size(); ++level) {
+      NT_LOG_VERBOSE(LogAssets, "  LOD{}: {} triangles, error {:.4f}", level, mesh.lods[level].indexCount / 3,
+        mesh.lods[level].error);
+    }
+
+    const size_t meshTriangles = fullMesh.size() / 3;
+    lodCount += mesh.lods.size() - 1;
+    lodTriangles += (mesh.indices.size() - fullMesh.size()) / 3;
+    triangles += meshTriangles;
+    verticesBefore += vertexCount;
+    verticesAfter += mesh.vertices.size();
+    missesBefore += before.acmr * meshTriangles;
+    missesAfter += after.acmr * meshTriangles;
+  }
+
+  if (triangles == 0) return;
+  NT_LOG_INFO(LogAssets, "Optimized {} triangles: {} -> {} vertices, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+    triangles, verticesBefore, verticesAfter, missesBefore / triangles, missesAfter / triangles,
+    missesBefore / verticesBefore, missesAfter / verticesAfter);
+  if (lodCount > 0) {
+    NT_LOG_INFO(LogAssets, "Generated {} LODs over {} meshes, {} triangles ({:.0f}% of the full meshes)", lodCount,
+      l_meshes.size(), lodTriangles, 100.0f * lodTriangles / triangles);
+  }
 }
 
-std::vector<VkVertexInputAttributeDescription> NtModel::Vertex::getAttributeDescriptions() {
-  std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+void NtModel::Builder::packMeshes() {
+  if (bPacked) return;
+  bPacked = true;
+
+  l_vertexLayout = l_skeleton && !l_skeleton->bones.empty() ? NtVertexLayout::Skinned : NtVertexLayout::Static;
+  const size_t stride = l_vertexLayout == NtVertexLayout::Skinned ? sizeof(SkinnedVertex) : sizeof(StaticVertex);
+
+  // One decode for the whole model, so a single matrix serves every mesh and joint. The
+  // scale is uniform: skin matrices with the decode folded in still carry normals.
+  glm::vec3 min{0.0f};
+  glm::vec3 max{0.0f};
+  bool bFirst = true;
+  for (const auto &mesh : l_meshes) {
+    for (const auto &vertex : mesh.vertices) {
+      min = bFirst ? vertex.position : glm::min(min, vertex.position);
+      max = bFirst ? vertex.position : glm::max(max, vertex.position);
+      bFirst = false;
+    }
+  }
+  const glm::vec3 center = (min + max) * 0.5f;
+  const float extent = std::max({(max - min).x, (max - min).y, (max - min).z, 1e-6f}) * 0.5f;
+  l_positionDecode = glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(extent));
+
+  size_t vertexCount = 0;
+  size_t shortIndexCount = 0;
+  for (auto &mesh : l_meshes) {
+    // 16-bit indices whenever the mesh allows, indices are relative to the mesh's first vertex
+    if (mesh.vertices.size() <= 65536) {
+      mesh.packedIndices.assign(mesh.indices.begin(), mesh.indices.end());
+      shortIndexCount += mesh.indices.size();
+    }
 
-  attributeDescriptions.push_back({0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position)});
-  attributeDescriptions.push_back({1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color)});
-  attributeDescriptions.push_back({2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal)});
-  attributeDescriptions.push_back({3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv)});
-  attributeDescriptions.push_back({4, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(Vertex, tangent)});
-  attributeDescriptions.push_back({5, 0, VK_FORMAT_R32G32B32A32_SINT, offsetof(Vertex, boneIndices)});
-  attributeDescriptions.push_back({6, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(Vertex, boneWeights)});
+    mesh.packedVertices.resize(mesh.vertices.size() * stride);
+    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+      if (l_vertexLayout == NtVertexLayout::Skinned) {
+        packSkinnedVertex(mesh.vertices[i], center, 1.0f / extent,
+          reinterpret_cast<SkinnedVertex *>(mesh.packedVertices.data())[i]);
+      } else {
+        packStaticVertex(mesh.vertices[i], center, 1.0f / extent,
+          reinterpret_cast<StaticVertex *>(mesh.packedVertices.data())[i]);
+      }
+    }
+    vertexCount += mesh.vertices.size();
+  }
 
-  return attributeDescriptions;
+  // What the float layout would have cost in memory and in vertex fetch per draw
+  const float unpackedKb = vertexCount * sizeof(Vertex) / 1024.0f;
+  const float packedKb = vertexCount * stride / 1024.0f;
+  NT_LOG_INFO(LogAssets, "Packed {} vertices as {}: {:.1f} KB -> {:.1f} KB ({:.0f}% less), {} indices as 16-bit", vertexCount,
+    l_vertexLayout == NtVertexLayout::Skinned ? "skinned" : "static", unpackedKb, packedKb,
+    unpackedKb > 0.0f ? 100.0f * (1.0f - packedKb / unpackedKb) : 0.0f, shortIndexCount);
 }
 
 void NtModel::Builder::loadGltfModel(const std::string &filepath) {
@@ -324,6 +575,91 @@ void NtModel::Builder::loadGltfModel(const std::string &filepath) {
   for (const auto& anim : model.animations) {
       loadGltfAnimation(model, anim);
   }
+
+  if (bStaticBatching) {
+      batchStaticMeshes(model);
+  }
+}
+
+void NtModel::Builder::batchStaticMeshes(const tinygltf::Model &model) {
+  // Skinned meshes follow their joints, not their nodes
+  if (!model.skins.empty() || model.scenes.empty()) return;
+
+  // loadGltfMeshes pushed one mesh per primitive, in order
+  std::vector<size_t> firstPrimitive(model.meshes.size() + 1, 0);
+  for (size_t i = 0; i < model.meshes.size(); ++i) {
+    firstPrimitive[i + 1] = firstPrimitive[i] + model.meshes[i].primitives.size();
+  }
+  if (firstPrimitive.back() != l_meshes.size()) return;
+
+  // Every primitive a node of the scene draws, in model space, merged per material
+  std::map<uint32_t, Mesh> merged;
+  size_t primitiveCount = 0;
+
+  std::vector<std::pair<int, glm::mat4>> stack;
+  const int sceneIndex = model.defaultScene >= 0 ? model.defaultScene : 0;
+  for (int root : model.scenes[sceneIndex].nodes) {
+    stack.emplace_back(root, glm::mat4(1.0f));
+  }
+
+  while (!stack.empty()) {
+    const auto [nodeIndex, parent] = stack.back();
+    stack.pop_back();
+    const tinygltf::Node &node = model.nodes[nodeIndex];
+    const glm::mat4 world = parent * gltfNodeMatrix(node);
+    for (int child : node.children) {
+      stack.emplace_back(child, world);
+    }
+    if (node.mesh < 0) continue;
+
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(world)));
+    const bool bMirrored = glm::determinant(glm::mat3(world)) < 0.0f;
+
+    for (size_t p = firstPrimitive[node.mesh]; p < firstPrimitive[node.mesh + 1]; ++p) {
+      const Mesh &primitive = l_meshes[p];
+      Mesh &target = merged[primitive.materialIndex];
+      if (target.vertices.empty()) {
+        target.materialIndex = primitive.materialIndex;
+        target.name = primitive.materialIndex < l_materialData.size() ? l_materialData[primitive.materialIndex].name : primitive.name;
+      }
+
+      const uint32_t base = static_cast<uint32_t>(target.vertices.size());
+      for (Vertex vertex : primitive.vertices) {
+        vertex.position = glm::vec3(world * glm::vec4(vertex.position, 1.0f));
+        vertex.normal = glm::normalize(normalMatrix * vertex.normal);
+        vertex.tangent = glm::vec4(glm::normalize(glm::mat3(world) * glm::vec3(vertex.tangent)),
+          bMirrored ? -vertex.tangent.w : vertex.tangent.w);
+        target.vertices.push_back(vertex);
+      }
+
+      // Mirroring flips the winding, swap two corners to keep the front faces
+      for (size_t i = 0; i + 2 < primitive.indices.size(); i += 3) {
+        target.indices.push_back(base + primitive.indices[i]);
+        target.indices.push_back(base + primitive.indices[bMirrored ? i + 2 : i + 1]);
+        target.indices.push_back(base + primitive.indices[bMirrored ? i + 1 : i + 2]);
+      }
+      ++primitiveCount;
+    }
+  }
+
+  std::vector<Mesh> clusters;
+  for (auto &[materialIndex, mesh] : merged) {
+    const size_t triangleCount = mesh.indices.size() / 3;
+    if (triangleCount == 0) continue;
+
+    std::vector<glm::vec3> centroids(triangleCount);
+    std::vector<uint32_t> triangles(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+      centroids[t] = (mesh.vertices[mesh.indices[t * 3]].position + mesh.vertices[mesh.indices[t * 3 + 1]].position +
+                      mesh.vertices[mesh.indices[t * 3 + 2]].position) / 3.0f;
+      triangles[t] = static_cast<uint32_t>(t);
+    }
+    splitStaticCluster(mesh, centroids, triangles.begin(), triangles.end(), clusters);
+  }
+
+  NT_LOG_INFO(LogAssets, "Static batching: {} primitives in {} materials -> {} clusters",
+    primitiveCount, merged.size(), clusters.size());
+  l_meshes = std::move(clusters);
 }
 
 void NtModel::Builder::loadGltfMaterials(const tinygltf::Model &model, const std::string &filepath) {
@@ -353,8 +689,7 @@ void NtModel::Builder::loadGltfMaterials(const tinygltf::Model &model, const std
         std::string texturePath = baseDir + image.uri;
         NT_LOG_VERBOSE(LogAssets, "Loading base color texture: {}", texturePath);
         try {
-          materialData.pbrMetallicRoughness.baseColorTexture =
-            NtImage::createTextureFromFile(ntDevice, texturePath);
+          materialData.pbrMetallicRoughness.baseColorTexture = loadTexture(texturePath, false);
           materialData.pbrMetallicRoughness.baseColorTexCoord = pbr.baseColorTexture.texCoord;
         } catch (const std::exception& e) {
             NT_LOG_ERROR(LogAssets, "Failed to load base color texture: {}", e.what());
@@ -362,8 +697,7 @@ void NtModel::Builder::loadGltfMaterials(const tinygltf::Model &model, const std
       } else if (!image.image.empty()) {
           // Embedded texture - so let's create texture from memory
           try {
-            materialData.pbrMetallicRoughness.baseColorTexture =
-              NtImage::createTextureFromMemory(ntDevice, image.image.data(), image.image.size());
+            materialData.pbrMetallicRoughness.baseColorTexture = loadTexture(image.image.data(), image.image.size(), false);
             materialData.pbrMetallicRoughness.baseColorTexCoord = pbr.baseColorTexture.texCoord;
           } catch (const std::exception& e) {
               NT_LOG_ERROR(LogAssets, "Failed to load base embedded color texture: {}", e.what());
@@ -411,16 +745,14 @@ void NtModel::Builder::loadGltfMaterials(const tinygltf::Model &model, const std
         std::string texturePath = baseDir + image.uri;
         NT_LOG_VERBOSE(LogAssets, "Loading metallic-roughness texture: {}", texturePath);
         try {
-          materialData.pbrMetallicRoughness.metallicRoughnessTexture =
-            NtImage::createTextureFromFile(ntDevice, texturePath, true);
+          materialData.pbrMetallicRoughness.metallicRoughnessTexture = loadTexture(texturePath, true);
           materialData.pbrMetallicRoughness.metallicRoughnessTexCoord = pbr.metallicRoughnessTexture.texCoord;
         } catch (const std::exception& e) {
             NT_LOG_ERROR(LogAssets, "Failed to load metallic-roughness texture: {}", e.what());
         }
       } else if (!image.image.empty()) {
         // Embedded texture - so let's create texture from memory
-        materialData.pbrMetallicRoughness.metallicRoughnessTexture =
-            NtImage::createTextureFromMemory(ntDevice, image.image.data(), image.image.size(), true);
+        materialData.pbrMetallicRoughness.metallicRoughnessTexture = loadTexture(image.image.data(), image.image.size(), true);
         materialData.pbrMetallicRoughness.metallicRoughnessTexCoord = pbr.metallicRoughnessTexture.texCoord;
         }
     }
@@ -434,7 +766,7 @@ void NtModel::Builder::loadGltfMaterials(const tinygltf::Model &model, const std
         std::string texturePath = baseDir + image.uri;
         NT_LOG_VERBOSE(LogAssets, "Loading normal texture: {}", texturePath);
         try {
-          materialData.normalTexture = NtImage::createTextureFromFile(ntDevice, texturePath, true);
+          materialData.normalTexture = loadTexture(texturePath, true);
           materialData.normalScale = material.normalTexture.scale;
           materialData.normalTexCoord = material.normalTexture.texCoord;
         } catch (const std::exception& e) {
@@ -442,8 +774,7 @@ void NtModel::Builder::loadGltfMaterials(const tinygltf::Model &model, const std
         }
       } else if (!image.image.empty()) {
         // Embedded texture - so let's create texture from memory
-        materialData.normalTexture =
-            NtImage::createTextureFromMemory(ntDevice, image.image.data(), image.image.size(), true);
+        materialData.normalTexture = loadTexture(image.image.data(), image.image.size(), true);
         materialData.normalScale = material.normalTexture.scale;
         materialData.normalTexCoord = material.normalTexture.texCoord;
     }
@@ -572,6 +903,20 @@ void NtModel::createMaterialDescriptorSets(VkDescriptorSetLayout layout, VkDescr
     NT_LOG_INFO(LogAssets, "Successfully created descriptor sets for all materials");
 }
 
+std::shared_ptr<NtImage> NtModel::Builder::loadTexture(const std::string &filepath, bool isLinear) {
+  if (assetCache) {
+    return assetCache->loadTexture(filepath, isLinear, uploadBatch);
+  }
+  return NtImage::createTextureFromFile(ntDevice, filepath, isLinear, uploadBatch);
+}
+
+std::shared_ptr<NtImage> NtModel::Builder::loadTexture(const void *data, size_t size, bool isLinear) {
+  if (assetCache) {
+    return assetCache->loadTexture(data, size, isLinear, uploadBatch);
+  }
+  return NtImage::createTextureFromMemory(ntDevice, data, size, isLinear, uploadBatch);
+}
+
 void NtModel::Builder::loadGltfMeshes(const tinygltf::Model &model) {
   for (const auto &gltfMesh : model.meshes) {
     for (const auto &primitive : gltfMesh.primitives) {
@@ -710,6 +1055,12 @@ void NtModel::Builder::loadGltfMeshes(const tinygltf::Model &model) {
             mesh.indices[i] = static_cast<uint32_t>(indexData[i]);
           }
         }
+      } else {
+        // Non-indexed primitives get a trivial index list, so every mesh can be drawn indexed (and indirect)
+        mesh.indices.resize(mesh.vertices.size());
+        for (size_t i = 0; i < mesh.indices.size(); ++i) {
+          mesh.indices[i] = static_cast<uint32_t>(i);
+        }
       }
 
       // Calculate tangents if not provided by the model
@@ -717,6 +1068,7 @@ void NtModel::Builder::loadGltfMeshes(const tinygltf::Model &model) {
         calculateTangents(mesh.vertices, mesh.indices);
     }
 
+      mesh.bounds = Bounds::fromVertices(mesh.vertices);
       l_meshes.push_back(mesh);
     }
   }
@@ -773,14 +1125,14 @@ void NtModel::Builder::loadGltfSkeleton(const tinygltf::Model &model) {
                 auto& gltfNode = model.nodes[globalGltfNodeIndex];
 
                 if (gltfNode.translation.size() == 3) {
-                    bone.animatedNodeTranslation = glm::make_vec3(gltfNode.translation.data());
+                    bone.restTranslation = glm::make_vec3(gltfNode.translation.data());
                 }
                 if (gltfNode.rotation.size() == 4) {
                     glm::quat q = glm::make_quat(gltfNode.rotation.data());
-                    bone.animatedNodeRotation = q;
+                    bone.restRotation = q;
                 }
                 if (gltfNode.scale.size() == 3) {
-                    bone.animatedNodeScale = glm::make_vec3(gltfNode.scale.data());
+                    bone.restScale = glm::make_vec3(gltfNode.scale.data());
                 }
                 if (gltfNode.matrix.size() == 16) {
                     bone.initialNodeMatrix = glm::make_mat4x4(gltfNode.matrix.data());
@@ -798,9 +1150,6 @@ void NtModel::Builder::loadGltfSkeleton(const tinygltf::Model &model) {
         }
      }
 
-    // Initialize the shader data vector
-    l_skeleton->m_ShaderData.m_FinalJointsMatrices.resize(l_skeleton->bones.size(), glm::mat4(1.0f));
-
     NT_LOG_VERBOSE(LogAssets, "Bones: {}", l_skeleton->bones.size());
 }
 
@@ -937,83 +1286,6 @@ void NtModel::Skeleton::Traverse(Bone const& bone, uint32_t indent)
     }
 }
 
-void NtModel::Skeleton::Update()
-{
-    // update the final global transform of all joints
-    int16_t numberOfBones = static_cast<int16_t>(bones.size());
-
-    if (!isAnimated) // used for debugging to check if the model renders w/o deformation
-    {
-        for (int16_t boneIndex = 0; boneIndex < numberOfBones; ++boneIndex)
-        {
-            m_ShaderData.m_FinalJointsMatrices[boneIndex] = glm::mat4(1.0f);
-        }
-    }
-    else
-    {
-        // STEP 1: apply animation results
-        for (int16_t boneIndex = 0; boneIndex < numberOfBones; ++boneIndex)
-        {
-            m_ShaderData.m_FinalJointsMatrices[boneIndex] = bones[boneIndex].getAnimatedBindMatrix();
-        }
-
-        // STEP 2: recursively update final joint matrices
-        UpdateBone(0);
-
-        // STEP 3: bring back into model space
-        for (int16_t boneIndex = 0; boneIndex < numberOfBones; ++boneIndex)
-        {
-            m_ShaderData.m_FinalJointsMatrices[boneIndex] =
-                m_ShaderData.m_FinalJointsMatrices[boneIndex] * bones[boneIndex].inverseBindMatrix;
-        }
-    }
-}
-
-// Update the final joint matrices of all joints
-// traverses entire skeleton from top (a.k.a root a.k.a hip bone)
-// This way, it is guaranteed that the global parent transform is already updated
-void NtModel::Skeleton::UpdateBone(int16_t boneIndex)
-{
-    auto& currentBone = bones[boneIndex]; // just a reference for easier code
-
-    int16_t parentBone = currentBone.parentIndex;
-    if (parentBone != -1)
-    {
-        m_ShaderData.m_FinalJointsMatrices[boneIndex] =
-             m_ShaderData.m_FinalJointsMatrices[parentBone] * m_ShaderData.m_FinalJointsMatrices[boneIndex];
-    }
-
-    // update children
-    size_t numberOfChildren = currentBone.childrenIndices.size();
-    for (size_t childIndex = 0; childIndex < numberOfChildren; ++childIndex)
-    {
-        int childJoint = currentBone.childrenIndices[childIndex];
-        UpdateBone(childJoint);
-    }
-}
-
-void NtModel::updateSkeleton() {
-    if (!skeleton.has_value()) {
-        NT_LOG_WARN(LogAssets, "No skeleton");
-        return;
-    }
-
-    if (!boneBuffer) {
-        NT_LOG_WARN(LogAssets, "No bone buffer");
-        return;
-    }
-
-    skeleton->Update();
-
-    if (skeleton->m_ShaderData.m_FinalJointsMatrices.empty()) {
-        NT_LOG_WARN(LogAssets, "m_FinalJointsMatrices is empty!");
-        return;
-    }
-
-    boneBuffer->writeToBuffer((void*)skeleton->m_ShaderData.m_FinalJointsMatrices.data());
-    boneBuffer->flush();
-}
-
 uint32_t NtModel::getMaterialIndex(uint32_t meshIndex) const {
   if (meshIndex >= meshes.size()) {
     return 0; // Default to first material if mesh index is out of range
@@ -1099,11 +1371,15 @@ void NtModel::Builder::calculateTangents(std::vector<Vertex>& vertices, const st
 }
 
 // Helper functions
-std::unique_ptr<NtModel> NtModel::createPlane(NtDevice &device, float size, const std::string &texturePath,
+std::unique_ptr<NtModel> NtModel::createPlane(NtDevice &device, NtGeometryArena &arena, float size, const std::string &texturePath,
             MaterialType matType,
             VkDescriptorSetLayout materialLayout,
-            VkDescriptorPool materialPool) {
+            VkDescriptorPool materialPool,
+            NtAssetCache *assetCache) {
+  NtUploadBatch uploadBatch{device};
   NtModel::Builder modelData{device};
+  modelData.uploadBatch = &uploadBatch;
+  modelData.assetCache = assetCache;
   modelData.l_meshes.resize(1);
 
   // Quad vertices (using a plane in the XZ plane)
@@ -1115,17 +1391,20 @@ std::unique_ptr<NtModel> NtModel::createPlane(NtDevice &device, float size, cons
   };
 
   modelData.l_meshes[0].indices = {0, 1, 2, 2, 3, 0};
+  modelData.l_meshes[0].bounds = Bounds::fromVertices(modelData.l_meshes[0].vertices);
 
   // modelData.l_materialData.resize(1);
   MaterialData materialData;
   materialData.name = "BillboardMaterial";
   materialData.pbrMetallicRoughness.baseColorFactor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
-  materialData.pbrMetallicRoughness.baseColorTexture = NtImage::createTextureFromFile(device, texturePath);;
+  materialData.pbrMetallicRoughness.baseColorTexture = modelData.loadTexture(texturePath, false);
   modelData.l_materialData.push_back(materialData);
   // modelData.l_materialData[0] = std::make_shared<NtMaterial>(device, materialData);
 
-  auto model = std::make_unique<NtModel>(device, modelData);
+  auto model = std::make_unique<NtModel>(device, arena, modelData);
   model->setMaterialType(matType);
+  uploadBatch.submit();
+  uploadBatch.wait();
   model->createMaterialDescriptorSets(materialLayout, materialPool);
 
   return model;
@@ -3,10 +3,13 @@
 #include "nt_animation.hpp"
 #include "nt_device.hpp"
 #include "nt_buffer.hpp"
+#include "nt_geometry_arena.hpp"
 #include "nt_material.hpp"
+#include "nt_types.hpp"
 
 #include "vulkan/vulkan_core.h"
 #include <algorithm>
+#include <array>
 #include <optional>
 #include <string>
 #include <vector>
@@ -32,9 +35,13 @@ namespace tinygltf {
 
 namespace nt {
 
+class NtAssetCache;
+
 class NtModel {
     public:
 
+        // Full-precision vertex the importer works with, packed into StaticVertex or
+        // SkinnedVertex before it goes to the GPU
         struct Vertex {
           glm::vec3 position{};
           glm::vec3 color{};
@@ -42,28 +49,65 @@ class NtModel {
           glm::vec2 uv{};
           glm::vec4 tangent{};  // w component stores handedness
 
-          glm::ivec4 boneIndices; // Up to 4 bones per vertex
-          glm::vec4 boneWeights; // Must sum to 1.0
-
-          static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
-          static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+          glm::ivec4 boneIndices{0}; // Up to 4 bones per vertex
+          glm::vec4 boneWeights{0.0f}; // Must sum to 1.0
 
           bool operator==(const Vertex &other) const {
             return position == other.position && color == other.color && normal == other.normal &&
-                   uv == other.uv && tangent == other.tangent;
+                   uv == other.uv && tangent == other.tangent &&
+                   boneIndices == other.boneIndices && boneWeights == other.boneWeights;
           }
         };
 
+        // GPU vertex of meshes without a skeleton, 20 bytes. Positions are snorm16 in the
+        // model's bounds, decoded by getPositionDecode(); w holds the tangent handedness.
+        // Normal and tangent are octahedral snorm16, UVs half floats.
+        struct StaticVertex {
+          int16_t position[4];
+          int16_t normal[2];
+          uint16_t uv[2];
+          int16_t tangent[2];
+
+          static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+          static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+        };
+
+        // StaticVertex plus 4 u16 joint indices and unorm8 weights summing to 255, 32 bytes.
+        // Joints are only read by the skinning pass, vertex shaders see the StaticVertex part.
+        struct SkinnedVertex {
+          StaticVertex base;
+          uint16_t boneIndices[4];
+          uint8_t boneWeights[4];
+
+          static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+        };
+
+        // Object-space bounds of a mesh in its bind pose
+        struct Bounds {
+          glm::vec3 min{0.0f};
+          glm::vec3 max{0.0f};
+          glm::vec3 center{0.0f};  // Sphere around the box center, tight to the vertices
+          float radius{0.0f};
+
+          static Bounds fromVertices(const std::vector<Vertex> &vertices);
+        };
+
+        // Triangles of one detail level, all levels index the same vertices
+        struct Lod {
+          uint32_t firstIndex{0};   // Relative to the mesh's first index
+          uint32_t indexCount{0};
+          float error{0.0f};        // Simplification error relative to the mesh extent
+        };
+
         struct Mesh {
           std::vector<Vertex> vertices{};
           std::vector<uint32_t> indices{};
           uint32_t materialIndex{0};
           std::string name{};
-        };
-
-        struct ShaderData
-        {
-            std::vector<glm::mat4> m_FinalJointsMatrices;
+          Bounds bounds{};
+          std::vector<uint8_t> packedVertices{};  // StaticVertex or SkinnedVertex, filled by Builder::packMeshes
+          std::vector<uint16_t> packedIndices{};  // Filled by Builder::packMeshes when every index fits 16 bits
+          std::vector<Lod> lods{};                // Ranges of indices, finest first; empty draws all indices
         };
 
         struct Bone {
@@ -74,49 +118,72 @@ class NtModel {
             glm::mat4 initialNodeMatrix{1.0f}; // Transform for world coordinate system
             glm::mat4 inverseBindMatrix; // Bones coordinate system
 
-            // ANIMATED
-            glm::vec3 animatedNodeTranslation{0.0f};                            // T
-            glm::quat animatedNodeRotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f); // R
-            glm::vec3 animatedNodeScale{1.0f};                                  // S
-
-            glm::mat4 getAnimatedBindMatrix() const {
-                return glm::translate(glm::mat4(1.0f), animatedNodeTranslation) * // T
-                       glm::mat4(animatedNodeRotation) *                          // R
-                       glm::scale(glm::mat4(1.0f), animatedNodeScale) *           // S
-                       initialNodeMatrix;
-            }
+            // REST POSE, where every NtSkeletonPose starts from
+            glm::vec3 restTranslation{0.0f};                            // T
+            glm::quat restRotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f); // R
+            glm::vec3 restScale{1.0f};                                  // S
 
             // TREE HIERARCHY
             int parentIndex; // -1 for root
             std::vector<int> childrenIndices;
         };
 
+        // Bind pose and hierarchy only, shared by every entity drawing the model.
+        // Animated state lives in each entity's NtSkeletonPose.
         struct Skeleton {
             bool isRoot = false;
             bool isAnimated = true;
             std::string name;
             std::vector<Bone> bones;
             std::unordered_map<int, int> nodeIndexToBoneIndex; // Map node index -> bone index
-            ShaderData m_ShaderData;
 
             void Traverse();
             void Traverse(Bone const& bone, uint32_t indent = 0);
-            void Update();
-            void UpdateBone(int16_t boneIndex);
         };
 
         struct Builder {
+          // Largest cluster static batching leaves, small enough to cull well and for 16-bit indices
+          static constexpr size_t STATIC_CLUSTER_TRIANGLES = 4096;
+          // Meshes below this get no LODs, they cost less to draw than to switch
+          static constexpr size_t LOD_MIN_TRIANGLES = 256;
+
           // CPU-side attributes, only needed for loading
           std::vector<Mesh> l_meshes{};
           std::vector<MaterialData> l_materialData{};
           std::optional<Skeleton> l_skeleton{};
           std::vector<NtAnimation> l_animations{};
+          // Layout and position decode of the packed meshes, set by packMeshes
+          NtVertexLayout l_vertexLayout{NtVertexLayout::Static};
+          glm::mat4 l_positionDecode{1.0f};
+          // Textures and meshes record their uploads here, uploaded on their own when null
+          NtUploadBatch *uploadBatch = nullptr;
+          // Textures are shared through the cache when one is given
+          NtAssetCache *assetCache = nullptr;
+          // Sorts triangle clusters against overdraw after the vertex cache pass, costs a little cache reuse
+          bool bOptimizeOverdraw = true;
+          // Models without skins are drawn as their scene: node transforms are baked in and the
+          // primitives of each material merged, then split into spatial clusters with their own bounds
+          bool bStaticBatching = true;
+          // Up to MAX_LODS - 1 simplified levels per mesh, each about half the triangles of the last
+          bool bGenerateLods = true;
 
           explicit Builder(NtDevice &device) : ntDevice{device} {}
 
           ~Builder() {}
 
+          // Parses the file by extension, throws when it cannot. Runs on any thread, GPU work
+          // is recorded into uploadBatch.
+          void loadModel(const std::string &filepath);
           void loadGltfModel(const std::string &filepath);
+          // Through assetCache when there is one, recorded into uploadBatch either way
+          std::shared_ptr<NtImage> loadTexture(const std::string &filepath, bool isLinear);
+          std::shared_ptr<NtImage> loadTexture(const void *data, size_t size, bool isLinear);
+          // Welds duplicate vertices, builds the LODs and reorders triangles and vertices for the
+          // GPU caches, see nt_mesh_optimizer.hpp. loadModel runs it before packing.
+          void optimizeMeshes();
+          // Quantizes every mesh into its GPU layout, once the meshes and skeleton are final.
+          // loadModel calls it, so streamed models pack on the loader thread.
+          void packMeshes();
 
         private:
           void loadGltfMaterials(const tinygltf::Model &model, const std::string &filepath);
@@ -124,28 +191,47 @@ class NtModel {
           void loadGltfSkeleton(const tinygltf::Model &model);
           void loadGltfBone(const tinygltf::Model &model, int globalGltfNodeIndex, int parentBone);
           void loadGltfAnimation(const tinygltf::Model &model, const tinygltf::Animation& anim);
+          void batchStaticMeshes(const tinygltf::Model &model);
 
          void calculateTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
 
+          bool bPacked = false;
+
           // Reference to device for material creation
           NtDevice &ntDevice;
         };
 
-        NtModel(NtDevice &device, NtModel::Builder &builder);
+        NtModel(NtDevice &device, NtGeometryArena &arena, NtModel::Builder &builder);
         ~NtModel();
 
         NtModel(const NtModel &) = delete;
         NtModel& operator=(const NtModel &) = delete;
 
-        static std::unique_ptr<NtModel> createModelFromFile(NtDevice &device, const std::string &filepath, MaterialType matType,
+        static std::unique_ptr<NtModel> createModelFromFile(NtDevice &device, NtGeometryArena &arena, const std::string &filepath, MaterialType matType,
             VkDescriptorSetLayout materialLayout,
             VkDescriptorPool materialPool,
-            VkDescriptorSetLayout boneLayout = VK_NULL_HANDLE,
-            VkDescriptorPool bonePool = VK_NULL_HANDLE);
+            NtAssetCache *assetCache = nullptr);
+        // The second half of createModelFromFile, for builders loaded elsewhere. Mesh uploads go into
+        // builder.uploadBatch, the model is drawable once the caller's batch completes.
+        static std::unique_ptr<NtModel> createFromBuilder(NtDevice &device, NtGeometryArena &arena, Builder &builder, MaterialType matType,
+            VkDescriptorSetLayout materialLayout,
+            VkDescriptorPool materialPool);
         uint32_t getMeshCount() const { return static_cast<uint32_t>(meshes.size()); }
         uint32_t getMaterialIndex(uint32_t meshIndex) const;
+        const Bounds& getMeshBounds(uint32_t meshIndex) const { return meshes[meshIndex].bounds; }
+        uint32_t getIndexCount(uint32_t meshIndex) const { return getGeometry(meshIndex).indexCount; }
+        uint32_t getLodCount(uint32_t meshIndex) const { return meshes[meshIndex].lodCount; }
+        const Lod& getLod(uint32_t meshIndex, uint32_t lod) const { return meshes[meshIndex].lods[lod]; }
+        const NtGeometryRange& getGeometry(uint32_t meshIndex) const { return geometryArena.getRange(meshes[meshIndex].geometry); }
         const std::optional<Skeleton>& getSkeleton() const { return skeleton; }
         uint32_t getBonesCount() const { return skeleton.has_value() ? static_cast<uint32_t>(skeleton->bones.size()) : 0; }
+        NtVertexLayout getVertexLayout() const { return vertexLayout; }
+        // Quantized positions to object space, folded into the model and joint matrices
+        const glm::mat4& getPositionDecode() const { return positionDecode; }
+        // Skinned vertices leave the bind-pose bounds, the skinning pass quantizes them into a
+        // box SKINNED_POSITION_RANGE times as large
+        static constexpr float SKINNED_POSITION_RANGE = 4.0f;
+        glm::mat4 getSkinnedPositionDecode() const { return glm::scale(positionDecode, glm::vec3(SKINNED_POSITION_RANGE)); }
         const std::vector<NtAnimation>& getAnimations() const { return animations; }
 
         MaterialType getMaterialType() const { return materialType; }
@@ -156,43 +242,40 @@ class NtModel {
         const MaterialData& getMaterialData(uint32_t meshIndex) const;
         const std::vector<MaterialData>& getMaterialDataList() const { return materialDataList; }
 
-        const VkDescriptorSet& getBoneDescriptorSet() const { return boneDescriptorSet; }
-        bool hasBoneDescriptor() const { return boneDescriptorSet != VK_NULL_HANDLE; }
-
         void bind (VkCommandBuffer commandBuffer, uint32_t meshIndex = 0);
-        void draw (VkCommandBuffer commandBuffer, uint32_t meshIndex = 0);
+        // Binds vertices the skinning pass wrote for the mesh, with the mesh's own indices
+        void bindSkinned (VkCommandBuffer commandBuffer, uint32_t meshIndex, VkBuffer vertexBuffer, VkDeviceSize offset);
+        // bSkinned draws what bindSkinned bound, the vertices start at its offset
+        void draw (VkCommandBuffer commandBuffer, uint32_t meshIndex = 0, uint32_t instanceCount = 1, uint32_t firstInstance = 0,
+            uint32_t lod = 0, bool bSkinned = false);
         void drawAll (VkCommandBuffer commandBuffer);
-        void updateSkeleton();
 
         bool hasSkeleton() const { return skeleton.has_value(); }
 
-        static std::unique_ptr<NtModel> createPlane(NtDevice &device, float size, const std::string &texturePath,
+        static std::unique_ptr<NtModel> createPlane(NtDevice &device, NtGeometryArena &arena, float size, const std::string &texturePath,
             MaterialType matType,
             VkDescriptorSetLayout materialLayout,
-            VkDescriptorPool materialPool);
+            VkDescriptorPool materialPool,
+            NtAssetCache *assetCache = nullptr);
     private:
+        // Vertices and indices live in the geometry arena, shared with other meshes
         struct MeshBuffers {
-          std::unique_ptr<NtBuffer> vertexBuffer;
-          std::unique_ptr<NtBuffer> indexBuffer;
-          uint32_t vertexCount;
-          uint32_t indexCount;
-          bool hasIndexBuffer = false;
+          NtGeometryHandle geometry = NT_INVALID_GEOMETRY;
           uint32_t materialIndex = 0;
+          Bounds bounds{};
+          std::array<Lod, MAX_LODS> lods{};
+          uint32_t lodCount = 1;
         };
 
-        void createMeshBuffers(const std::vector<Mesh> &meshes);
-        void createVertexBuffer(const std::vector<Vertex> &vertices, MeshBuffers &meshBuffers);
-        void createIndexBuffer(const std::vector<uint32_t> &indices, MeshBuffers &meshBuffers);
-        void createBoneBuffer();
-        void updateBoneBuffer(VkDescriptorSetLayout boneLayout, VkDescriptorPool bonePool);
-
-        std::unique_ptr<NtBuffer> boneBuffer;
-        VkDescriptorSet boneDescriptorSet = VK_NULL_HANDLE;
+        void createMeshBuffers(const std::vector<Mesh> &meshes, NtUploadBatch *uploadBatch);
 
         NtDevice &ntDevice;
+        NtGeometryArena &geometryArena;
         std::vector<MeshBuffers> meshes;
         std::optional<Skeleton> skeleton;
         std::vector<NtAnimation> animations;
+        NtVertexLayout vertexLayout = NtVertexLayout::Static;
+        glm::mat4 positionDecode{1.0f};
 
         std::vector<MaterialData> materialDataList;
         std::vector<VkDescriptorSet> materialDescriptorSets;
@@ -235,7 +235,7 @@ void NtPhysicsSystem::createCharacterController(NtEntity entity)
     }
 
     auto& charPhys = nexus->GetComponent<cCharacterPhysics>(entity);
-    auto& transform = nexus->GetComponent<cTransform>(entity);
+    auto const& transform = nexus->GetComponent<const cTransform>(entity);
 
     // Create capsule shape.
     // capsuleHalfHeight = half of total capsule height (feet to top).
@@ -353,14 +353,10 @@ void NtPhysicsSystem::createStaticBoxCollider(NtEntity entity, const glm::vec3&
 void NtPhysicsSystem::update(float deltaTime)
 {
     // Update all character controllers
-    for (auto entity : entities)
+    nexus->View<cCharacterPhysics, cTransform>().Each([&](cCharacterPhysics& charPhys, cTransform& transform)
     {
-        if (!nexus->HasComponent<cCharacterPhysics>(entity))
-            continue;
-
-        auto& charPhys = nexus->GetComponent<cCharacterPhysics>(entity);
         if (!charPhys.character)
-            continue;
+            return;
 
         CharacterVirtual* character = charPhys.character;
 
@@ -436,18 +432,15 @@ void NtPhysicsSystem::update(float deltaTime)
         );
 
         // Sync physics position back to transform
-        syncPhysicsToTransform(entity);
+        syncPhysicsToTransform(charPhys, transform);
 
         // Clear desired velocity for next frame
         charPhys.desiredVelocity = glm::vec3(0.0f);
-    }
+    });
 }
 
-void NtPhysicsSystem::syncPhysicsToTransform(NtEntity entity)
+void NtPhysicsSystem::syncPhysicsToTransform(const cCharacterPhysics& charPhys, cTransform& transform)
 {
-    auto& charPhys = nexus->GetComponent<cCharacterPhysics>(entity);
-    auto& transform = nexus->GetComponent<cTransform>(entity);
-
     RVec3 pos = charPhys.character->GetPosition();
     transform.translation = glm::vec3(
         static_cast<float>(pos.GetX()),
@@ -480,7 +473,7 @@ bool NtPhysicsSystem::isCharacterGrounded(NtEntity entity) const
 {
     if (nexus->HasComponent<cCharacterPhysics>(entity))
     {
-        return nexus->GetComponent<cCharacterPhysics>(entity).isGrounded;
+        return nexus->GetComponent<const cCharacterPhysics>(entity).isGrounded;
     }
     return false;
 }
@@ -501,14 +494,10 @@ void NtPhysicsSystem::drawDebugColliders()
 
     // Draw character capsules (green)
     Im3d::PushColor(Im3d::Color_Green);
-    for (NtEntity entity : entities)
+    nexus->View<const cCharacterPhysics>().Each([](const cCharacterPhysics& charPhys)
     {
-        if (!nexus->HasComponent<cCharacterPhysics>(entity))
-            continue;
-
-        auto& charPhys = nexus->GetComponent<cCharacterPhysics>(entity);
         if (!charPhys.character)
-            continue;
+            return;
 
         RVec3 pos = charPhys.character->GetPosition();
         float radius = charPhys.capsuleRadius;
@@ -529,7 +518,7 @@ void NtPhysicsSystem::drawDebugColliders()
         );
 
         Im3d::DrawCapsule(bottom, top, radius);
-    }
+    });
     Im3d::PopColor();
 
     // Draw static box colliders (cyan)
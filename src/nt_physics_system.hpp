@@ -88,7 +88,7 @@ private:
     bool bDebugDraw = false;
 
     // Internal helpers
-    void syncPhysicsToTransform(NtEntity entity);
+    void syncPhysicsToTransform(const cCharacterPhysics& charPhys, cTransform& transform);
 };
 
 } // namespace nt
@@ -79,8 +79,8 @@ NtPipeline::~NtPipeline() {
    shaderStages[1].pNext = nullptr;
    shaderStages[1].pSpecializationInfo = nullptr;
 
-   auto bindingDescriptions = NtModel::Vertex::getBindingDescriptions();
-   auto attributeDescriptions = NtModel::Vertex::getAttributeDescriptions();
+   auto& bindingDescriptions = configInfo.bindingDescriptions;
+   auto& attributeDescriptions = configInfo.attributeDescriptions;
    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
@@ -242,6 +242,9 @@ NtPipeline::~NtPipeline() {
    configInfo.dynamicStateInfo.pDynamicStates = configInfo.dynamicStateEnables.data();
    configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
    configInfo.dynamicStateInfo.flags = 0;
+
+   configInfo.bindingDescriptions = NtModel::StaticVertex::getBindingDescriptions();
+   configInfo.attributeDescriptions = NtModel::StaticVertex::getAttributeDescriptions();
  }
 
 }
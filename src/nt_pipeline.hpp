@@ -25,6 +25,9 @@ namespace nt {
     VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
     std::vector<VkDynamicState> dynamicStateEnables;
     VkPipelineDynamicStateCreateInfo dynamicStateInfo;
+    // Vertex layout, NtModel::StaticVertex unless set otherwise
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
     VkPipelineLayout pipelineLayout = nullptr;
     // Dynamic rendering
     VkFormat colorAttachmentFormat = VK_FORMAT_UNDEFINED;
@@ -48,10 +51,9 @@ namespace nt {
       VkPipeline getPipeline() { return graphicsPipeline; }
 
       static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo, RenderMode pipeRenderMode, NtDevice& device);
-
-    private:
       static vector<char> readFile(const string& filepath);
 
+    private:
       void createGraphicalPipeline(
           const PipelineConfigInfo& configInfo,
           const VkPipelineRenderingCreateInfo& pipelineRenderingInfo,
@@ -0,0 +1,132 @@
+#include "nt_render_queue.hpp"
+#include "nt_model.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+namespace nt
+{
+
+namespace {
+
+constexpr uint32_t RADIX_BITS = 8;
+constexpr uint32_t RADIX_BUCKETS = 1u << RADIX_BITS;
+constexpr uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+
+uint64_t Field(uint32_t value, uint32_t bits) {
+    return static_cast<uint64_t>(value) & ((uint64_t{1} << bits) - 1);
+}
+
+// Non-negative floats order the same as their bit patterns, so the top bits
+// below the sign are a coarse, monotonic depth
+uint32_t QuantizeDepth(float depth, uint32_t bits) {
+    if (!(depth > 0.0f)) return 0;
+    return std::bit_cast<uint32_t>(depth) >> (31 - bits);
+}
+
+}
+
+NtVertexLayout GetDrawLayout(const NtDrawItem& item) {
+    return item.skinnedPose ? NtVertexLayout::Static : item.model->getVertexLayout();
+}
+
+void NtRenderQueue::clear() {
+    items.clear();
+    entries.clear();
+}
+
+void NtRenderQueue::push(NtRenderPass pass, const NtDrawItem& item, float depth) {
+    const uint64_t passBits = static_cast<uint64_t>(pass) << PASS_SHIFT;
+    const uint64_t pipeline = Field(static_cast<uint32_t>(item.materialType) << 1 |
+        static_cast<uint32_t>(GetDrawLayout(item)), 6);
+    const uint64_t set = Field(materialSetId(item.materialSet), MATERIAL_SET_BITS);
+    const uint64_t mesh = Field(meshId(item.model, item.meshIndex, item.lod), MESH_BITS);
+    const uint64_t quantized = QuantizeDepth(depth, DEPTH_BITS);
+
+    uint64_t key;
+    if (pass == NtRenderPass::Transparent) {
+        const uint64_t farToNear = Field(~static_cast<uint32_t>(quantized), DEPTH_BITS);
+        key = passBits | farToNear << 42 | pipeline << 36 | set << MESH_BITS | mesh;
+    }
+    else {
+        key = passBits | pipeline << 56 | set << 40 | mesh << DEPTH_BITS | quantized;
+    }
+
+    entries.push_back({key, static_cast<uint32_t>(items.size())});
+    items.push_back(item);
+}
+
+void NtRenderQueue::sort() {
+    const size_t count = entries.size();
+    if (count < 2) return;
+
+    // Histograms for every byte of the key in one pass
+    uint32_t histograms[RADIX_PASSES][RADIX_BUCKETS] = {};
+    for (const auto& entry : entries) {
+        for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass) {
+            ++histograms[pass][(entry.key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)];
+        }
+    }
+
+    scratch.resize(count);
+    NtRenderQueueEntry* source = entries.data();
+    NtRenderQueueEntry* target = scratch.data();
+
+    for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass) {
+        const uint32_t shift = pass * RADIX_BITS;
+        uint32_t* histogram = histograms[pass];
+
+        // A byte shared by every key would copy the array unchanged
+        if (histogram[(source[0].key >> shift) & (RADIX_BUCKETS - 1)] == count) continue;
+
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < RADIX_BUCKETS; ++bucket) {
+            offset += std::exchange(histogram[bucket], offset);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            target[histogram[(source[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = source[i];
+        }
+        std::swap(source, target);
+    }
+
+    if (source != entries.data()) {
+        entries.swap(scratch);
+    }
+}
+
+std::span<const NtRenderQueueEntry> NtRenderQueue::entriesOf(NtRenderPass pass) const {
+    const uint32_t passIndex = static_cast<uint32_t>(pass);
+    auto inPassOrEarlier = [](uint32_t last) {
+        return [last](const NtRenderQueueEntry& entry) { return (entry.key >> PASS_SHIFT) <= last; };
+    };
+
+    const auto begin = passIndex == 0 ? entries.begin()
+        : std::partition_point(entries.begin(), entries.end(), inPassOrEarlier(passIndex - 1));
+    const auto end = std::partition_point(begin, entries.end(), inPassOrEarlier(passIndex));
+    return {begin, end};
+}
+
+uint32_t NtRenderQueue::materialSetId(VkDescriptorSet set) {
+    if (materialSetIds.size() >= (size_t{1} << MATERIAL_SET_BITS)) {
+        materialSetIds.clear();
+    }
+    return materialSetIds.try_emplace(set, static_cast<uint32_t>(materialSetIds.size())).first->second;
+}
+
+uint32_t NtRenderQueue::meshId(const NtModel* model, uint32_t meshIndex, uint32_t lod) {
+    // Every mesh reserves ids for all its possible LODs
+    const uint32_t idCount = model->getMeshCount() * MAX_LODS;
+    auto it = firstMeshIds.find(model);
+    if (it == firstMeshIds.end()) {
+        if (nextMeshId + idCount > (1u << MESH_BITS)) {
+            firstMeshIds.clear();
+            nextMeshId = 0;
+        }
+        it = firstMeshIds.emplace(model, nextMeshId).first;
+        nextMeshId += idCount;
+    }
+    return it->second + meshIndex * MAX_LODS + lod;
+}
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "nt_material.hpp"
+#include "nt_types.hpp"
+#include "vulkan/vulkan_core.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace nt
+{
+
+class NtModel;
+class NtSkeletonPose;
+
+//==============================
+// RENDER QUEUE
+//==============================
+// A frame's draws as flat POD items, each with a 64-bit sort key. Sorted keys
+// group draws by pass, pipeline, material descriptor set and mesh, so the
+// emitter only has to change state where neighbouring keys differ. Storage is
+// kept between frames and reused once it has grown.
+
+enum class NtRenderPass : uint8_t {
+    Shadow,
+    Opaque,
+    Transparent,
+    Count
+};
+
+// One mesh of one entity, valid until the end of the frame it was pushed in
+struct NtDrawItem {
+    NtModel* model;
+    const glm::mat4* world;
+    const glm::mat4* normal;
+    VkDescriptorSet materialSet;    // Set 1, VK_NULL_HANDLE keeps whatever is bound
+    const NtSkeletonPose* skinnedPose;  // Draws the vertices the skinning pass wrote, null draws from the geometry arena
+    uint32_t meshIndex;
+    uint8_t lod;                    // Detail level, below the model's getLodCount(meshIndex)
+    MaterialType materialType;
+    uint32_t candidate;             // Index of the culling candidate it came from
+};
+
+// Vertex layout an item is drawn with: the model's, static for skinned output
+NtVertexLayout GetDrawLayout(const NtDrawItem& item);
+
+struct NtRenderQueueEntry {
+    uint64_t key;
+    uint32_t item;
+};
+
+// Per-frame counters from culling and emitting the queue
+struct NtRenderStats {
+    uint32_t drawCalls = 0;
+    uint32_t instances = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t descriptorSetBinds = 0;
+    uint32_t bufferBinds = 0;
+    uint32_t skippedBinds = 0;  // Binds left out because the state was already current
+    uint32_t culledDraws[static_cast<size_t>(NtRenderPass::Count)] = {};  // Per NtRenderPass, dropped by frustum culling
+    uint32_t lodDraws[MAX_LODS] = {};  // Main pass candidates per selected LOD
+    uint32_t skinnedInstances = 0;
+    uint32_t skinnedVertices = 0;   // Written by the skinning pass, once for all passes
+    uint32_t gpuObjects = 0;        // Meshes in the GPU-driven scene, culled on the GPU
+    uint32_t gpuRowUploads = 0;     // Scene rows uploaded for the frame
+    float cpuMs = 0.0f;         // Time spent preparing and recording the draws
+
+    uint32_t stateChanges() const { return pipelineBinds + descriptorSetBinds + bufferBinds; }
+};
+
+class NtRenderQueue
+{
+public:
+    // Key layout, most significant bits first:
+    //   pass(2) | pipeline(6) | material set(16) | mesh(20) | depth(20)
+    // where pipeline is the material type and the vertex layout in the lowest bit, and
+    // mesh tells the LODs of a mesh apart as well.
+    // Transparent draws need back-to-front order more than batching, so their
+    // depth is inverted and moves up right below the pass:
+    //   pass(2) | far-to-near depth(20) | pipeline(6) | material set(16) | mesh(20)
+    static constexpr uint32_t PASS_SHIFT = 62;
+
+    void clear();
+    void push(NtRenderPass pass, const NtDrawItem& item, float depth);
+
+    // LSD radix sort on the keys, skipping bytes that are the same in every key
+    void sort();
+
+    // Sorted entries of one pass, valid until the next clear
+    std::span<const NtRenderQueueEntry> entriesOf(NtRenderPass pass) const;
+    const NtDrawItem& item(const NtRenderQueueEntry& entry) const { return items[entry.item]; }
+    size_t size() const { return items.size(); }
+
+private:
+    static constexpr uint32_t MATERIAL_SET_BITS = 16;
+    static constexpr uint32_t MESH_BITS = 20;
+    static constexpr uint32_t DEPTH_BITS = 20;
+
+    uint32_t materialSetId(VkDescriptorSet set);
+    uint32_t meshId(const NtModel* model, uint32_t meshIndex, uint32_t lod);
+
+    std::vector<NtDrawItem> items;
+    std::vector<NtRenderQueueEntry> entries;
+    std::vector<NtRenderQueueEntry> scratch;
+
+    // Dense ids for the key fields. They only group equal state, the emitter still
+    // compares the real handles, so they are handed out first come and kept across
+    // frames. A table that runs out of bits starts over.
+    std::unordered_map<VkDescriptorSet, uint32_t> materialSetIds;
+    std::unordered_map<const NtModel*, uint32_t> firstMeshIds;
+    uint32_t nextMeshId = 0;
+};
+
+}
@@ -2,6 +2,8 @@
 #include "nt_device.hpp"
 #include "nt_ecs.hpp"
 #include "nt_frame_info.hpp"
+#include "nt_animator.hpp"
+#include "nt_frustum.hpp"
 #include "nt_log.hpp"
 #include "nt_material.hpp"
 #include "nt_pipeline.hpp"
@@ -21,9 +23,16 @@
 #include <glm/gtc/constants.hpp>
 
 // Std
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <limits>
 #include <memory>
 #include <stdexcept>
+#include <tuple>
+#include <utility>
 
 namespace nt
 {
@@ -33,155 +42,587 @@ struct PointLightPushConstants {
   glm::vec4 color{};
 };
 
+namespace {
+
+float millisecondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Bounding spheres scale with the largest axis of the world matrix
+float maxAxisScale(const glm::mat4& world) {
+    return std::sqrt(std::max({glm::dot(glm::vec3(world[0]), glm::vec3(world[0])),
+                               glm::dot(glm::vec3(world[1]), glm::vec3(world[1])),
+                               glm::dot(glm::vec3(world[2]), glm::vec3(world[2]))}));
+}
+
+NtInstanceData makeInstance(const NtModel& model, uint32_t meshIndex, const glm::mat4& world, const glm::mat4& normal,
+    bool bSkinned) {
+    NtInstanceData instance{};
+    // Packed positions decode through the model matrix, skinned ones from their larger box
+    instance.modelMatrix = world * (bSkinned ? model.getSkinnedPositionDecode() : model.getPositionDecode());
+    instance.normalMatrix = normal;
+    instance.isAnimated = bSkinned ? 1 : 0;
+
+    // Get the material data for this specific mesh
+    const auto& matData = model.getMaterialData(meshIndex);
+    instance.uvScale = matData.uvScale;
+    instance.uvOffset = matData.uvOffset;
+    instance.uvRotation = matData.uvRotation;
+    instance.hasNormalTexture = matData.normalTexture ? 1 : 0;
+    instance.hasMetallicRoughnessTexture = matData.pbrMetallicRoughness.metallicRoughnessTexture ? 1 : 0;
+    instance.metallicFactor = matData.pbrMetallicRoughness.metallicFactor;
+    instance.roughnessFactor = matData.pbrMetallicRoughness.roughnessFactor;
+    return instance;
+}
+
+}
+
 RenderSystem::RenderSystem(NtNexus* nexus_ptr, NtDevice &device,
                     NtSwapChain &swapChain,
-                    std::shared_ptr<NtMaterialLibrary> matLibrary)
-    : ntDevice{device}, nexus{nexus_ptr}, materialLibrary{matLibrary} {
+                    NtGeometryArena &arena,
+                    std::shared_ptr<NtMaterialLibrary> matLibrary,
+                    std::shared_ptr<TransformSystem> transforms,
+                    std::shared_ptr<NtSkinningPass> skinningPass,
+                    std::shared_ptr<NtGpuCuller> gpuCuller)
+    : ntDevice{device}, nexus{nexus_ptr}, geometryArena{arena}, materialLibrary{matLibrary}, transformSystem{transforms},
+      skinning{skinningPass}, culler{gpuCuller} {
 }
 
 RenderSystem::~RenderSystem() {
 }
 
-void RenderSystem::render(FrameInfo& frameInfo) {
-    // Group objects by material type
-    std::unordered_map<MaterialType, std::vector<NtEntity>> batches;
+void RenderSystem::prepare(const GlobalUbo& ubo) {
+    const auto startTime = std::chrono::high_resolution_clock::now();
+
+    queue.clear();
+    candidates.clear();
+    skinningJobs.clear();
+    for (auto& stream : sphereStreams) stream.clear();
+    stats = {};
+    bFrameGpuDriven = bGpuDriven;
+
+    const glm::mat4 viewProjection = ubo.projection * ubo.view;
+
+    // Clip-space w, the distance in front of the camera
+    const glm::vec4 depthRow{viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]};
+    // Focal scale for screen sizes. projection[1][1] is negative, it flips Y for Vulkan.
+    const float projectionScale = std::abs(ubo.projection[1][1]);
+
+    // Entities mostly share a handful of material types, remember the last lookup
+    MaterialType lastType{};
+    NtRenderPass lastPass = NtRenderPass::Opaque;
+    bool bHaveLastType = false;
+
+    auto gather = [&](NtEntity entity, const cModel& modelComp) {
+        if (!modelComp.mesh) return;
+
+        // Entities created after the transform update are picked up next frame
+        const glm::mat4* world = transformSystem->getWorldMatrix(entity);
+        if (!world) return;
+
+        NtModel* model = modelComp.mesh.get();
+        const MaterialType type = model->getMaterialType();
+        if (!bHaveLastType || type != lastType) {
+            lastType = type;
+            lastPass = materialLibrary->getMaterial(type)->isAlphaBlended() ? NtRenderPass::Transparent : NtRenderPass::Opaque;
+            bHaveLastType = true;
+        }
 
-    for (auto& entity : entities) {
-        const auto& modelComp = nexus->GetComponent<cModel>(entity);
-        if (!modelComp.mesh) continue;
+        // Skinned only with joints to skin against, a skeleton without bones packs as static. Animated
+        // entities sharing a model each have a pose of their own, skinned once for every pass.
+        const NtSkeletonPose* skinnedPose = nullptr;
+        if (model->getVertexLayout() == NtVertexLayout::Skinned && nexus->HasComponent<cAnimator>(entity)) {
+            const NtSkeletonPose& pose = nexus->GetComponent<const cAnimator>(entity).animator->getPose();
+            if (pose.isCreatedFor(*model) && pose.hasSkinnedVertices()) {
+                skinnedPose = &pose;
+                skinningJobs.push_back({model, skinnedPose});
+            }
+        }
+        const bool bAnimated = skinnedPose != nullptr;
+        const glm::mat4* normal = transformSystem->getNormalMatrix(entity);
+
+        const float maxScale = maxAxisScale(*world);
+
+        const uint32_t entityIndex = EntityIndex(entity);
+        if (entityIndex >= lodHistory.size()) lodHistory.resize(entityIndex + 1);
+        LodHistory& history = lodHistory[entityIndex];
+        if (history.entity != entity || history.model != model) {
+            history.entity = entity;
+            history.model = model;
+            history.levels.assign(model->getMeshCount(), 0);
+        }
 
-        MaterialType type = modelComp.mesh->getMaterialType();
-        batches[type].push_back(entity);
+        // One candidate per mesh, each with its own material descriptor set (textures)
+        for (uint32_t meshIndex = 0; meshIndex < model->getMeshCount(); ++meshIndex) {
+            const auto& bounds = model->getMeshBounds(meshIndex);
+            const glm::vec4 center = *world * glm::vec4(bounds.center, 1.0f);
+            const float depth = glm::dot(depthRow, center);
+
+            // Starting from last frame's level, coarser below a threshold and finer only well above it.
+            // Clip w is 1 under an orthographic projection, so the size stays put there.
+            const float screenSize = bounds.radius * maxScale * projectionScale / std::max(depth, 1e-4f);
+            const uint32_t lodCount = model->getLodCount(meshIndex);
+            uint32_t lod = std::min<uint32_t>(history.levels[meshIndex], lodCount - 1);
+            while (lod + 1 < lodCount && screenSize < LOD_SCREEN_SIZES[lod]) ++lod;
+            while (lod > 0 && screenSize > LOD_SCREEN_SIZES[lod - 1] * (1.0f + LOD_HYSTERESIS)) --lod;
+            history.levels[meshIndex] = static_cast<uint8_t>(lod);
+
+            sphereStreams[0].push_back(center.x);
+            sphereStreams[1].push_back(center.y);
+            sphereStreams[2].push_back(center.z);
+            // Skinned meshes can leave their bind-pose bounds, so they are never culled
+            sphereStreams[3].push_back(bAnimated ? std::numeric_limits<float>::max() : bounds.radius * maxScale);
+
+            candidates.push_back({
+                {model, world, normal, model->getMaterialDescriptorSet(meshIndex), skinnedPose, meshIndex,
+                 static_cast<uint8_t>(lod), type, static_cast<uint32_t>(candidates.size())},
+                lastPass, depth, modelComp.bDropShadow});
+        }
+    };
+
+    // GPU-driven frames only gather what the GPU scene leaves to the CPU
+    if (bFrameGpuDriven) {
+        updateGpuScene();
+        for (NtEntity entity : cpuDrawnEntities) {
+            gather(entity, nexus->GetComponent<const cModel>(entity));
+        }
+        stats.gpuObjects = static_cast<uint32_t>(gpuObjects.size());
+        stats.gpuRowUploads = culler->getPendingRowCount();
+    }
+    else {
+        bGpuSceneValid = false;
+        nexus->View<const cModel, const cTransform>().Each([&](NtEntity entity, const cModel& modelComp, const cTransform&) {
+            gather(entity, modelComp);
+        });
+    }
+
+    // Camera frustum for the main passes. Directional light's ortho box for the shadow pass;
+    // without a directional light the light matrix is not kept up to date, so casters are
+    // all drawn as before.
+    cameraFrustum = NtFrustum::fromViewProjection(viewProjection);
+    bHasShadowLight = ubo.shadowLightDirection.w >= 0.0f;
+    if (bHasShadowLight) lightFrustum = NtFrustum::fromViewProjection(ubo.lightSpaceMatrix);
+
+    cullView.camera = cameraFrustum;
+    cullView.light = lightFrustum;
+    cullView.bHasLight = bHasShadowLight;
+    cullView.depthRow = depthRow;
+    cullView.projectionScale = projectionScale;
+    std::copy(std::begin(LOD_SCREEN_SIZES), std::end(LOD_SCREEN_SIZES), cullView.lodScreenSizes);
+    cullView.lodHysteresis = LOD_HYSTERESIS;
+    cullView.shadowLodBias = shadowLodBias;
+
+    auto pushShadow = [&](const DrawCandidate& candidate) {
+        NtDrawItem item = candidate.item;
+        item.materialType = MaterialType::SHADOW_MAP;
+        item.lod = static_cast<uint8_t>(std::min(item.lod + shadowLodBias, item.model->getLodCount(item.meshIndex) - 1));
+        queue.push(NtRenderPass::Shadow, item, 0.0f);
+    };
+
+    const NtSphereStreams spheres{sphereStreams[0].data(), sphereStreams[1].data(), sphereStreams[2].data(), sphereStreams[3].data()};
+    visibility.resize(candidates.size());
+
+    CullSpheresBatch(cameraFrustum, spheres, visibility.data(), candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        const auto& candidate = candidates[i];
+        if (visibility[i]) {
+            queue.push(candidate.pass, candidate.item, candidate.depth);
+            ++stats.lodDraws[candidate.item.lod];
+        }
+        else ++stats.culledDraws[static_cast<size_t>(candidate.pass)];
+    }
+
+    if (bHasShadowLight) {
+        CullSpheresBatch(lightFrustum, spheres, visibility.data(), candidates.size());
     }
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        const auto& candidate = candidates[i];
+        if (!candidate.bDropShadow) continue;
 
-    NT_LOG_VERBOSE(LogRendering, "Rendering {} material batches", batches.size());
+        if (bHasShadowLight && !visibility[i]) {
+            ++stats.culledDraws[static_cast<size_t>(NtRenderPass::Shadow)];
+            continue;
+        }
+        pushShadow(candidate);
+    }
 
-    // Render each material batch
-    for (auto& [materialType, batch] : batches) {
-        if (batch.empty()) continue;
+    queue.sort();
+    buildBatches();
 
-        NT_LOG_VERBOSE(LogRendering, "Rendering batch with material type {}, {} entities",
-                   static_cast<int>(materialType), batch.size());
+    NT_LOG_VERBOSE(LogRendering, "Render queue holds {} instances in {} draws, {} candidates",
+        instances.size(), batches.size(), candidates.size());
 
-        // Bind pipeline once for the entire batch
-        auto material = materialLibrary->getMaterial(materialType);
-        material->bind(frameInfo.commandBuffer);
+    stats.cpuMs += millisecondsSince(startTime);
+}
 
-        // Bind global descriptor set once per material
-        vkCmdBindDescriptorSets(
-            frameInfo.commandBuffer,
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            material->getPipelineLayout(),
-            0, 1,
-            &frameInfo.globalDescriptorSet,
-            0, nullptr
-        );
+void RenderSystem::dispatchSkinning(FrameInfo& frameInfo) {
+    if (skinningJobs.empty()) return;
 
-        // Render all objects with this material
-        renderBatch(frameInfo, material, batch);
+    const auto startTime = std::chrono::high_resolution_clock::now();
+
+    skinning->dispatch(frameInfo.commandBuffer, frameInfo.frameIndex, skinningJobs);
+    stats.skinnedInstances = static_cast<uint32_t>(skinningJobs.size());
+    stats.skinnedVertices = skinning->getSkinnedVertexCount();
+
+    stats.cpuMs += millisecondsSince(startTime);
+}
+
+void RenderSystem::dispatchCulling(FrameInfo& frameInfo) {
+    if (!bFrameGpuDriven) return;
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+
+    // GPU-culled instances go behind the ones the CPU path wrote
+    culler->dispatch(frameInfo.commandBuffer, frameInfo.frameIndex, cullView, static_cast<uint32_t>(instances.size()));
+
+    stats.cpuMs += millisecondsSince(startTime);
+}
+
+void RenderSystem::buildBatches() {
+    batches.clear();
+    instances.clear();
+
+    // Neighbours in the sorted queue that draw the same mesh with the same bindings
+    // become one instanced draw
+    auto sameDraw = [](const NtDrawItem& a, const NtDrawItem& b) {
+        return a.model == b.model && a.meshIndex == b.meshIndex && a.lod == b.lod && a.materialType == b.materialType &&
+               a.materialSet == b.materialSet && a.skinnedPose == b.skinnedPose;
+    };
+
+    for (size_t pass = 0; pass < passBatches.size() - 1; ++pass) {
+        passBatches[pass] = static_cast<uint32_t>(batches.size());
+
+        const NtDrawItem* previous = nullptr;
+        for (const auto& entry : queue.entriesOf(static_cast<NtRenderPass>(pass))) {
+            if (instances.size() == MAX_INSTANCES) {
+                if (!bWarnedInstanceOverflow) {
+                    NT_LOG_WARN(LogRendering, "Instance buffer full, draws past {} instances are dropped", MAX_INSTANCES);
+                    bWarnedInstanceOverflow = true;
+                }
+                break;
+            }
+
+            const NtDrawItem& item = queue.item(entry);
+            if (!previous || !sameDraw(*previous, item)) {
+                batches.push_back({&item, static_cast<uint32_t>(instances.size()), 0});
+            }
+            ++batches.back().instanceCount;
+            previous = &item;
+
+            instances.push_back(makeInstance(*item.model, item.meshIndex, *item.world, *item.normal, item.skinnedPose != nullptr));
+        }
     }
+    passBatches.back() = static_cast<uint32_t>(batches.size());
 }
 
-void RenderSystem::renderShadows(FrameInfo& frameInfo) {
-    // Get shadow map material
-    auto shadowMaterial = materialLibrary->getMaterial(MaterialType::SHADOW_MAP);
-    shadowMaterial->bind(frameInfo.commandBuffer);
-
-    // Bind global descriptor set
-    vkCmdBindDescriptorSets(
-        frameInfo.commandBuffer,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        shadowMaterial->getPipelineLayout(),
-        0, 1,
-        &frameInfo.globalDescriptorSet,
-        0, nullptr
-    );
-
-    // Render all entities that cast shadows
-    std::vector<NtEntity> shadowCasters;
-    for (auto& entity : entities) {
-        const auto& modelComp = nexus->GetComponent<cModel>(entity);
-        if (!modelComp.mesh || !modelComp.bDropShadow) continue;
-        shadowCasters.push_back(entity);
-    }
-
-    if (!shadowCasters.empty()) {
-        NT_LOG_VERBOSE(LogRendering, "Rendering {} shadow casting entities", shadowCasters.size());
-        renderBatch(frameInfo, shadowMaterial, shadowCasters);
-    }
-}
-
-void RenderSystem::renderBatch(FrameInfo& frameInfo, std::shared_ptr<NtMaterial> material,
-    const std::vector<NtEntity>& batch) {
-
-    for (const auto& entity : batch) {
-        const auto& modelComp = nexus->GetComponent<cModel>(entity);
-        const auto& transformComp = nexus->GetComponent<cTransform>(entity);
-
-        if (!modelComp.mesh) continue;
-
-        // Render each mesh with its own material data (textures)
-        for (uint32_t meshIndex = 0; meshIndex < modelComp.mesh->getMeshCount(); ++meshIndex) {
-
-            // Bind the material descriptor set for this specific mesh (textures)
-            uint32_t materialIndex = modelComp.mesh->getMaterialIndex(meshIndex);
-            VkDescriptorSet materialDescriptorSet = modelComp.mesh->getMaterialDescriptorSet(materialIndex);
-
-            if (materialDescriptorSet != VK_NULL_HANDLE) {
-                vkCmdBindDescriptorSets(
-                    frameInfo.commandBuffer,
-                    VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    material->getPipelineLayout(),
-                    1, 1,
-                    &materialDescriptorSet,
-                    0, nullptr);
+void RenderSystem::updateGpuScene() {
+    const uint32_t since = std::exchange(lastRunTick, nexus->ClaimChangeTick());
+
+    // Membership, models and geometry ranges change now and then, any of them rebuilds the
+    // scene. An added cModel also counts as changed.
+    bool bStale = !bGpuSceneValid || entities.Size() != gpuMemberCount ||
+                  transformSystem->entities.Size() != gpuTransformCount ||
+                  geometryArena.getRangeVersion() != gpuRangeVersion;
+    if (!bStale) {
+        nexus->View<const cModel>().Changed<cModel>(since).Each([&](const cModel&) { bStale = true; });
+        nexus->View<const cModel, const cAnimator>().Added<cAnimator>(since).Each(
+            [&](const cModel&, const cAnimator&) { bStale = true; });
+    }
+    if (!bStale) {
+        for (NtEntity entity : pendingEntities) {
+            if (nexus->GetComponent<const cModel>(entity).mesh && transformSystem->getWorldMatrix(entity)) {
+                bStale = true;
+                break;
             }
+        }
+    }
 
-            // Setup push constants
-            NtPushConstantData push{};
-            push.modelMatrix = transformComp.mat4();
-            push.normalMatrix = transformComp.normalMatrix();
-
-            // Bind bone matrices if animated (binding 2)
-            if (modelComp.mesh->hasSkeleton()) {
-                if (nexus->HasComponent<cAnimator>(entity)) {
-                    if (modelComp.mesh->hasBoneDescriptor()) {
-                        vkCmdBindDescriptorSets(
-                            frameInfo.commandBuffer,
-                            VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            material->getPipelineLayout(),
-                            2,  // Set 2
-                            1,
-                            &modelComp.mesh->getBoneDescriptorSet(),
-                            0, nullptr);
-                    }
-                    push.isAnimated = 1;
+    if (bStale) {
+        rebuildGpuScene();
+        return;
+    }
+
+    // Otherwise only rows of entities that moved
+    transformSystem->forEachUpdated([&](NtEntity entity) {
+        const uint32_t entityIndex = EntityIndex(entity);
+        if (entityIndex < gpuEntities.size() && gpuEntities[entityIndex].entity == entity) {
+            writeGpuObjects(gpuEntities[entityIndex]);
+        }
+    });
+}
+
+void RenderSystem::rebuildGpuScene() {
+    gpuObjects.clear();
+    gpuEntities.clear();
+    gpuRuns.clear();
+    cpuDrawnEntities.clear();
+    pendingEntities.clear();
+
+    // A mesh in one pass, sorted like the render queue so runs share as much state as they can
+    struct SlotKey {
+        NtRenderPass pass;
+        MaterialType materialType;
+        NtVertexLayout layout;
+        VkDescriptorSet materialSet;
+        uint32_t geometryBlock;
+        NtModel* model;
+        uint32_t meshIndex;
+        uint32_t object;
+
+        auto runState() const { return std::make_tuple(pass, materialType, layout, materialSet, geometryBlock); }
+        auto order() const { return std::make_tuple(pass, materialType, layout, materialSet, geometryBlock, model, meshIndex); }
+    };
+    std::vector<SlotKey> keys;
+
+    for (NtEntity entity : entities) {
+        const cModel& modelComp = nexus->GetComponent<const cModel>(entity);
+        NtModel* model = modelComp.mesh.get();
+        if (!model || !transformSystem->getWorldMatrix(entity)) {
+            pendingEntities.push_back(entity);
+            continue;
+        }
+
+        // Sorted back to front or skinned every frame, these stay with the CPU path. So does
+        // whatever no longer fits the scene.
+        const bool bTransparent = materialLibrary->getMaterial(model->getMaterialType())->isAlphaBlended();
+        const bool bAnimated = model->getVertexLayout() == NtVertexLayout::Skinned && nexus->HasComponent<cAnimator>(entity);
+        if (bTransparent || bAnimated || gpuObjects.size() + model->getMeshCount() > NtGpuCuller::MAX_OBJECTS) {
+            cpuDrawnEntities.push_back(entity);
+            continue;
+        }
+
+        const uint32_t entityIndex = EntityIndex(entity);
+        if (entityIndex >= gpuEntities.size()) gpuEntities.resize(entityIndex + 1);
+        gpuEntities[entityIndex] = {entity, static_cast<uint32_t>(gpuObjects.size()), model->getMeshCount()};
+
+        for (uint32_t meshIndex = 0; meshIndex < model->getMeshCount(); ++meshIndex) {
+            const uint32_t object = static_cast<uint32_t>(gpuObjects.size());
+            gpuObjects.push_back({model, meshIndex, NtGpuCuller::NO_SLOT, NtGpuCuller::NO_SLOT});
+
+            const VkDescriptorSet materialSet = model->getMaterialDescriptorSet(meshIndex);
+            const uint32_t geometryBlock = model->getGeometry(meshIndex).block;
+            keys.push_back({NtRenderPass::Opaque, model->getMaterialType(), model->getVertexLayout(), materialSet,
+                            geometryBlock, model, meshIndex, object});
+            if (modelComp.bDropShadow) {
+                keys.push_back({NtRenderPass::Shadow, MaterialType::SHADOW_MAP, model->getVertexLayout(), materialSet,
+                                geometryBlock, model, meshIndex, object});
+            }
+        }
+    }
+
+    std::sort(keys.begin(), keys.end(), [](const SlotKey& a, const SlotKey& b) { return a.order() < b.order(); });
+
+    // Every LOD of a mesh gets a slot, consecutive so the cull pass can offset into them
+    std::vector<NtGpuDrawSlot> slots;
+    uint32_t meshFirstSlot = NtGpuCuller::NO_SLOT;
+    bool bRunOpen = false;
+    bool bWarnedSlotOverflow = false;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const SlotKey& key = keys[i];
+        const bool bNewRun = i == 0 || key.runState() != keys[i - 1].runState();
+        const bool bNewMesh = bNewRun || key.model != keys[i - 1].model || key.meshIndex != keys[i - 1].meshIndex;
+        if (bNewRun) bRunOpen = false;
+
+        if (bNewMesh) {
+            const uint32_t lodCount = key.model->getLodCount(key.meshIndex);
+            if (slots.size() + lodCount > NtGpuCuller::MAX_SLOTS) {
+                if (!bWarnedSlotOverflow) {
+                    NT_LOG_WARN(LogRendering, "GPU scene has more than {} mesh LODs, the rest is not drawn", NtGpuCuller::MAX_SLOTS);
+                    bWarnedSlotOverflow = true;
                 }
+                meshFirstSlot = NtGpuCuller::NO_SLOT;
             }
+            else {
+                if (!bRunOpen) {
+                    gpuRuns.push_back({key.pass, {key.model, nullptr, nullptr, key.materialSet, nullptr, key.meshIndex, 0,
+                                       key.materialType, 0}, static_cast<uint32_t>(slots.size()), 0});
+                    bRunOpen = true;
+                }
+                GpuRun& run = gpuRuns.back();
+                const auto& geometry = key.model->getGeometry(key.meshIndex);
+                meshFirstSlot = static_cast<uint32_t>(slots.size());
+                for (uint32_t lod = 0; lod < lodCount; ++lod) {
+                    const auto& range = key.model->getLod(key.meshIndex, lod);
+                    slots.push_back({range.indexCount, geometry.firstIndex + range.firstIndex,
+                                     static_cast<int32_t>(geometry.vertexOffset),
+                                     static_cast<uint32_t>(gpuRuns.size() - 1), run.firstSlot, {}});
+                }
+                run.slotCount += lodCount;
+            }
+        }
 
-            // Get the material data for this specific mesh
-            const auto& matData = modelComp.mesh->getMaterialData(materialIndex);
-            push.uvScale = matData.uvScale;
-            push.uvOffset = matData.uvOffset;
-            push.uvRotation = matData.uvRotation;
-            push.hasNormalTexture = matData.normalTexture ? 1 : 0;
-            push.hasMetallicRoughnessTexture = matData.pbrMetallicRoughness.metallicRoughnessTexture ? 1 : 0;
-            push.metallicFactor = matData.pbrMetallicRoughness.metallicFactor;
-            push.roughnessFactor = matData.pbrMetallicRoughness.roughnessFactor;
-            push.time = frameInfo.elapsedTime;
+        GpuObject& object = gpuObjects[key.object];
+        (key.pass == NtRenderPass::Shadow ? object.shadowSlot : object.mainSlot) = meshFirstSlot;
+    }
+
+    // Runs come sorted by pass
+    for (size_t pass = 0; pass < gpuPassRuns.size(); ++pass) {
+        gpuPassRuns[pass] = static_cast<uint32_t>(std::partition_point(gpuRuns.begin(), gpuRuns.end(),
+            [&](const GpuRun& run) { return static_cast<size_t>(run.pass) < pass; }) - gpuRuns.begin());
+    }
+
+    culler->resetScene(static_cast<uint32_t>(gpuObjects.size()), static_cast<uint32_t>(slots.size()),
+        static_cast<uint32_t>(gpuRuns.size()));
+    for (uint32_t slot = 0; slot < slots.size(); ++slot) {
+        culler->writeSlot(slot, slots[slot]);
+    }
+    for (const GpuEntity& gpuEntity : gpuEntities) {
+        if (gpuEntity.entity != INVALID_ENTITY) writeGpuObjects(gpuEntity);
+    }
+
+    bGpuSceneValid = true;
+    gpuMemberCount = entities.Size();
+    gpuTransformCount = transformSystem->entities.Size();
+    gpuRangeVersion = geometryArena.getRangeVersion();
+
+    NT_LOG_VERBOSE(LogRendering, "GPU scene rebuilt: {} objects in {} slots and {} runs, {} entities left to the CPU",
+        gpuObjects.size(), slots.size(), gpuRuns.size(), cpuDrawnEntities.size());
+}
+
+void RenderSystem::writeGpuObjects(const GpuEntity& gpuEntity) {
+    const glm::mat4& world = *transformSystem->getWorldMatrix(gpuEntity.entity);
+    const glm::mat4& normal = *transformSystem->getNormalMatrix(gpuEntity.entity);
+    const float maxScale = maxAxisScale(world);
+
+    for (uint32_t object = gpuEntity.firstObject; object < gpuEntity.firstObject + gpuEntity.objectCount; ++object) {
+        const GpuObject& gpuObject = gpuObjects[object];
+        const auto& bounds = gpuObject.model->getMeshBounds(gpuObject.meshIndex);
+        const glm::vec3 center{world * glm::vec4(bounds.center, 1.0f)};
+
+        const NtGpuObject row{glm::vec4(center, bounds.radius * maxScale), gpuObject.mainSlot, gpuObject.shadowSlot,
+                              gpuObject.model->getLodCount(gpuObject.meshIndex), 0};
+        culler->writeObject(object, row, makeInstance(*gpuObject.model, gpuObject.meshIndex, world, normal, false));
+    }
+}
+
+void RenderSystem::render(FrameInfo& frameInfo) {
+    emitGpuRuns(frameInfo, NtRenderPass::Opaque);
+    emit(frameInfo, NtRenderPass::Opaque);
+    emit(frameInfo, NtRenderPass::Transparent);
+}
+
+void RenderSystem::renderShadows(FrameInfo& frameInfo) {
+    emitGpuRuns(frameInfo, NtRenderPass::Shadow);
+    emit(frameInfo, NtRenderPass::Shadow);
+}
+
+void RenderSystem::bind(FrameInfo& frameInfo, BoundState& state, const NtDrawItem& item) {
+    const VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+    // Every material's pipeline layout is built from the same set layouts and push
+    // constant range, so they are compatible and bound sets survive pipeline switches
+    auto bindSet = [&](uint32_t setIndex, VkDescriptorSet set) {
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            state.material->getPipelineLayout(), setIndex, 1, &set, 0, nullptr);
+        ++stats.descriptorSetBinds;
+    };
+
+    const NtVertexLayout layout = GetDrawLayout(item);
+    if (!state.material || state.material->getType() != item.materialType || layout != state.layout) {
+        const bool bFirst = !state.material;
+        if (bFirst || state.material->getType() != item.materialType) {
+            state.material = materialLibrary->getMaterial(item.materialType);
+        }
+        state.material->bind(commandBuffer, layout);
+        state.layout = layout;
+        ++stats.pipelineBinds;
+
+        // Global descriptor set (UBO, shadow map, instances) and per-frame push constants once per pass
+        if (bFirst) {
+            bindSet(0, frameInfo.globalDescriptorSet);
 
+            NtPushConstantData push{};
+            push.time = frameInfo.elapsedTime;
             vkCmdPushConstants(
-                frameInfo.commandBuffer,
-                material->getPipelineLayout(),
+                commandBuffer,
+                state.material->getPipelineLayout(),
                 VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
                 0,
                 sizeof(NtPushConstantData),
                 &push);
+        }
+    }
+    else {
+        ++stats.skippedBinds;
+    }
 
-            modelComp.mesh->bind(frameInfo.commandBuffer, meshIndex);
-            modelComp.mesh->draw(frameInfo.commandBuffer, meshIndex);
+    if (item.materialSet != VK_NULL_HANDLE) {
+        if (item.materialSet != state.materialSet) {
+            bindSet(1, item.materialSet);
+            state.materialSet = item.materialSet;
         }
+        else {
+            ++stats.skippedBinds;
+        }
+    }
+
+    // Skinned instances draw their own vertices, with the indices of the arena block
+    const uint32_t geometryBlock = item.model->getGeometry(item.meshIndex).block;
+    if (item.skinnedPose) {
+        item.model->bindSkinned(commandBuffer, item.meshIndex, item.skinnedPose->getSkinnedBuffer(),
+            item.skinnedPose->getSkinnedOffset(frameInfo.frameIndex, item.meshIndex));
+        state.geometryBlock = UINT32_MAX;
+        ++stats.bufferBinds;
+    }
+    // Vertex and index buffers only when the mesh lives in another geometry arena block
+    else if (geometryBlock != state.geometryBlock) {
+        item.model->bind(commandBuffer, item.meshIndex);
+        state.geometryBlock = geometryBlock;
+        ++stats.bufferBinds;
+    }
+    else {
+        ++stats.skippedBinds;
+    }
+}
+
+void RenderSystem::emit(FrameInfo& frameInfo, NtRenderPass pass) {
+    const uint32_t begin = passBatches[static_cast<size_t>(pass)];
+    const uint32_t end = passBatches[static_cast<size_t>(pass) + 1];
+    if (begin == end) return;
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+
+    NT_LOG_VERBOSE(LogRendering, "Emitting {} draws for pass {}", end - begin, static_cast<int>(pass));
+
+    BoundState state;
+    for (uint32_t batchIndex = begin; batchIndex < end; ++batchIndex) {
+        const DrawBatch& batch = batches[batchIndex];
+        const NtDrawItem& item = *batch.item;
+
+        bind(frameInfo, state, item);
+        item.model->draw(frameInfo.commandBuffer, item.meshIndex, batch.instanceCount, batch.firstInstance, item.lod,
+            item.skinnedPose != nullptr);
+        ++stats.drawCalls;
+        stats.instances += batch.instanceCount;
+    }
+
+    stats.cpuMs += millisecondsSince(startTime);
+}
+
+void RenderSystem::emitGpuRuns(FrameInfo& frameInfo, NtRenderPass pass) {
+    if (!bFrameGpuDriven) return;
+
+    const uint32_t begin = gpuPassRuns[static_cast<size_t>(pass)];
+    const uint32_t end = gpuPassRuns[static_cast<size_t>(pass) + 1];
+    if (begin == end) return;
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+
+    // One call per run, with up to a command per slot; the count the cull pass wrote drops
+    // the slots without visible instances
+    BoundState state;
+    for (uint32_t runIndex = begin; runIndex < end; ++runIndex) {
+        const GpuRun& run = gpuRuns[runIndex];
+
+        bind(frameInfo, state, run.item);
+        ntDevice.vkCmdDrawIndexedIndirectCount(frameInfo.commandBuffer,
+            culler->getCommandBuffer(frameInfo.frameIndex), run.firstSlot * sizeof(VkDrawIndexedIndirectCommand),
+            culler->getCountBuffer(frameInfo.frameIndex), runIndex * sizeof(uint32_t),
+            run.slotCount, sizeof(VkDrawIndexedIndirectCommand));
+        ++stats.drawCalls;
     }
+
+    stats.cpuMs += millisecondsSince(startTime);
 }
 
 } // namespace nt
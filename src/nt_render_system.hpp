@@ -7,8 +7,15 @@
 #include "nt_swap_chain.hpp"
 #include "nt_types.hpp"
 #include "nt_frame_info.hpp"
+#include "nt_frustum.hpp"
+#include "nt_geometry_arena.hpp"
+#include "nt_gpu_culling.hpp"
+#include "nt_render_queue.hpp"
+#include "nt_skinning.hpp"
+#include "nt_transform_system.hpp"
 #include "vulkan/vulkan_core.h"
 
+#include <array>
 #include <memory>
 using std::vector;
 
@@ -20,23 +27,169 @@ class RenderSystem : public NtSystem
 public:
     RenderSystem(NtNexus* nexus_ptr, NtDevice &device,
                     NtSwapChain &swapChain,
-                    std::shared_ptr<NtMaterialLibrary> matLibrary);
+                    NtGeometryArena &arena,
+                    std::shared_ptr<NtMaterialLibrary> matLibrary,
+                    std::shared_ptr<TransformSystem> transforms,
+                    std::shared_ptr<NtSkinningPass> skinningPass,
+                    std::shared_ptr<NtGpuCuller> gpuCuller = nullptr);
     ~RenderSystem();
 
     RenderSystem(const RenderSystem &) = delete;
     RenderSystem &operator=(const RenderSystem &) = delete;
 
+    // Culls and sorts the frame's draws into the render queue, once per frame after
+    // the transform, camera and light updates
+    void prepare(const GlobalUbo& ubo);
+
+    // GPU-driven draws keep the scene on the GPU, leave culling and LOD selection to a
+    // compute pass and draw each run of meshes that share state with one
+    // vkCmdDrawIndexedIndirectCount. Animated and transparent meshes stay on the CPU path.
+    // Needs a culler, takes effect on the next prepare.
+    void setGpuDriven(bool bEnabled) { bGpuDriven = bEnabled && culler != nullptr; }
+    bool isGpuDriven() const { return bGpuDriven; }
+    bool canGpuDrive() const { return culler != nullptr; }
+
+    // Shadow casters draw this many LODs coarser than the camera sees them, the shadow map
+    // hides the difference
+    void setShadowLodBias(uint32_t bias) { shadowLodBias = bias; }
+    uint32_t getShadowLodBias() const { return shadowLodBias; }
+
+    // Records the skinning pass for the prepared frame's animated instances, outside of
+    // rendering and before the shadow pass
+    void dispatchSkinning(FrameInfo& frameInfo);
+
+    // Uploads the changed scene rows and records the cull pass of a GPU-driven frame,
+    // outside of rendering and before the shadow pass. Does nothing for CPU-culled frames.
+    void dispatchCulling(FrameInfo& frameInfo);
+
     void render(FrameInfo& frameInfo);
     void renderShadows(FrameInfo& frameInfo);
 
+    // Counters for the frame emitted last
+    const NtRenderStats& getStats() const { return stats; }
+
+    // Instance data for the prepared frame's CPU-culled draws, to be copied into the frame's
+    // instance buffer before rendering. Draws index it through gl_InstanceIndex. The cull
+    // pass of a GPU-driven frame writes its instances right behind these.
+    const std::vector<NtInstanceData>& getInstances() const { return instances; }
+
 private:
-    void renderBatch(FrameInfo& frameInfo, std::shared_ptr<NtMaterial> material,
-        const std::vector<NtEntity>& batch);
+    // Projected sphere radius, as a fraction of half the screen height, under which a mesh
+    // drops to the next LOD. Going back up needs LOD_HYSTERESIS more, so a mesh sitting on a
+    // threshold does not flicker between two levels.
+    static constexpr float LOD_SCREEN_SIZES[MAX_LODS - 1] = {0.25f, 0.1f, 0.04f};
+    static constexpr float LOD_HYSTERESIS = 0.15f;
+
+    // LODs an entity's meshes were drawn with last frame
+    struct LodHistory {
+        NtEntity entity = INVALID_ENTITY;
+        const NtModel* model = nullptr;
+        std::vector<uint8_t> levels;
+    };
+
+    // A mesh instance before culling, with the pass and depth it would be queued with
+    struct DrawCandidate {
+        NtDrawItem item;
+        NtRenderPass pass;
+        float depth;
+        bool bDropShadow;
+    };
+
+    // Consecutive queue entries drawn as instances of one mesh
+    struct DrawBatch {
+        const NtDrawItem* item;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+    };
+
+    // Draws of one GPU scene run, with the state of any of its meshes
+    struct GpuRun {
+        NtRenderPass pass;
+        NtDrawItem item;
+        uint32_t firstSlot;     // Also its first draw command
+        uint32_t slotCount;
+    };
+
+    // A mesh in the GPU scene, index-aligned with the culler's objects
+    struct GpuObject {
+        NtModel* model;
+        uint32_t meshIndex;
+        uint32_t mainSlot;
+        uint32_t shadowSlot;
+    };
+
+    // Objects of one entity, indexed by EntityIndex
+    struct GpuEntity {
+        NtEntity entity = INVALID_ENTITY;
+        uint32_t firstObject = 0;
+        uint32_t objectCount = 0;
+    };
+
+    // What emitting a pass has bound so far
+    struct BoundState {
+        std::shared_ptr<NtMaterial> material;
+        NtVertexLayout layout = NtVertexLayout::Static;
+        VkDescriptorSet materialSet = VK_NULL_HANDLE;
+        uint32_t geometryBlock = UINT32_MAX;
+    };
+
+    void updateGpuScene();
+    void rebuildGpuScene();
+    void writeGpuObjects(const GpuEntity& gpuEntity);
+
+    void buildBatches();
+    void bind(FrameInfo& frameInfo, BoundState& state, const NtDrawItem& item);
+    void emit(FrameInfo& frameInfo, NtRenderPass pass);
+    void emitGpuRuns(FrameInfo& frameInfo, NtRenderPass pass);
 
     NtDevice &ntDevice;
     NtNexus* nexus;
+    NtGeometryArena &geometryArena;
 
     std::shared_ptr<NtMaterialLibrary> materialLibrary;
+    std::shared_ptr<TransformSystem> transformSystem;
+    std::shared_ptr<NtSkinningPass> skinning;
+    std::shared_ptr<NtGpuCuller> culler;
+
+    NtRenderQueue queue;
+    NtRenderStats stats;
+
+    // Index-aligned with candidates: world-space sphere center xyz and radius
+    std::vector<DrawCandidate> candidates;
+    std::vector<float> sphereStreams[4];
+    std::vector<uint8_t> visibility;
+    std::vector<NtSkinningJob> skinningJobs;
+
+    // Indexed by EntityIndex, a slot is reset when its entity or model changes
+    std::vector<LodHistory> lodHistory;
+    uint32_t shadowLodBias = 1;
+
+    // Sorted draws, with the batches of each pass in [passBatches[pass], passBatches[pass + 1])
+    std::vector<DrawBatch> batches;
+    std::array<uint32_t, static_cast<size_t>(NtRenderPass::Count) + 1> passBatches{};
+    std::vector<NtInstanceData> instances;
+    bool bWarnedInstanceOverflow = false;
+
+    bool bGpuDriven = false;
+    bool bFrameGpuDriven = false;   // Mode the prepared frame was built for
+    bool bHasShadowLight = false;
+    NtFrustum cameraFrustum{};
+    NtFrustum lightFrustum{};
+    NtGpuCullView cullView{};
+
+    // GPU-driven scene. Rebuilt when members, their models or geometry ranges change,
+    // otherwise only the objects of entities whose transforms were updated are written.
+    // Runs are sorted by pass, with the runs of each in [gpuPassRuns[pass], gpuPassRuns[pass + 1]).
+    std::vector<GpuObject> gpuObjects;
+    std::vector<GpuEntity> gpuEntities;
+    std::vector<GpuRun> gpuRuns;
+    std::array<uint32_t, static_cast<size_t>(NtRenderPass::Count) + 1> gpuPassRuns{};
+    std::vector<NtEntity> cpuDrawnEntities;     // Animated and transparent, culled and sorted on the CPU
+    std::vector<NtEntity> pendingEntities;      // Not resident or without a world matrix yet
+    bool bGpuSceneValid = false;
+    size_t gpuMemberCount = 0;
+    size_t gpuTransformCount = 0;
+    uint32_t gpuRangeVersion = 0;
 };
 
 }
@@ -0,0 +1,133 @@
+#include "nt_scheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace nt
+{
+
+void NtSystemScheduler::Add(std::string name, NtSystemAccess access, std::function<void()> func) {
+    tasks.push_back({std::move(name), access, std::move(func), {}, {}});
+}
+
+bool NtSystemScheduler::Conflicts(const NtSystemAccess& a, const NtSystemAccess& b) {
+    return (a.writes & (b.reads | b.writes)).any() || (b.writes & a.reads).any();
+}
+
+void NtSystemScheduler::Run() {
+    using Clock = std::chrono::steady_clock;
+
+    const uint32_t taskCount = static_cast<uint32_t>(tasks.size());
+
+    // Conflicting systems keep their queue order, edges always point forward
+    for (uint32_t later = 0; later < taskCount; ++later) {
+        for (uint32_t earlier = 0; earlier < later; ++earlier) {
+            if (Conflicts(tasks[earlier].access, tasks[later].access)) {
+                tasks[earlier].successors.push_back(later);
+                tasks[later].predecessors.push_back(earlier);
+            }
+        }
+    }
+
+    std::vector<std::atomic<uint32_t>> pending(taskCount);
+    for (uint32_t i = 0; i < taskCount; ++i) {
+        pending[i].store(static_cast<uint32_t>(tasks[i].predecessors.size()), std::memory_order_relaxed);
+    }
+
+    std::vector<Clock::time_point> startTimes(taskCount);
+    std::vector<Clock::time_point> endTimes(taskCount);
+
+    // Main-thread systems are handed back to the calling thread through this queue
+    std::mutex mainMutex;
+    std::condition_variable mainWake;
+    std::deque<uint32_t> mainReady;
+    uint32_t completed = 0;
+
+    const auto runStart = Clock::now();
+
+    std::function<void(uint32_t)> dispatch;
+    auto execute = [&](uint32_t index) {
+        startTimes[index] = Clock::now();
+        tasks[index].func();
+        endTimes[index] = Clock::now();
+
+        for (uint32_t successor : tasks[index].successors) {
+            if (pending[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                dispatch(successor);
+            }
+        }
+
+        // Notify under the lock, Run() may return as soon as it sees the last completion
+        std::lock_guard<std::mutex> lock(mainMutex);
+        ++completed;
+        mainWake.notify_one();
+    };
+
+    dispatch = [&](uint32_t index) {
+        if (tasks[index].access.bMainThread) {
+            std::lock_guard<std::mutex> lock(mainMutex);
+            mainReady.push_back(index);
+            mainWake.notify_one();
+        }
+        else {
+            jobSystem.Submit([&execute, index] { execute(index); });
+        }
+    };
+
+    for (uint32_t i = 0; i < taskCount; ++i) {
+        if (tasks[i].predecessors.empty()) dispatch(i);
+    }
+
+    // Run main-thread systems and help the pool until everything has finished
+    for (;;) {
+        std::unique_lock<std::mutex> lock(mainMutex);
+        if (completed == taskCount) break;
+
+        if (!mainReady.empty()) {
+            const uint32_t index = mainReady.front();
+            mainReady.pop_front();
+            lock.unlock();
+            execute(index);
+            continue;
+        }
+
+        lock.unlock();
+        if (jobSystem.TryRunPendingJob()) continue;
+
+        lock.lock();
+        mainWake.wait(lock, [&] { return completed == taskCount || !mainReady.empty(); });
+    }
+
+    const auto runEnd = Clock::now();
+
+    // Tasks are already in topological order, so one forward pass finds the longest chain
+    auto toMs = [](Clock::duration duration) {
+        return std::chrono::duration<float, std::milli>(duration).count();
+    };
+
+    stats = {};
+    stats.wallMs = toMs(runEnd - runStart);
+
+    std::vector<float> chainEndMs(taskCount, 0.0f);
+    for (uint32_t i = 0; i < taskCount; ++i) {
+        const float durationMs = toMs(endTimes[i] - startTimes[i]);
+
+        float chainStartMs = 0.0f;
+        for (uint32_t predecessor : tasks[i].predecessors) {
+            chainStartMs = std::max(chainStartMs, chainEndMs[predecessor]);
+        }
+        chainEndMs[i] = chainStartMs + durationMs;
+
+        stats.systems.push_back({tasks[i].name, toMs(startTimes[i] - runStart), durationMs, tasks[i].access.bMainThread});
+        stats.serialMs += durationMs;
+        stats.criticalPathMs = std::max(stats.criticalPathMs, chainEndMs[i]);
+    }
+
+    tasks.clear();
+}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "nt_ecs.hpp"
+#include "nt_job_system.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace nt
+{
+
+// Components a system touches. Two systems conflict when one of them
+// writes a component the other reads or writes.
+struct NtSystemAccess
+{
+    NtSignature reads;
+    NtSignature writes;
+
+    // Pinned to the thread that calls Run(), e.g. for GLFW input
+    bool bMainThread = false;
+};
+
+struct NtSystemTiming
+{
+    std::string name;
+    float startMs = 0.0f;   // Relative to the start of Run()
+    float durationMs = 0.0f;
+    bool bMainThread = false;
+};
+
+struct NtSchedulerStats
+{
+    std::vector<NtSystemTiming> systems;
+    float wallMs = 0.0f;          // Run() from start to finish
+    float serialMs = 0.0f;        // Sum of all system durations
+    float criticalPathMs = 0.0f;  // Longest chain of dependent systems
+};
+
+//==============================
+// SYSTEM SCHEDULER
+//==============================
+// Systems are queued each frame with their access sets. Run() orders every
+// conflicting pair by queue order, which gives a dependency DAG, and then
+// dispatches each system onto the job system as soon as its dependencies finish.
+class NtSystemScheduler
+{
+public:
+    explicit NtSystemScheduler(NtJobSystem& jobSystem) : jobSystem(jobSystem) {}
+
+    NtSystemScheduler(const NtSystemScheduler&) = delete;
+    NtSystemScheduler& operator=(const NtSystemScheduler&) = delete;
+
+    void Add(std::string name, NtSystemAccess access, std::function<void()> func);
+
+    // Executes everything queued since the last Run() and blocks until it is done
+    void Run();
+
+    const NtSchedulerStats& GetStats() const { return stats; }
+
+private:
+    struct Task {
+        std::string name;
+        NtSystemAccess access;
+        std::function<void()> func;
+        std::vector<uint32_t> predecessors;
+        std::vector<uint32_t> successors;
+    };
+
+    static bool Conflicts(const NtSystemAccess& a, const NtSystemAccess& b);
+
+    NtJobSystem& jobSystem;
+    std::vector<Task> tasks;
+    NtSchedulerStats stats;
+};
+
+}
@@ -18,7 +18,7 @@ NtShadowMap::~NtShadowMap() {
     vkDestroySampler(ntDevice.device(), shadowDebugSampler, nullptr);
     vkDestroyImageView(ntDevice.device(), shadowImageView, nullptr);
     vkDestroyImage(ntDevice.device(), shadowImage, nullptr);
-    vkFreeMemory(ntDevice.device(), shadowImageMemory, nullptr);
+    ntDevice.freeMemory(shadowImageMemory);
 }
 
 void NtShadowMap::createShadowImage() {
@@ -45,16 +45,11 @@ void NtShadowMap::createShadowImage() {
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(ntDevice.device(), shadowImage, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = ntDevice.findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    // Render target, gets its own allocation
+    shadowImageMemory = ntDevice.getMemoryAllocator().allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        true, NtMemoryUsage::Dedicated);
 
-    if (vkAllocateMemory(ntDevice.device(), &allocInfo, nullptr, &shadowImageMemory) != VK_SUCCESS) {
-      throw std::runtime_error("[ERROR] failed to allocate shadow image memory");
-    }
-
-    vkBindImageMemory(ntDevice.device(), shadowImage, shadowImageMemory, 0);
+    vkBindImageMemory(ntDevice.device(), shadowImage, shadowImageMemory.memory, shadowImageMemory.offset);
 }
 
 void NtShadowMap::createShadowImageView() {
@@ -25,7 +25,7 @@ private:
     uint32_t height;
 
     VkImage shadowImage;
-    VkDeviceMemory shadowImageMemory;
+    NtAllocation shadowImageMemory{};
     VkImageView shadowImageView;
     VkSampler shadowSampler;
     VkSampler shadowDebugSampler;
@@ -0,0 +1,163 @@
+#include "nt_skinning.hpp"
+#include "nt_animator.hpp"
+#include "nt_log.hpp"
+#include "nt_model.hpp"
+#include "nt_pipeline.hpp"
+#include "nt_swap_chain.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace nt
+{
+
+namespace {
+
+constexpr uint32_t WORKGROUP_SIZE = 64;     // local_size_x in skin.comp
+
+}
+
+NtSkinningPass::NtSkinningPass(NtDevice& device, NtGeometryArena& arena, VkDescriptorSetLayout poseLayout)
+    : ntDevice{device}, geometryArena{arena} {
+    sourceLayout = NtDescriptorSetLayout::Builder(ntDevice)
+        .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Arena block vertices
+        .build();
+
+    pool = NtDescriptorPool::Builder(ntDevice)
+        .setMaxSets(NtSwapChain::MAX_FRAMES_IN_FLIGHT * MAX_SOURCE_BLOCKS)
+        .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NtSwapChain::MAX_FRAMES_IN_FLIGHT * MAX_SOURCE_BLOCKS)
+        .build();
+
+    sourceSets.resize(NtSwapChain::MAX_FRAMES_IN_FLIGHT);
+    createPipeline(poseLayout);
+}
+
+NtSkinningPass::~NtSkinningPass() {
+    vkDestroyPipeline(ntDevice.device(), pipeline, nullptr);
+    vkDestroyPipelineLayout(ntDevice.device(), pipelineLayout, nullptr);
+}
+
+void NtSkinningPass::createPipeline(VkDescriptorSetLayout poseLayout) {
+    VkDescriptorSetLayout layouts[] = {sourceLayout->getDescriptorSetLayout(), poseLayout};
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 2;
+    pipelineLayoutInfo.pSetLayouts = layouts;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(ntDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create skinning pipeline layout!");
+    }
+
+    auto code = NtPipeline::readFile("shaders/skin.comp.spv");
+
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = code.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(ntDevice.device(), &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create skinning shader module!");
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pipelineLayout;
+
+    const VkResult result = vkCreateComputePipelines(ntDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+    vkDestroyShaderModule(ntDevice.device(), shaderModule, nullptr);
+
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create skinning pipeline!");
+    }
+    NT_LOG_VERBOSE(LogRendering, "GPU skinning pipeline created");
+}
+
+VkDescriptorSet NtSkinningPass::getSourceSet(int frameIndex, uint32_t block) {
+    auto& sets = sourceSets[frameIndex];
+    if (block >= sets.size()) {
+        if (block >= MAX_SOURCE_BLOCKS) {
+            throw std::runtime_error("Too many geometry blocks hold skinned vertices!");
+        }
+        sets.resize(block + 1, VK_NULL_HANDLE);
+    }
+    if (block >= sourceWritten.size()) sourceWritten.resize(block + 1, 0);
+
+    // The frame's previous submission has finished, so its sets can be written again
+    if (!sourceWritten[block]) {
+        auto vertexInfo = geometryArena.getVertexBufferInfo(block);
+        NtDescriptorWriter writer(*sourceLayout, *pool);
+        writer.writeBuffer(0, &vertexInfo);
+        if (sets[block] == VK_NULL_HANDLE) {
+            if (!writer.build(sets[block])) {
+                throw std::runtime_error("Failed to allocate skinning descriptor set!");
+            }
+        } else {
+            writer.overwrite(sets[block]);
+        }
+        sourceWritten[block] = 1;
+    }
+    return sets[block];
+}
+
+void NtSkinningPass::dispatch(VkCommandBuffer commandBuffer, int frameIndex, const std::vector<NtSkinningJob>& jobs) {
+    skinnedVertexCount = 0;
+    if (jobs.empty()) return;
+
+    std::fill(sourceWritten.begin(), sourceWritten.end(), 0);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+    uint32_t boundBlock = UINT32_MAX;
+    for (const auto& job : jobs) {
+        assert(job.pose->isCreatedFor(*job.model) && job.pose->hasSkinnedVertices() && "Pose not created for the model");
+
+        const VkDescriptorSet poseSet = job.pose->getDescriptorSet();
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout,
+            1, 1, &poseSet, 0, nullptr);
+
+        for (uint32_t meshIndex = 0; meshIndex < job.model->getMeshCount(); ++meshIndex) {
+            const auto& geometry = job.model->getGeometry(meshIndex);
+            if (geometry.vertexCount == 0) continue;
+
+            // Meshes of one model mostly share a block
+            if (geometry.block != boundBlock) {
+                const VkDescriptorSet sourceSet = getSourceSet(frameIndex, geometry.block);
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout,
+                    0, 1, &sourceSet, 0, nullptr);
+                boundBlock = geometry.block;
+            }
+
+            const PushConstants push{geometry.vertexOffset, job.pose->getSkinnedVertex(frameIndex, meshIndex),
+                                     geometry.vertexCount};
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &push);
+            vkCmdDispatch(commandBuffer, (geometry.vertexCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+            skinnedVertexCount += geometry.vertexCount;
+        }
+    }
+
+    // Skinned vertices are read as vertex attributes by both passes
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "nt_descriptors.hpp"
+#include "nt_device.hpp"
+#include "nt_geometry_arena.hpp"
+#include "vulkan/vulkan_core.h"
+
+#include <memory>
+#include <vector>
+
+namespace nt
+{
+
+class NtModel;
+class NtSkeletonPose;
+
+//==============================
+// GPU SKINNING
+//==============================
+// Skins every animated instance once per frame, before the shadow pass. A
+// compute pass reads each mesh's packed NtModel::SkinnedVertex straight from
+// the geometry arena, blends it by the pose's joint matrices and writes an
+// NtModel::StaticVertex into the pose's output for the frame. Shadow and main
+// passes then draw that output with the static pipelines, so an instance costs
+// one skinning however many passes draw it. Joint counts are only bounded by
+// the 16-bit joint indices.
+
+// One animated instance to skin this frame, the pose must be created for the model
+struct NtSkinningJob {
+    const NtModel* model;
+    const NtSkeletonPose* pose;
+};
+
+class NtSkinningPass
+{
+public:
+    // Arena blocks skinned vertices can come from, per frame in flight
+    static constexpr uint32_t MAX_SOURCE_BLOCKS = 16;
+
+    // poseLayout is the layout of NtSkeletonPose::getDescriptorSet()
+    NtSkinningPass(NtDevice& device, NtGeometryArena& arena, VkDescriptorSetLayout poseLayout);
+    ~NtSkinningPass();
+
+    NtSkinningPass(const NtSkinningPass&) = delete;
+    NtSkinningPass& operator=(const NtSkinningPass&) = delete;
+
+    // Records a dispatch per mesh and the barrier that makes the vertices visible to vertex
+    // input. Must be outside of rendering, before the shadow pass.
+    void dispatch(VkCommandBuffer commandBuffer, int frameIndex, const std::vector<NtSkinningJob>& jobs);
+
+    // Vertices skinned by the last dispatch
+    uint32_t getSkinnedVertexCount() const { return skinnedVertexCount; }
+
+private:
+    // Mirrored in skin.comp
+    struct PushConstants {
+        uint32_t sourceVertex;
+        uint32_t targetVertex;
+        uint32_t vertexCount;
+    };
+
+    void createPipeline(VkDescriptorSetLayout poseLayout);
+    VkDescriptorSet getSourceSet(int frameIndex, uint32_t block);
+
+    NtDevice& ntDevice;
+    NtGeometryArena& geometryArena;
+
+    std::unique_ptr<NtDescriptorSetLayout> sourceLayout;
+    std::unique_ptr<NtDescriptorPool> pool;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+
+    // Per frame in flight and arena block. Written again on every dispatch that uses them,
+    // since defragmenting the arena replaces its buffers.
+    std::vector<std::vector<VkDescriptorSet>> sourceSets;
+    std::vector<uint8_t> sourceWritten;
+    uint32_t skinnedVertexCount = 0;
+};
+
+}
@@ -45,11 +45,11 @@ NtSwapChain::~NtSwapChain() {
 
   vkDestroyImageView(device.device(), colorImageView, nullptr);
   vkDestroyImage(device.device(), colorImage, nullptr);
-  vkFreeMemory(device.device(), colorImageMemory, nullptr);
+  device.freeMemory(colorImageMemory);
 
     vkDestroyImageView(device.device(), depthImageView, nullptr);
     vkDestroyImage(device.device(), depthImage, nullptr);
-    vkFreeMemory(device.device(), depthImageMemory, nullptr);
+    device.freeMemory(depthImageMemory);
 
   // cleanup synchronization objects
   for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
@@ -230,7 +230,8 @@ void NtSwapChain::createColorResources() {
         imageInfo,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         colorImage,
-        colorImageMemory);
+        colorImageMemory,
+        NtMemoryUsage::Dedicated);
 
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -273,7 +274,8 @@ void NtSwapChain::createDepthResources() {
         imageInfo,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         depthImage,
-        depthImageMemory);
+        depthImageMemory,
+        NtMemoryUsage::Dedicated);
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     viewInfo.image = depthImage;
@@ -70,11 +70,11 @@ class NtSwapChain {
   VkExtent2D swapChainExtent;
 
   VkImage colorImage;
-  VkDeviceMemory colorImageMemory;
+  NtAllocation colorImageMemory{};
   VkImageView colorImageView;
 
   VkImage depthImage;
-  VkDeviceMemory depthImageMemory;
+  NtAllocation depthImageMemory{};
   VkImageView depthImageView;
 
   std::vector<VkImage> swapChainImages;
@@ -0,0 +1,184 @@
+#include "nt_transform_batch.hpp"
+
+#include <Jolt/Jolt.h>
+#include <Jolt/Math/Mat44.h>
+#include <Jolt/Math/Vec4.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace nt
+{
+
+namespace {
+
+using JPH::Float4;
+using JPH::Mat44;
+using JPH::Vec4;
+
+constexpr size_t LANES = 4;
+constexpr size_t MATRIX_FLOATS = 16;
+
+Vec4 Load(const float* values) {
+    return Vec4::sLoadFloat4(reinterpret_cast<const Float4*>(values));
+}
+
+void Store(const Vec4& value, float* values) {
+    value.StoreFloat4(reinterpret_cast<Float4*>(values));
+}
+
+// Each argument holds one column of four matrices, with element k of the
+// column in Vec4 k. Transposing gives one column per matrix, which are then
+// written out a whole matrix at a time.
+void StoreMatrices(const Vec4 (&columns)[4][4], float* matrices) {
+    const Mat44 c0 = Mat44(columns[0][0], columns[0][1], columns[0][2], columns[0][3]).Transposed();
+    const Mat44 c1 = Mat44(columns[1][0], columns[1][1], columns[1][2], columns[1][3]).Transposed();
+    const Mat44 c2 = Mat44(columns[2][0], columns[2][1], columns[2][2], columns[2][3]).Transposed();
+    const Mat44 c3 = Mat44(columns[3][0], columns[3][1], columns[3][2], columns[3][3]).Transposed();
+    for (JPH::uint lane = 0; lane < LANES; ++lane) {
+        float* matrix = matrices + lane * MATRIX_FLOATS;
+        Store(c0.GetColumn4(lane), matrix);
+        Store(c1.GetColumn4(lane), matrix + 4);
+        Store(c2.GetColumn4(lane), matrix + 8);
+        Store(c3.GetColumn4(lane), matrix + 12);
+    }
+}
+
+void EulerToQuaternionFour(const float* eulerX, const float* eulerY, const float* eulerZ,
+    float* quatX, float* quatY, float* quatZ, float* quatW) {
+    const Vec4 half = Vec4::sReplicate(0.5f);
+
+    Vec4 sinX, cosX, sinY, cosY, sinZ, cosZ;
+    (Load(eulerX) * half).SinCos(sinX, cosX);
+    (Load(eulerY) * half).SinCos(sinY, cosY);
+    (Load(eulerZ) * half).SinCos(sinZ, cosZ);
+
+    // qY * qX, then * qZ - the same order cTransform::mat4() applies its rotations
+    const Vec4 px = cosY * sinX;
+    const Vec4 py = sinY * cosX;
+    const Vec4 pz = -(sinY * sinX);
+    const Vec4 pw = cosY * cosX;
+
+    Store(px * cosZ + py * sinZ, quatX);
+    Store(py * cosZ - px * sinZ, quatY);
+    Store(pw * sinZ + pz * cosZ, quatZ);
+    Store(pw * cosZ - pz * sinZ, quatW);
+}
+
+void ComputeMatricesFour(const NtTransformStreams& streams, size_t offset, float* outModel, float* outNormal) {
+    const Vec4 zero = Vec4::sZero();
+    const Vec4 one = Vec4::sReplicate(1.0f);
+
+    const Vec4 x = Load(streams.rotation[0] + offset);
+    const Vec4 y = Load(streams.rotation[1] + offset);
+    const Vec4 z = Load(streams.rotation[2] + offset);
+    const Vec4 w = Load(streams.rotation[3] + offset);
+
+    const Vec4 x2 = x + x, y2 = y + y, z2 = z + z;
+    const Vec4 xx = x * x2, yy = y * y2, zz = z * z2;
+    const Vec4 xy = x * y2, xz = x * z2, yz = y * z2;
+    const Vec4 wx = w * x2, wy = w * y2, wz = w * z2;
+
+    // Rotation columns
+    const Vec4 r00 = one - (yy + zz), r01 = xy + wz, r02 = xz - wy;
+    const Vec4 r10 = xy - wz, r11 = one - (xx + zz), r12 = yz + wx;
+    const Vec4 r20 = xz + wy, r21 = yz - wx, r22 = one - (xx + yy);
+
+    const Vec4 sx = Load(streams.scale[0] + offset);
+    const Vec4 sy = Load(streams.scale[1] + offset);
+    const Vec4 sz = Load(streams.scale[2] + offset);
+
+    const Vec4 model[4][4] = {
+        {r00 * sx, r01 * sx, r02 * sx, zero},
+        {r10 * sy, r11 * sy, r12 * sy, zero},
+        {r20 * sz, r21 * sz, r22 * sz, zero},
+        {Load(streams.translation[0] + offset), Load(streams.translation[1] + offset), Load(streams.translation[2] + offset), one}
+    };
+    StoreMatrices(model, outModel);
+
+    if (outNormal) {
+        const Vec4 ix = one / sx, iy = one / sy, iz = one / sz;
+        const Vec4 normal[4][4] = {
+            {r00 * ix, r01 * ix, r02 * ix, zero},
+            {r10 * iy, r11 * iy, r12 * iy, zero},
+            {r20 * iz, r21 * iz, r22 * iz, zero},
+            {zero, zero, zero, one}
+        };
+        StoreMatrices(normal, outNormal);
+    }
+}
+
+// Copies the last partial group into lane-sized buffers. Unused lanes get an
+// identity transform so they stay finite.
+struct TailStreams
+{
+    alignas(16) float values[10][LANES];
+
+    TailStreams(const float* const* sources, size_t sourceCount, size_t offset, size_t count) {
+        for (size_t stream = 0; stream < sourceCount; ++stream) {
+            std::fill(values[stream], values[stream] + LANES, 0.0f);
+            std::copy(sources[stream] + offset, sources[stream] + offset + count, values[stream]);
+        }
+    }
+};
+
+}
+
+void EulerToQuaternionBatch(const float* eulerX, const float* eulerY, const float* eulerZ,
+    float* quatX, float* quatY, float* quatZ, float* quatW, size_t count) {
+    const size_t fullCount = count - count % LANES;
+    for (size_t i = 0; i < fullCount; i += LANES) {
+        EulerToQuaternionFour(eulerX + i, eulerY + i, eulerZ + i, quatX + i, quatY + i, quatZ + i, quatW + i);
+    }
+
+    if (const size_t remaining = count - fullCount) {
+        const float* sources[3] = {eulerX, eulerY, eulerZ};
+        TailStreams tail(sources, 3, fullCount, remaining);
+
+        alignas(16) float quat[4][LANES];
+        EulerToQuaternionFour(tail.values[0], tail.values[1], tail.values[2], quat[0], quat[1], quat[2], quat[3]);
+
+        float* targets[4] = {quatX, quatY, quatZ, quatW};
+        for (size_t component = 0; component < 4; ++component) {
+            std::copy(quat[component], quat[component] + remaining, targets[component] + fullCount);
+        }
+    }
+}
+
+void ComputeTransformMatricesBatch(const NtTransformStreams& streams, float* outModel, float* outNormal, size_t count) {
+    const size_t fullCount = count - count % LANES;
+    for (size_t i = 0; i < fullCount; i += LANES) {
+        ComputeMatricesFour(streams, i, outModel + i * MATRIX_FLOATS, outNormal ? outNormal + i * MATRIX_FLOATS : nullptr);
+    }
+
+    if (const size_t remaining = count - fullCount) {
+        const float* sources[10] = {
+            streams.translation[0], streams.translation[1], streams.translation[2],
+            streams.rotation[0], streams.rotation[1], streams.rotation[2], streams.rotation[3],
+            streams.scale[0], streams.scale[1], streams.scale[2]
+        };
+        TailStreams tail(sources, 10, fullCount, remaining);
+
+        // Identity rotation and unit scale in the padding lanes
+        for (size_t stream = 6; stream < 10; ++stream) {
+            std::fill(tail.values[stream] + remaining, tail.values[stream] + LANES, 1.0f);
+        }
+
+        const NtTransformStreams tailStreams{
+            {tail.values[0], tail.values[1], tail.values[2]},
+            {tail.values[3], tail.values[4], tail.values[5], tail.values[6]},
+            {tail.values[7], tail.values[8], tail.values[9]}
+        };
+
+        alignas(16) float model[LANES * MATRIX_FLOATS];
+        alignas(16) float normal[LANES * MATRIX_FLOATS];
+        ComputeMatricesFour(tailStreams, 0, model, outNormal ? normal : nullptr);
+
+        std::memcpy(outModel + fullCount * MATRIX_FLOATS, model, remaining * MATRIX_FLOATS * sizeof(float));
+        if (outNormal) {
+            std::memcpy(outNormal + fullCount * MATRIX_FLOATS, normal, remaining * MATRIX_FLOATS * sizeof(float));
+        }
+    }
+}
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+namespace nt
+{
+
+//==============================
+// BATCH TRANSFORM KERNEL
+//==============================
+// Builds model and normal matrices from structure-of-arrays transforms, four
+// entities per step using Jolt's Vec4 (SSE on x86, NEON on ARM). Rotations are
+// quaternions, so building the matrices needs no trig; Euler angles can be
+// converted in bulk first. Matrices are written as 16 floats in column-major
+// order, the layout of glm::mat4.
+
+struct NtTransformStreams
+{
+    const float* translation[3];
+    const float* rotation[4];   // Unit quaternion x, y, z, w
+    const float* scale[3];
+};
+
+// Euler angles in the cTransform::rotation convention (Tait-Bryan Y, X, Z) to quaternions
+void EulerToQuaternionBatch(const float* eulerX, const float* eulerY, const float* eulerZ,
+    float* quatX, float* quatY, float* quatZ, float* quatW, size_t count);
+
+// outNormal may be null. The normal matrix is rotation * inverse scale, the
+// inverse transpose of the model matrix's upper 3x3, widened to 4x4.
+void ComputeTransformMatricesBatch(const NtTransformStreams& streams, float* outModel, float* outNormal, size_t count);
+
+}
@@ -0,0 +1,215 @@
+#include "nt_transform_system.hpp"
+#include "nt_components.hpp"
+#include "nt_log.hpp"
+#include "nt_transform_batch.hpp"
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <utility>
+
+namespace nt
+{
+
+void TransformSystem::update() {
+    const uint32_t since = std::exchange(lastRunTick, nexus->ClaimChangeTick());
+
+    // Any change to membership or parent links re-sorts the hierarchy, which marks everything dirty
+    size_t currentParentCount = 0;
+    bool bStructureChanged = false;
+    nexus->View<const cParent>().Each([&](const cParent&) { ++currentParentCount; });
+    nexus->View<const cParent>().Changed<cParent>(since).Each([&](const cParent&) { bStructureChanged = true; });
+    nexus->View<const cTransform>().Added<cTransform>(since).Each([&](const cTransform&) { bStructureChanged = true; });
+
+    if (bStructureChanged || currentParentCount != parentCount || entities.Size() != order.size()) {
+        parentCount = currentParentCount;
+        rebuildHierarchy();
+    }
+    else {
+        std::fill(dirty.begin(), dirty.end(), 0);
+        nexus->View<const cTransform>().Changed<cTransform>(since).Each([&](NtEntity entity, const cTransform&) {
+            dirty[slotOf(entity)] = 1;
+        });
+    }
+
+    // Parents come first, so a dirty parent has already been marked when its children are reached
+    dirtySlots.clear();
+    for (uint32_t slot = 0; slot < order.size(); ++slot) {
+        const uint32_t parent = parentSlots[slot];
+        if (parent != NO_SLOT && dirty[parent]) {
+            dirty[slot] = 1;
+        }
+        if (dirty[slot]) dirtySlots.push_back(slot);
+    }
+
+    updatedCount = static_cast<uint32_t>(dirtySlots.size());
+    if (dirtySlots.empty()) return;
+
+    computeLocalMatrices();
+
+    // Dirty slots are in hierarchy order too, so parent world matrices are already final
+    for (size_t row = 0; row < dirtySlots.size(); ++row) {
+        const uint32_t slot = dirtySlots[row];
+        const uint32_t parent = parentSlots[slot];
+        if (parent == NO_SLOT) {
+            worldMatrices[slot] = localMatrices[row];
+            normalMatrices[slot] = localNormals[row];
+        }
+        else {
+            worldMatrices[slot] = worldMatrices[parent] * localMatrices[row];
+            normalMatrices[slot] = glm::mat4(glm::inverseTranspose(glm::mat3(worldMatrices[slot])));
+        }
+    }
+}
+
+void TransformSystem::computeLocalMatrices() {
+    static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "Batch kernel writes tightly packed 4x4 float matrices");
+
+    const size_t count = dirtySlots.size();
+    for (auto& stream : translationStreams) stream.resize(count);
+    for (auto& stream : eulerStreams) stream.resize(count);
+    for (auto& stream : rotationStreams) stream.resize(count);
+    for (auto& stream : scaleStreams) stream.resize(count);
+    localMatrices.resize(count);
+    localNormals.resize(count);
+    orientationRows.clear();
+
+    // Gather the dirty transforms into the kernel's structure-of-arrays layout
+    for (size_t row = 0; row < count; ++row) {
+        const cTransform& transform = nexus->GetComponent<const cTransform>(order[dirtySlots[row]]);
+        for (int axis = 0; axis < 3; ++axis) {
+            translationStreams[axis][row] = transform.translation[axis];
+            eulerStreams[axis][row] = transform.rotation[axis];
+            scaleStreams[axis][row] = transform.scale[axis];
+        }
+        if (transform.bUseOrientation) {
+            orientationRows.emplace_back(static_cast<uint32_t>(row), transform.orientation);
+        }
+    }
+
+    EulerToQuaternionBatch(eulerStreams[0].data(), eulerStreams[1].data(), eulerStreams[2].data(),
+        rotationStreams[0].data(), rotationStreams[1].data(), rotationStreams[2].data(), rotationStreams[3].data(), count);
+
+    // Transforms that already store a quaternion skip the conversion result
+    for (auto const& [row, orientation] : orientationRows) {
+        rotationStreams[0][row] = orientation.x;
+        rotationStreams[1][row] = orientation.y;
+        rotationStreams[2][row] = orientation.z;
+        rotationStreams[3][row] = orientation.w;
+    }
+
+    const NtTransformStreams streams{
+        {translationStreams[0].data(), translationStreams[1].data(), translationStreams[2].data()},
+        {rotationStreams[0].data(), rotationStreams[1].data(), rotationStreams[2].data(), rotationStreams[3].data()},
+        {scaleStreams[0].data(), scaleStreams[1].data(), scaleStreams[2].data()}
+    };
+    ComputeTransformMatricesBatch(streams, glm::value_ptr(localMatrices[0]), glm::value_ptr(localNormals[0]), count);
+}
+
+const glm::mat4* TransformSystem::getWorldMatrix(NtEntity entity) const {
+    const uint32_t slot = slotOf(entity);
+    return slot != NO_SLOT ? &worldMatrices[slot] : nullptr;
+}
+
+const glm::mat4* TransformSystem::getNormalMatrix(NtEntity entity) const {
+    const uint32_t slot = slotOf(entity);
+    return slot != NO_SLOT ? &normalMatrices[slot] : nullptr;
+}
+
+uint32_t TransformSystem::slotOf(NtEntity entity) const {
+    const uint32_t index = EntityIndex(entity);
+    if (index >= slots.size()) return NO_SLOT;
+
+    const uint32_t slot = slots[index];
+    return slot < order.size() && order[slot] == entity ? slot : NO_SLOT;
+}
+
+void TransformSystem::rebuildHierarchy() {
+    const uint32_t count = static_cast<uint32_t>(entities.Size());
+    const NtEntity* members = entities.Entities();
+
+    // Slots temporarily hold positions in the entity set while the links are resolved
+    uint32_t maxIndex = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        maxIndex = std::max(maxIndex, EntityIndex(members[i]));
+    }
+    slots.assign(count ? maxIndex + 1 : 0, NO_SLOT);
+    for (uint32_t i = 0; i < count; ++i) {
+        slots[EntityIndex(members[i])] = i;
+    }
+
+    // Parent links that point at another entity with a transform, the rest are roots
+    std::vector<uint32_t> parentOf(count, NO_SLOT);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!nexus->HasComponent<cParent>(members[i])) continue;
+
+        const NtEntity parent = nexus->GetComponent<const cParent>(members[i]).parent;
+        const uint32_t index = EntityIndex(parent);
+        if (parent == INVALID_ENTITY || index >= slots.size()) continue;
+
+        const uint32_t member = slots[index];
+        if (member != NO_SLOT && members[member] == parent && member != i) {
+            parentOf[i] = member;
+        }
+    }
+
+    // Children grouped per parent
+    std::vector<uint32_t> childStart(count + 1, 0);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (parentOf[i] != NO_SLOT) ++childStart[parentOf[i] + 1];
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        childStart[i + 1] += childStart[i];
+    }
+    std::vector<uint32_t> children(childStart[count]);
+    std::vector<uint32_t> cursor(childStart.begin(), childStart.end() - 1);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (parentOf[i] != NO_SLOT) children[cursor[parentOf[i]]++] = i;
+    }
+
+    order.clear();
+    parentSlots.clear();
+
+    std::vector<uint32_t> slotOfMember(count, NO_SLOT);
+    std::vector<uint32_t> stack;
+    auto visit = [&](uint32_t root) {
+        stack.push_back(root);
+        while (!stack.empty()) {
+            const uint32_t member = stack.back();
+            stack.pop_back();
+            if (slotOfMember[member] != NO_SLOT) continue;
+
+            slotOfMember[member] = static_cast<uint32_t>(order.size());
+            order.push_back(members[member]);
+            parentSlots.push_back(member == root ? NO_SLOT : slotOfMember[parentOf[member]]);
+
+            // Reversed so children keep their relative order
+            for (uint32_t child = childStart[member + 1]; child-- > childStart[member];) {
+                stack.push_back(children[child]);
+            }
+        }
+    };
+
+    for (uint32_t i = 0; i < count; ++i) {
+        if (parentOf[i] == NO_SLOT) visit(i);
+    }
+
+    // Entities on a parent cycle are unreachable from any root, cut the cycle where we find it
+    if (order.size() != count) {
+        NT_LOG_WARN(LogCore, "Transform hierarchy has {} entities in parent cycles", count - order.size());
+        for (uint32_t i = 0; i < count; ++i) {
+            if (slotOfMember[i] == NO_SLOT) visit(i);
+        }
+    }
+
+    for (uint32_t slot = 0; slot < count; ++slot) {
+        slots[EntityIndex(order[slot])] = slot;
+    }
+
+    worldMatrices.resize(count);
+    normalMatrices.resize(count);
+    dirty.assign(count, 1);
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "nt_ecs.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <utility>
+#include <vector>
+
+namespace nt
+{
+
+//==============================
+// TRANSFORM SYSTEM
+//==============================
+// Resolves cTransform + cParent into world and normal matrices. Entities are
+// kept in one flat array sorted depth-first, so every parent comes before its
+// children and a single forward pass can propagate dirtiness down subtrees.
+// Only subtrees whose transforms changed since the last update are recomputed,
+// their local matrices four at a time by the batch kernel in nt_transform_batch.
+class TransformSystem : public NtSystem
+{
+public:
+    TransformSystem(NtNexus* nexus_ptr) : nexus(nexus_ptr) {};
+
+    // Must run after the last transform write of the frame and before rendering
+    void update();
+
+    // Cached matrices from the last update, nullptr for entities it has not seen
+    const glm::mat4* getWorldMatrix(NtEntity entity) const;
+    const glm::mat4* getNormalMatrix(NtEntity entity) const;
+
+    // Entities whose matrices were recomputed by the last update
+    uint32_t getUpdatedCount() const { return updatedCount; }
+    template<typename Func>
+    void forEachUpdated(Func&& func) const {
+        for (uint32_t slot : dirtySlots) func(order[slot]);
+    }
+
+private:
+    static constexpr uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+
+    void rebuildHierarchy();
+    void computeLocalMatrices();
+    uint32_t slotOf(NtEntity entity) const;
+
+    NtNexus* nexus;
+
+    // Depth-first order, index-aligned arrays
+    std::vector<NtEntity> order;
+    std::vector<uint32_t> parentSlots;
+    std::vector<glm::mat4> worldMatrices;
+    std::vector<glm::mat4> normalMatrices;
+    std::vector<uint8_t> dirty;
+
+    // Entity index -> slot in the arrays above
+    std::vector<uint32_t> slots;
+
+    // Scratch for the batch kernel, index-aligned with dirtySlots
+    std::vector<uint32_t> dirtySlots;
+    std::vector<float> translationStreams[3];
+    std::vector<float> eulerStreams[3];
+    std::vector<float> rotationStreams[4];
+    std::vector<float> scaleStreams[3];
+    std::vector<std::pair<uint32_t, glm::quat>> orientationRows;
+    std::vector<glm::mat4> localMatrices;
+    std::vector<glm::mat4> localNormals;
+
+    size_t parentCount = 0;
+    uint32_t updatedCount = 0;
+};
+
+}
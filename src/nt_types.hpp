@@ -6,6 +6,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <cstdint>
+
 namespace nt {
 
 enum class CameraProjectionType {
@@ -25,28 +27,46 @@ enum class RenderMode {
   Billboard
 };
 
+// GPU vertex layouts, see NtModel::StaticVertex and NtModel::SkinnedVertex
+enum class NtVertexLayout : uint8_t {
+    Static,
+    Skinned
+};
+
 enum class eLightType : int {
     Point = 0,
     Spot = 1,
     Directional = 2
 };
 
-struct NtPushConstantData {
-    alignas(16) glm::mat4 modelMatrix{1.f};
-    alignas(16) glm::mat4 normalMatrix{1.f};
+// Capacity of the per-frame instance buffer
+#define MAX_INSTANCES 16384
 
-    alignas(8) glm::vec2 uvScale{1.0f, 1.0f};
-    alignas(8) glm::vec2 uvOffset{0.0f, 0.0f};
-    alignas(4) float uvRotation{0.0f};
+// Detail levels per mesh, level 0 is the full mesh
+#define MAX_LODS 4
 
-    alignas(4) int hasNormalTexture{0};
-    alignas(4) int hasMetallicRoughnessTexture{0};
-    alignas(4) float metallicFactor{1.0f};
-    alignas(4) float roughnessFactor{1.0f};
+// Per-instance draw data, read by the shaders from the instance buffer (global set,
+// binding 2) through gl_InstanceIndex. Laid out for std430.
+struct NtInstanceData {
+    glm::mat4 modelMatrix{1.f};
+    glm::mat4 normalMatrix{1.f};
 
-    alignas(4) float billboardSize{1.0f};
-    alignas(4) int isAnimated{0};
+    glm::vec2 uvScale{1.0f, 1.0f};
+    glm::vec2 uvOffset{0.0f, 0.0f};
+    float uvRotation{0.0f};
 
+    float metallicFactor{1.0f};
+    float roughnessFactor{1.0f};
+
+    int isAnimated{0};
+    int hasNormalTexture{0};
+    int hasMetallicRoughnessTexture{0};
+    int padding[2]{};
+};
+static_assert(sizeof(NtInstanceData) == 176, "NtInstanceData must match the std430 InstanceData array stride");
+
+// What is left per draw once instance data moved to the instance buffer
+struct NtPushConstantData {
     alignas(4) float time{0.0f};
     alignas(8) glm::vec2 scrollSpeed{0.0f, 0.0f};
 };
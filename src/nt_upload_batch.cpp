@@ -0,0 +1,383 @@
+#include "nt_upload_batch.hpp"
+#include "nt_log.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace nt
+{
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+//==============================
+// STAGING RING
+//==============================
+
+NtStagingRing::NtStagingRing(NtDevice& device, VkDeviceSize size) : ntDevice{device}, size{size} {
+    ntDevice.createBuffer(
+        size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        buffer,
+        memory);
+}
+
+NtStagingRing::~NtStagingRing() {
+    if (!ranges.empty() && !std::all_of(ranges.begin(), ranges.end(), [](const Range& range) { return range.bReleased; })) {
+        NT_LOG_WARN(LogRendering, "Staging ring destroyed with uploads still in flight");
+    }
+    vkDestroyBuffer(ntDevice.device(), buffer, nullptr);
+    ntDevice.freeMemory(memory);
+}
+
+bool NtStagingRing::allocate(VkDeviceSize requestSize, VkDeviceSize alignment, uint64_t batchId, VkDeviceSize& outOffset) {
+    std::lock_guard<std::mutex> lock{mutex};
+
+    while (!ranges.empty() && ranges.front().bReleased) {
+        ranges.pop_front();
+    }
+    if (ranges.empty()) head = 0;
+
+    if (requestSize == 0 || requestSize > size) return false;
+
+    // Used space runs from the front range to head, wrapping past the end of the buffer
+    const VkDeviceSize tail = ranges.empty() ? 0 : ranges.front().begin;
+    const bool bWrapped = !ranges.empty() && head <= tail;
+
+    VkDeviceSize offset = alignUp(head, alignment);
+    if (bWrapped) {
+        if (offset + requestSize > tail) return false;
+    } else if (offset + requestSize > size) {
+        // No room before the end, start over at the front
+        offset = 0;
+        if (!ranges.empty() && requestSize > tail) return false;
+    }
+
+    ranges.push_back({offset, offset + requestSize, batchId, false});
+    head = offset + requestSize;
+    outOffset = offset;
+    return true;
+}
+
+void NtStagingRing::release(uint64_t batchId) {
+    std::lock_guard<std::mutex> lock{mutex};
+
+    for (auto& range : ranges) {
+        if (range.batchId == batchId) range.bReleased = true;
+    }
+    while (!ranges.empty() && ranges.front().bReleased) {
+        ranges.pop_front();
+    }
+    if (ranges.empty()) head = 0;
+}
+
+VkDeviceSize NtStagingRing::getUsed() const {
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (ranges.empty()) return 0;
+    const VkDeviceSize tail = ranges.front().begin;
+    return head > tail ? head - tail : size - tail + head;
+}
+
+//==============================
+// UPLOAD BATCH
+//==============================
+
+NtUploadBatch::NtUploadBatch(NtDevice& device) : ntDevice{device},
+    stagingRing{device.getStagingRing()},
+    batchId{stagingRing.newBatchId()},
+    bTransferQueue{device.hasTransferQueue()}
+{
+    // Pools of its own, so batches can be recorded on different threads
+    commandBuffer = createCommandBuffer(ntDevice.graphicsQueueFamily(), commandPool);
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(ntDevice.device(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload fence!");
+    }
+
+    if (bTransferQueue) {
+        transferCommandBuffer = createCommandBuffer(ntDevice.transferQueueFamily(), transferPool);
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        if (vkCreateSemaphore(ntDevice.device(), &semaphoreInfo, nullptr, &transferDone) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload semaphore!");
+        }
+    } else {
+        transferCommandBuffer = commandBuffer;
+    }
+}
+
+NtUploadBatch::~NtUploadBatch() {
+    if (bSubmitted) {
+        wait();
+    } else {
+        // Never reached the GPU, nothing reads the staging data
+        retire();
+    }
+
+    vkDestroyFence(ntDevice.device(), fence, nullptr);
+    vkDestroyCommandPool(ntDevice.device(), commandPool, nullptr);
+    if (bTransferQueue) {
+        vkDestroySemaphore(ntDevice.device(), transferDone, nullptr);
+        vkDestroyCommandPool(ntDevice.device(), transferPool, nullptr);
+    }
+}
+
+VkCommandBuffer NtUploadBatch::createCommandBuffer(uint32_t queueFamily, VkCommandPool& outPool) {
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    if (vkCreateCommandPool(ntDevice.device(), &poolInfo, nullptr, &outPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload command pool!");
+    }
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = outPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer newCommandBuffer;
+    if (vkAllocateCommandBuffers(ntDevice.device(), &allocInfo, &newCommandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(newCommandBuffer, &beginInfo);
+    return newCommandBuffer;
+}
+
+NtUploadBatch::Staging NtUploadBatch::stage(const void* data, VkDeviceSize size, VkDeviceSize alignment) {
+    assert(!bSubmitted && "Upload batch was already submitted");
+
+    Staging staging{};
+    if (stagingRing.allocate(size, alignment, batchId, staging.offset)) {
+        staging.buffer = stagingRing.getBuffer();
+        std::memcpy(stagingRing.getMapped() + staging.offset, data, static_cast<size_t>(size));
+    } else {
+        // Ring is full or the data is bigger than it, give this one a buffer of its own
+        Overflow& buffer = overflow.emplace_back();
+        ntDevice.createBuffer(
+            size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            buffer.buffer,
+            buffer.memory);
+        std::memcpy(buffer.memory.mapped, data, static_cast<size_t>(size));
+        staging.buffer = buffer.buffer;
+    }
+
+    stagedBytes += size;
+    return staging;
+}
+
+void NtUploadBatch::copyToBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+    if (size == 0) return;
+
+    const Staging staging = stage(data, size);
+    VkBufferCopy region{staging.offset, dstOffset, size};
+    vkCmdCopyBuffer(transferCommandBuffer, staging.buffer, dstBuffer, 1, &region);
+
+    if (bTransferQueue) {
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = ntDevice.transferQueueFamily();
+        barrier.dstQueueFamilyIndex = ntDevice.graphicsQueueFamily();
+        barrier.buffer = dstBuffer;
+        barrier.offset = dstOffset;
+        barrier.size = size;
+
+        // Release on the transfer queue...
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(transferCommandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            0, nullptr,
+            1, &barrier,
+            0, nullptr);
+
+        // ...and acquire on the graphics queue
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            0, nullptr,
+            1, &barrier,
+            0, nullptr);
+    }
+
+    ++copyCount;
+    ++bufferCopyCount;
+}
+
+void NtUploadBatch::copyToImage(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, const void* data, VkDeviceSize size) {
+    // Offsets must be a multiple of the texel size, and the driver may copy faster from its preferred alignment
+    const VkDeviceSize alignment = std::max<VkDeviceSize>(16, ntDevice.properties.limits.optimalBufferCopyOffsetAlignment);
+    const Staging staging = stage(data, size, alignment);
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(transferCommandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = staging.offset;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {width, height, 1};
+
+    vkCmdCopyBufferToImage(transferCommandBuffer, staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    if (bTransferQueue) {
+        // Same layout on both sides, only the owner changes
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = ntDevice.transferQueueFamily();
+        barrier.dstQueueFamilyIndex = ntDevice.graphicsQueueFamily();
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(transferCommandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier);
+    }
+
+    ++copyCount;
+}
+
+void NtUploadBatch::submit() {
+    assert(!bSubmitted && "Upload batch was already submitted");
+
+    // Images carry their own barriers. On one queue, buffer copies get one for all of them,
+    // with a transfer queue each was acquired already.
+    if (bufferCopyCount > 0 && !bTransferQueue) {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            1, &barrier,
+            0, nullptr,
+            0, nullptr);
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+
+    const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    if (bTransferQueue) {
+        if (vkEndCommandBuffer(transferCommandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record upload command buffer!");
+        }
+
+        submitInfo.pCommandBuffers = &transferCommandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &transferDone;
+        if (vkQueueSubmit(ntDevice.transferQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+
+        submitInfo.signalSemaphoreCount = 0;
+        submitInfo.pSignalSemaphores = nullptr;
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &transferDone;
+        submitInfo.pWaitDstStageMask = &waitStage;
+    }
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record upload command buffer!");
+    }
+
+    submitInfo.pCommandBuffers = &commandBuffer;
+    if (vkQueueSubmit(ntDevice.graphicsQueue(), 1, &submitInfo, fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit upload command buffer!");
+    }
+
+    bSubmitted = true;
+}
+
+bool NtUploadBatch::isComplete() {
+    if (!bSubmitted) return false;
+    if (bRetired) return true;
+
+    if (vkGetFenceStatus(ntDevice.device(), fence) != VK_SUCCESS) return false;
+    retire();
+    return true;
+}
+
+void NtUploadBatch::wait() {
+    assert(bSubmitted && "Upload batch waited on before it was submitted");
+    if (bRetired) return;
+
+    vkWaitForFences(ntDevice.device(), 1, &fence, VK_TRUE, UINT64_MAX);
+    retire();
+}
+
+void NtUploadBatch::retire() {
+    if (bRetired) return;
+
+    stagingRing.release(batchId);
+    for (auto& buffer : overflow) {
+        vkDestroyBuffer(ntDevice.device(), buffer.buffer, nullptr);
+        ntDevice.freeMemory(buffer.memory);
+    }
+    overflow.clear();
+
+    bRetired = true;
+
+    for (auto& callback : completionCallbacks) {
+        callback();
+    }
+    completionCallbacks.clear();
+}
+
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "nt_device.hpp"
+#include "vulkan/vulkan_core.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace nt
+{
+
+//==============================
+// STAGING RING
+//==============================
+// One persistently mapped host-visible buffer that every upload batch stages
+// through, so loading no longer creates and destroys a staging buffer per
+// resource. Space is handed out in order and comes back in order once the batch
+// that used it has finished on the GPU.
+
+class NtStagingRing
+{
+public:
+    static constexpr VkDeviceSize RING_SIZE = 64ull << 20;
+
+    NtStagingRing(NtDevice& device, VkDeviceSize size = RING_SIZE);
+    ~NtStagingRing();
+
+    NtStagingRing(const NtStagingRing&) = delete;
+    NtStagingRing& operator=(const NtStagingRing&) = delete;
+
+    // Thread-safe. False when the ring has no room left, the caller stages elsewhere.
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, uint64_t batchId, VkDeviceSize& outOffset);
+    // Every range the batch allocated can be reused, once its commands have completed
+    void release(uint64_t batchId);
+
+    uint64_t newBatchId() { return ++lastBatchId; }
+
+    VkBuffer getBuffer() const { return buffer; }
+    uint8_t* getMapped() const { return static_cast<uint8_t*>(memory.mapped); }
+    VkDeviceSize getSize() const { return size; }
+    VkDeviceSize getUsed() const;
+
+private:
+    struct Range {
+        VkDeviceSize begin = 0;
+        VkDeviceSize end = 0;
+        uint64_t batchId = 0;
+        bool bReleased = false;
+    };
+
+    NtDevice& ntDevice;
+    VkDeviceSize size;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    NtAllocation memory{};
+
+    mutable std::mutex mutex;
+    std::deque<Range> ranges;   // Oldest first, the front one starts the used part
+    VkDeviceSize head = 0;      // Where the next range goes
+    std::atomic<uint64_t> lastBatchId{0};
+};
+
+//==============================
+// UPLOAD BATCH
+//==============================
+// Records every copy, layout transition and mip blit of an asset into one
+// command buffer, submitted once with a fence instead of a submit and a
+// vkQueueWaitIdle per resource. Data is copied into the staging ring as it is
+// recorded, so callers can free their CPU copies right away. After submit(),
+// poll isComplete() or block in wait(); destroying a batch that is still in
+// flight waits for it.
+//
+// With a dedicated transfer queue the copies get a command buffer of their own
+// on it. Each resource is released to the graphics family after its copy and
+// acquired on the graphics command buffer, which waits on the copies through a
+// semaphore and does what needs a graphics queue (mip blits).
+//
+// A batch can be recorded on any thread, one at a time. Queues are not locked,
+// so submit() belongs on the thread that submits frames.
+
+class NtUploadBatch
+{
+public:
+    struct Staging {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+    };
+
+    explicit NtUploadBatch(NtDevice& device);
+    ~NtUploadBatch();
+
+    NtUploadBatch(const NtUploadBatch&) = delete;
+    NtUploadBatch& operator=(const NtUploadBatch&) = delete;
+
+    // Recording, until submit(). Barriers and blits go straight into the graphics command buffer,
+    // resources written by the copies below are owned by the graphics family there.
+    VkCommandBuffer getCommandBuffer() const { return commandBuffer; }
+    Staging stage(const void* data, VkDeviceSize size, VkDeviceSize alignment = 16);
+    void copyToBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+    // Mip 0 of a new color image. Every mip level is left in TRANSFER_DST_OPTIMAL.
+    void copyToImage(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, const void* data, VkDeviceSize size);
+
+    void submit();
+    bool isSubmitted() const { return bSubmitted; }
+    bool isComplete();
+    void wait();
+
+    // Runs once the batch has completed, or is destroyed without having been submitted,
+    // on the thread that finds out (isComplete(), wait() or the destructor)
+    void onComplete(std::function<void()> callback) { completionCallbacks.push_back(std::move(callback)); }
+
+    uint32_t getCopyCount() const { return copyCount; }
+    VkDeviceSize getStagedBytes() const { return stagedBytes; }
+
+private:
+    void retire();
+    VkCommandBuffer createCommandBuffer(uint32_t queueFamily, VkCommandPool& outPool);
+
+    NtDevice& ntDevice;
+    NtStagingRing& stagingRing;
+    uint64_t batchId;
+
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+
+    // Only with a dedicated transfer queue, the copies go here otherwise
+    bool bTransferQueue = false;
+    VkCommandPool transferPool = VK_NULL_HANDLE;
+    VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+    VkSemaphore transferDone = VK_NULL_HANDLE;
+
+    // Staging for what did not fit in the ring, freed with the batch
+    struct Overflow {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        NtAllocation memory{};
+    };
+    std::vector<Overflow> overflow;
+    std::vector<std::function<void()>> completionCallbacks;
+
+    uint32_t copyCount = 0;
+    uint32_t bufferCopyCount = 0;
+    VkDeviceSize stagedBytes = 0;
+    bool bSubmitted = false;
+    bool bRetired = false;
+};
+
+}
@@ -10,15 +10,6 @@ layout(set = 1, binding = 1) uniform sampler2D normalTexSampler;
 
 layout(location = 0) out vec4 outColor;
 
-layout(push_constant) uniform Push {
-    mat4 modelMatrix;
-    mat4 normalMatrix;
-    int hasNormalTexture;
-    int hasMetallicRoughnessTexture;
-    float metallicFactor;
-    float roughnessFactor;
-} push;
-
 struct PointLight {
     vec4 position;
     vec4 color;
@@ -8,23 +8,28 @@ layout(location = 1) in vec2 fragTexCoord;
 layout(location = 3) in vec3 fragPosWorld;
 layout(location = 4) in vec3 fragNormalWorld;
 layout(location = 5) in vec4 fragTangentWorld;
+layout(location = 6) flat in int fragInstance;
 
 layout(set = 1, binding = 0) uniform sampler2D diffuseTexSampler;
 layout(set = 1, binding = 1) uniform sampler2D normalTexSampler;
 layout(set = 1, binding = 2) uniform sampler2D metallicRoughnessTexSampler;
 
-// Push constant to indicate if normal texture is available
-layout(push_constant) uniform Push {
+struct InstanceData {
     mat4 modelMatrix;
     mat4 normalMatrix;
     vec2 uvScale;
     vec2 uvOffset;
     float uvRotation;
-    int hasNormalTexture;
-    int hasMetallicRoughnessTexture;
     float metallicFactor;
     float roughnessFactor;
-} push;
+    int isAnimated;
+    int hasNormalTexture;
+    int hasMetallicRoughnessTexture;
+};
+
+layout(set = 0, binding = 2) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+} instanceData;
 
 layout(location = 0) out vec4 outColor;
 
@@ -104,6 +109,8 @@ float calculateShadow(vec3 fragPosWorld, vec3 normal) {
 }
 
 void main() {
+    InstanceData instance = instanceData.instances[fragInstance];
+
     float uFogStart = 20.0f;
     float uFogEnd = 70.0f;
     vec3 uFogColor = vec3(0.0f, 0.0f, 0.0f);
@@ -122,7 +129,7 @@ void main() {
     vec3 surfaceNormal = normalize(fragNormalWorld);
 
     // Apply normal mapping if available
-    if (push.hasNormalTexture > 0) {
+    if (instance.hasNormalTexture > 0) {
         vec3 normalMapSample = texture(normalTexSampler, fragTexCoord).rgb;
 
         // Convert from [0,1] to [-1,1] range
@@ -146,10 +153,10 @@ void main() {
     }
 
     // Sample metallic-roughness texture if available
-    float roughness = push.roughnessFactor; // Use material factor as default
-    float metallic = push.metallicFactor; // Use material factor as default
+    float roughness = instance.roughnessFactor; // Use material factor as default
+    float metallic = instance.metallicFactor; // Use material factor as default
 
-    if (push.hasMetallicRoughnessTexture > 0) {
+    if (instance.hasMetallicRoughnessTexture > 0) {
         vec3 metallicRoughnessSample = texture(metallicRoughnessTexSampler, fragTexCoord).rgb;
         roughness *= metallicRoughnessSample.g; // Green channel = roughness * factor
         metallic *= metallicRoughnessSample.b; // Blue channel = metallic * factor
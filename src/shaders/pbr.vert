@@ -1,16 +1,18 @@
 #version 450
 
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 color;
-layout(location = 2) in vec3 normal;
+// Packed vertex, see NtModel::StaticVertex. The model matrix decodes the position,
+// w is the tangent handedness.
+layout(location = 0) in vec4 position;
+layout(location = 2) in vec2 normal;
 layout(location = 3) in vec2 uv;
-layout(location = 4) in vec4 tangent;
+layout(location = 4) in vec2 tangent;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 layout(location = 3) out vec3 fragPosWorld;
 layout(location = 4) out vec3 fragNormalWorld;
 layout(location = 5) out vec4 fragTangentWorld;
+layout(location = 6) flat out int fragInstance;
 
 struct PointLight {
     vec3 position;
@@ -30,18 +32,30 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
     int numLights;
 } ubo;
 
-layout(push_constant) uniform Push {
+struct InstanceData {
     mat4 modelMatrix;
     mat4 normalMatrix;
     vec2 uvScale;
     vec2 uvOffset;
     float uvRotation;
-    int hasNormalTexture;
-    int hasMetallicRoughnessTexture;
-    int debugMode;
     float metallicFactor;
     float roughnessFactor;
-} push;
+    int isAnimated;
+    int hasNormalTexture;
+    int hasMetallicRoughnessTexture;
+};
+
+layout(set = 0, binding = 2) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+} instanceData;
+
+// Inverse of the octahedral mapping the importer packs normals and tangents with
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
 
 vec2 transformUV(vec2 uv, vec2 scale, vec2 offset, float rotation) {
     // Apply scale and offset first
@@ -64,14 +78,18 @@ vec2 transformUV(vec2 uv, vec2 scale, vec2 offset, float rotation) {
 }
 
 void main() {
+    InstanceData instance = instanceData.instances[gl_InstanceIndex];
+
     // Transform to World Space
-    vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+    vec4 positionWorld = instance.modelMatrix * vec4(position.xyz, 1.0);
     gl_Position = ubo.projection * ubo.view * positionWorld;
 
-    fragColor = color;
+    // No vertex colors in the packed layout
+    fragColor = vec3(1.0);
     // fragTexCoord = uv;
-    fragTexCoord = transformUV(uv, push.uvScale, push.uvOffset, push.uvRotation);
-    fragNormalWorld = normalize(mat3(push.normalMatrix) * normal);
+    fragTexCoord = transformUV(uv, instance.uvScale, instance.uvOffset, instance.uvRotation);
+    fragNormalWorld = normalize(mat3(instance.normalMatrix) * octDecode(normal));
     fragPosWorld = positionWorld.xyz;
-    fragTangentWorld = vec4(normalize(mat3(push.normalMatrix) * tangent.xyz), tangent.w);
+    fragTangentWorld = vec4(normalize(mat3(instance.normalMatrix) * octDecode(tangent)), position.w < 0.0 ? -1.0 : 1.0);
+    fragInstance = gl_InstanceIndex;
 }
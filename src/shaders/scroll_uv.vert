@@ -1,6 +1,6 @@
 #version 450
 
-layout(location = 0) in vec3 position;
+layout(location = 0) in vec4 position;   // Packed, the model matrix decodes it
 layout(location = 3) in vec2 uv;
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
@@ -8,22 +8,24 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 view;
 } ubo;
 
-layout(push_constant) uniform Push {
+struct InstanceData {
     mat4 modelMatrix;
     mat4 normalMatrix;
-
     vec2 uvScale;
     vec2 uvOffset;
     float uvRotation;
-
-    int hasNormalTexture;
-    int hasMetallicRoughnessTexture;
     float metallicFactor;
     float roughnessFactor;
-
-    float billboardSize;
     int isAnimated;
+    int hasNormalTexture;
+    int hasMetallicRoughnessTexture;
+};
 
+layout(set = 0, binding = 2) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+} instanceData;
+
+layout(push_constant) uniform Push {
     float time;
     vec2 scrollSpeed;
 } push;
@@ -31,7 +33,7 @@ layout(push_constant) uniform Push {
 layout(location = 0) out vec2 fragTexCoord;
 
 void main() {
-    gl_Position = ubo.projection * ubo.view * push.modelMatrix * vec4(position, 1.0);
+    gl_Position = ubo.projection * ubo.view * instanceData.instances[gl_InstanceIndex].modelMatrix * vec4(position.xyz, 1.0);
 
     // Animated UVs
     vec2 final_uv = uv;
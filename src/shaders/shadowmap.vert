@@ -1,15 +1,11 @@
 #version 450
 
-#define MAX_JOINTS 100
-#define MAX_JOINT_INFLUENCE 4
-
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 color;
-layout(location = 2) in vec3 normal;
+// Packed vertex, see NtModel::StaticVertex. The model matrix decodes the position. Animated
+// meshes come in skinned already, from skin.comp.
+layout(location = 0) in vec4 position;
+layout(location = 2) in vec2 normal;
 layout(location = 3) in vec2 uv;
-layout(location = 4) in vec4 tangent;
-layout(location = 5) in ivec4 boneIndices;
-layout(location = 6) in vec4 boneWeights;
+layout(location = 4) in vec2 tangent;
 
 struct PointLight {
     vec4 position;
@@ -33,54 +29,26 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
     int numLights;
 } ubo;
 
-layout(set = 2, binding = 0) readonly buffer BoneMatrices {
-    mat4 bones[MAX_JOINTS];
-} boneData;
-
-layout(push_constant) uniform Push {
+struct InstanceData {
     mat4 modelMatrix;
     mat4 normalMatrix;
     vec2 uvScale;
     vec2 uvOffset;
     float uvRotation;
-    int hasNormalTexture;
-    int hasMetallicRoughnessTexture;
     float metallicFactor;
     float roughnessFactor;
-    float billboardSize;
     int isAnimated;
-} push;
-
-void main() {
-    vec4 worldPosition;
-
-    if (push.isAnimated == 1) {
-        vec4 animatedPosition = vec4(0.0f);
-        mat4 jointTransform = mat4(0.0f);
-
-        for (int i = 0; i < MAX_JOINT_INFLUENCE; i++) {
-            if (boneWeights[i] == 0)
-                continue;
-            if (boneIndices[i] >= MAX_JOINTS) {
-                animatedPosition = vec4(position, 1.0f);
-                jointTransform = mat4(1.0f);
-                break;
-            }
-
-            // retreive joint matrix from ubo
-            mat4 jointMatrix = boneData.bones[boneIndices[i]];
+    int hasNormalTexture;
+    int hasMetallicRoughnessTexture;
+};
 
-            vec4 localPosition = jointMatrix * vec4(position, 1.0f);
-            animatedPosition += localPosition * boneWeights[i];
-            jointTransform += jointMatrix * boneWeights[i];
-        }
+layout(set = 0, binding = 2) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+} instanceData;
 
-        // projection * view * model * position
-        worldPosition = push.modelMatrix * animatedPosition;
-    }
-    else {
-        worldPosition = push.modelMatrix * vec4(position, 1.0);
-    }
+void main() {
+    InstanceData instance = instanceData.instances[gl_InstanceIndex];
+    vec4 worldPosition = instance.modelMatrix * vec4(position.xyz, 1.0);
 
     gl_Position = ubo.lightSpaceMatrix * worldPosition;
 }
@@ -97,6 +97,11 @@ target("NoctuaryEngine")
           os.execv(glslc, { shader_file, "-o", path.join(output_dir, filename .. ".spv") })
         end
 
+        for _, shader_file in ipairs(os.files(shader_dir .. "/*.comp")) do
+          local filename = path.filename(shader_file)
+          os.execv(glslc, { shader_file, "-o", path.join(output_dir, filename .. ".spv") })
+        end
+
         -- Copy shaders to build directory
         os.cp("shaders/*.spv", path.join(target:targetdir(), "/shaders/"))
     end)
@@ -105,3 +110,23 @@ target("NoctuaryEngine")
         local shaderDir = target:targetdir() .. "/shaders/"
         os.rm(shaderDir)  -- Remove the shaders directory
     end)
+
+-- Microbenchmarks, not built by default: xmake build <name> && xmake run <name>
+target("bench_transform_batch")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/transform_batch.cpp", "src/nt_transform_batch.cpp")
+    add_includedirs("src")
+
+target("bench_component_lookup")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/component_lookup.cpp")
+    -- nt_ecs.hpp brings in the component headers, and with them Vulkan and glm
+    add_includedirs("src", "$(env VULKAN_SDK)/include")
+    if is_plat("windows") then
+        add_includedirs("C:/VulkanSDK/Include")
+    end
+    if is_plat("macosx") then
+        add_includedirs("/opt/homebrew/include")
+    end